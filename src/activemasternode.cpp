@@ -204,16 +204,11 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage)
 
         // SetLastPing locks the masternode cs, be careful with the lock order.
         pmn->SetLastPing(mnp);
-        mnodeman.mapSeenMasternodePing.emplace(mnp.GetHash(), mnp);
+        mnodeman.AddSeenPing(mnp);
 
         //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
         CMasternodeBroadcast mnb(*pmn);
-        uint256 hash = mnb.GetHash();
-        if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-            // SetLastPing locks the masternode cs, be careful with the lock order.
-            // TODO: check why are we double setting the last ping here..
-            mnodeman.mapSeenMasternodeBroadcast[hash].SetLastPing(mnp);
-        }
+        mnodeman.UpdateSeenBroadcastLastPing(mnb.GetHash(), mnp);
 
         mnp.Relay();
         return true;
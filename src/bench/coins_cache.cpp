@@ -0,0 +1,126 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "nodehashmap.h"
+#include "poolallocator.h"
+#include "primitives/block.h"
+#include "streams.h"
+
+#include <unordered_map>
+
+namespace block_bench {
+#include "bench/data/block2680960.raw.h"
+}
+
+// Replay the coins cache accesses of connecting block 2680960: every input
+// is fetched into the cache and spent, every output is added, then the
+// cache is flushed (emptied). The same pattern runs on the std allocated
+// unordered_map, on the pool allocated one (the default CCoinsMap), and on
+// the open addressing map (--enable-flat-coins-cache).
+
+static CBlock LoadBlock()
+{
+    CDataStream stream((const char*)block_bench::block2680960,
+            (const char*)&block_bench::block2680960[sizeof(block_bench::block2680960)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    return block;
+}
+
+static Coin MakeCoin(const COutPoint& outpoint)
+{
+    // The previous outputs are not in the block: any spendable coin will do
+    return Coin(CTxOut(outpoint.n + 1, CScript() << OP_TRUE), 1, false, false);
+}
+
+template <typename Map>
+static void ReplayBlock(const CBlock& block, Map& map)
+{
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn& in : tx->vin) {
+                // fetch from the backing view
+                auto it = map.emplace(std::piecewise_construct, std::forward_as_tuple(in.prevout), std::tuple<>()).first;
+                it->second.coin = MakeCoin(in.prevout);
+                // spend
+                it = map.find(in.prevout);
+                assert(it != map.end());
+                map.erase(it);
+            }
+        }
+        const uint256& txid = tx->GetHash();
+        for (size_t i = 0; i < tx->vout.size(); i++) {
+            auto it = map.emplace(std::piecewise_construct, std::forward_as_tuple(COutPoint(txid, i)), std::tuple<>()).first;
+            it->second.coin = Coin(tx->vout[i], 1, tx->IsCoinBase(), tx->IsCoinStake());
+            it->second.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        }
+    }
+    // flush
+    for (auto it = map.begin(); it != map.end();) {
+        it = map.erase(it);
+    }
+}
+
+static void CoinsCacheStdMap(benchmark::State& state)
+{
+    const CBlock block = LoadBlock();
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> map;
+    while (state.KeepRunning()) {
+        ReplayBlock(block, map);
+    }
+}
+
+static void CoinsCachePoolMap(benchmark::State& state)
+{
+    const CBlock block = LoadBlock();
+    CCoinsMapMemoryResource resource;
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> map(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &resource);
+    while (state.KeepRunning()) {
+        ReplayBlock(block, map);
+    }
+}
+
+static void CoinsCacheFlatMap(benchmark::State& state)
+{
+    const CBlock block = LoadBlock();
+    CCoinsMapMemoryResource resource;
+    nodehashmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> map(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &resource);
+    while (state.KeepRunning()) {
+        ReplayBlock(block, map);
+    }
+}
+
+// The same pattern through CCoinsViewCache, with the configured CCoinsMap
+static void CoinsCacheConnectBlock(benchmark::State& state)
+{
+    const CBlock block = LoadBlock();
+    CCoinsView dummy;
+    CCoinsViewCache base(&dummy);
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& in : tx->vin) {
+            base.AddCoin(in.prevout, MakeCoin(in.prevout), false);
+        }
+    }
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&base);
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& in : tx->vin) {
+                    view.SpendCoin(in.prevout);
+                }
+            }
+            AddCoins(view, *tx, 1);
+        }
+    }
+}
+
+BENCHMARK(CoinsCacheStdMap);
+BENCHMARK(CoinsCachePoolMap);
+BENCHMARK(CoinsCacheFlatMap);
+BENCHMARK(CoinsCacheConnectBlock);
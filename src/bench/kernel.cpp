@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "kernel.h"
+#include "random.h"
+
+#include <memory>
+
+// Synthetic wallet with 100k stakeable utxos
+static const int STAKE_INPUTS = 100000;
+
+// Build the kernel search of the synthetic wallet, on top of a fake chain tip
+// (the difficulty is set so that no kernel meets the target: each search hashes all the inputs).
+static void SetupKernelSearch(CBlockIndex& indexFrom, CBlockIndex& indexPrev,
+                              std::vector<std::unique_ptr<CCNoteStake>>& vInputs)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    FastRandomContext rng(true);
+
+    indexPrev.nHeight = 1000000;
+    indexPrev.nTime = 1600000000;
+    indexPrev.SetStakeModifier(rng.rand256());
+    indexFrom.nHeight = indexPrev.nHeight - 1000;
+    indexFrom.nTime = indexPrev.nTime - 1000 * 60;
+
+    vInputs.clear();
+    for (int i = 0; i < STAKE_INPUTS; i++) {
+        const CTxOut out(1000 * COIN, CScript());
+        vInputs.emplace_back(new CCNoteStake(out, COutPoint(rng.rand256(), rng.randrange(10)), &indexFrom));
+    }
+}
+
+// Kernel hashes with CStakeKernelSearch (batch SHA256d, single thread).
+// Kernel hashes per second = STAKE_INPUTS / time per iteration.
+static void StakeKernelSearch(benchmark::State& state)
+{
+    CBlockIndex indexFrom, indexPrev;
+    std::vector<std::unique_ptr<CCNoteStake>> vInputs;
+    SetupKernelSearch(indexFrom, indexPrev, vInputs);
+
+    CStakeKernelSearch search(&indexPrev, 0x01010000, indexPrev.nTime + 15);
+    for (const auto& input : vInputs) {
+        assert(search.AddInput(input.get()));
+    }
+    auto fnAbort = []() { return false; };
+    while (state.KeepRunning()) {
+        assert(search.Find(1, fnAbort) == -1);
+    }
+}
+
+// Kernel hashes with CStakeKernel::GetHash (one stream and scalar SHA256d per input)
+static void StakeKernelHash(benchmark::State& state)
+{
+    CBlockIndex indexFrom, indexPrev;
+    std::vector<std::unique_ptr<CCNoteStake>> vInputs;
+    SetupKernelSearch(indexFrom, indexPrev, vInputs);
+
+    while (state.KeepRunning()) {
+        for (const auto& input : vInputs) {
+            CStakeKernel kernel(&indexPrev, input.get(), 0x01010000, indexPrev.nTime + 15);
+            kernel.GetHash();
+        }
+    }
+}
+
+BENCHMARK(StakeKernelSearch);
+BENCHMARK(StakeKernelHash);
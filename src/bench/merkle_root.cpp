@@ -0,0 +1,54 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "consensus/merkle.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+namespace block_bench {
+#include "bench/data/block2680960.raw.h"
+}
+
+// Merkle root of the bundled block (the txids are cached in the transactions,
+// so this measures the tree hashing only).
+static void MerkleRootBlock2680960(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block2680960,
+            (const char*)&block_bench::block2680960[sizeof(block_bench::block2680960)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        uint256 root = BlockMerkleRoot(block, &mutated);
+        assert(root == block.hashMerkleRoot && !mutated);
+    }
+}
+
+// Merkle root of a synthetic block with 10k transactions
+static void MerkleRoot10kTx(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    CBlock block;
+    for (int i = 0; i < 10000; i++) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(rng.rand256(), 0));
+        tx.vout.emplace_back(1 * COIN, CScript());
+        block.vtx.emplace_back(MakeTransactionRef(std::move(tx)));
+    }
+
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        BlockMerkleRoot(block, &mutated);
+        assert(!mutated);
+    }
+}
+
+BENCHMARK(MerkleRootBlock2680960);
+BENCHMARK(MerkleRoot10kTx);
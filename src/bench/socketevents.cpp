@@ -0,0 +1,120 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "netbase.h"
+#include "socketevents.h"
+
+#include <string.h>
+#include <utility>
+#include <vector>
+
+// Loopback connections served by the socket handler (both ends are opened by the
+// bench: this keeps all the descriptors below FD_SETSIZE for the select() backend)
+static const int NUM_CONNECTIONS = 400;
+// Connections receiving data in each iteration
+static const int NUM_ACTIVE = 16;
+
+// Loopback TCP connections: the first socket (accepted) is served by the socket events,
+// data is written to the second one
+static std::vector<std::pair<SOCKET, SOCKET>> OpenConnections()
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert(hListen != INVALID_SOCKET);
+    int ret = ::bind(hListen, (struct sockaddr*)&addr, len);
+    assert(ret == 0);
+    ret = getsockname(hListen, (struct sockaddr*)&addr, &len);
+    assert(ret == 0);
+    ret = listen(hListen, SOMAXCONN);
+    assert(ret == 0);
+
+    std::vector<std::pair<SOCKET, SOCKET>> vConnections;
+    for (int i = 0; i < NUM_CONNECTIONS; i++) {
+        SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        assert(hClient != INVALID_SOCKET);
+        ret = connect(hClient, (struct sockaddr*)&addr, sizeof(addr));
+        assert(ret == 0);
+        SOCKET hServer = accept(hListen, nullptr, nullptr);
+        assert(hServer != INVALID_SOCKET);
+        bool fNonBlocking = SetSocketNonBlocking(hServer, true);
+        assert(fNonBlocking);
+        vConnections.emplace_back(hServer, hClient);
+    }
+    CloseSocket(hListen);
+    return vConnections;
+}
+
+static void CloseConnections(std::vector<std::pair<SOCKET, SOCKET>>& vConnections)
+{
+    for (auto& conn : vConnections) {
+        CloseSocket(conn.first);
+        CloseSocket(conn.second);
+    }
+}
+
+// One iteration of the socket handler: a few connections receive a message,
+// wait for them to be reported and read the data.
+static void RunSocketEvents(benchmark::State& state, SocketEventsMode mode)
+{
+    std::vector<std::pair<SOCKET, SOCKET>> vConnections = OpenConnections();
+    CSocketEvents events(mode);
+    assert(events.GetMode() == mode);
+    for (const auto& conn : vConnections) {
+        bool fAdded = events.Add(conn.first, true);
+        assert(fAdded);
+    }
+
+    std::vector<CSocketEvents::Event> vEvents;
+    const char msg[24] = {};
+    char buf[sizeof(msg)];
+    size_t nNext = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < NUM_ACTIVE; i++) {
+            int nSent = send(vConnections[(nNext + i) % NUM_CONNECTIONS].second, msg, sizeof(msg), 0);
+            assert(nSent == (int)sizeof(msg));
+        }
+        int nReceived = 0;
+        while (nReceived < NUM_ACTIVE) {
+            if (events.IsPolled()) {
+                for (const auto& conn : vConnections) {
+                    events.Want(conn.first, true, false);
+                }
+            }
+            bool fWaited = events.Wait(50, vEvents);
+            assert(fWaited);
+            for (const CSocketEvents::Event& ev : vEvents) {
+                if (ev.fRecv && recv(ev.socket, buf, sizeof(buf), MSG_DONTWAIT) == sizeof(buf)) {
+                    nReceived++;
+                }
+            }
+        }
+        nNext = (nNext + NUM_ACTIVE) % NUM_CONNECTIONS;
+    }
+
+    CloseConnections(vConnections);
+}
+
+static void SocketEventsSelect(benchmark::State& state)
+{
+    RunSocketEvents(state, SOCKETEVENTS_SELECT);
+}
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    RunSocketEvents(state, SOCKETEVENTS_EPOLL);
+}
+#endif
+
+BENCHMARK(SocketEventsSelect);
+#ifdef USE_EPOLL
+BENCHMARK(SocketEventsEpoll);
+#endif
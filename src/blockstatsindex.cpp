@@ -0,0 +1,222 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstatsindex.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "init.h"
+#include "policy/feerate.h"
+#include "primitives/block.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+static const char DB_BLOCK_STATS = 's';
+static const char DB_BEST_BLOCK = 'B';
+
+std::unique_ptr<CBlockStatsIndex> g_blockstatsindex;
+
+// Feerates at the 10th, 25th, 50th, 75th and 90th percentiles of the block space
+static void CalculateFeeRatePercentiles(std::vector<std::pair<CAmount, int64_t>>& vFeeRates, int64_t nTotalSize, CAmount nResult[NUM_FEERATE_PERCENTILES])
+{
+    if (vFeeRates.empty()) return;
+
+    std::sort(vFeeRates.begin(), vFeeRates.end());
+    const double vWeights[NUM_FEERATE_PERCENTILES] = {
+        nTotalSize / 10.0,
+        nTotalSize / 4.0,
+        nTotalSize / 2.0,
+        (nTotalSize * 3.0) / 4.0,
+        (nTotalSize * 9.0) / 10.0
+    };
+
+    int nNext = 0;
+    int64_t nCumulativeSize = 0;
+    for (const auto& feerate : vFeeRates) {
+        nCumulativeSize += feerate.second;
+        while (nNext < NUM_FEERATE_PERCENTILES && nCumulativeSize >= vWeights[nNext]) {
+            nResult[nNext++] = feerate.first;
+        }
+    }
+    // rounding errors
+    for (; nNext < NUM_FEERATE_PERCENTILES; nNext++) {
+        nResult[nNext] = vFeeRates.back().first;
+    }
+}
+
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& blockundo, CBlockStats& stats)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block %s and undo data inconsistent", __func__, block.GetHash().ToString());
+    }
+
+    stats = CBlockStats();
+    stats.hashBlock = block.GetHash();
+    const int ntx = block.vtx.size();
+    const int firstTxIndex = block.IsProofOfStake() ? 2 : 1;
+    stats.nTxCountAll = ntx;
+    stats.nTxCount = std::max(ntx - firstTxIndex, 0);
+
+    std::vector<std::pair<CAmount, int64_t>> vFeeRates;
+    vFeeRates.reserve(stats.nTxCount);
+    for (int idx = firstTxIndex; idx < ntx; idx++) {
+        const CTransaction& tx = *(block.vtx[idx]);
+        const int64_t nTxSize = GetSerializeSize(tx, SER_NETWORK, CLIENT_VERSION);
+        // no undo data for the coinbase
+        CAmount nValueIn = tx.GetShieldedValueIn();
+        for (const Coin& coin : blockundo.vtxundo[idx - 1].vprevout) {
+            nValueIn += coin.out.nValue;
+        }
+        const CAmount nTxFee = nValueIn - tx.GetValueOut();
+        stats.nTxBytes += nTxSize;
+        stats.nFees += nTxFee;
+        vFeeRates.emplace_back(CFeeRate(nTxFee, nTxSize).GetFeePerK(), nTxSize);
+    }
+    CalculateFeeRatePercentiles(vFeeRates, stats.nTxBytes, stats.nFeeRatePercentiles);
+    return true;
+}
+
+CBlockStatsDB::CBlockStatsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blockstats", nCacheSize, fMemory, fWipe) {}
+
+bool CBlockStatsDB::ReadStats(int nHeight, CBlockStats& stats) const
+{
+    return Read(std::make_pair(DB_BLOCK_STATS, nHeight), stats);
+}
+
+bool CBlockStatsDB::ReadBestBlock(uint256& hashBlock) const
+{
+    return Read(DB_BEST_BLOCK, hashBlock);
+}
+
+bool CBlockStatsDB::WriteStats(int nHeight, const CBlockStats& stats)
+{
+    CDBBatch batch;
+    batch.Write(std::make_pair(DB_BLOCK_STATS, nHeight), stats);
+    batch.Write(DB_BEST_BLOCK, stats.hashBlock);
+    return WriteBatch(batch);
+}
+
+bool CBlockStatsDB::EraseStats(int nHeight, const uint256& hashPrevBlock)
+{
+    CDBBatch batch;
+    batch.Erase(std::make_pair(DB_BLOCK_STATS, nHeight));
+    batch.Write(DB_BEST_BLOCK, hashPrevBlock);
+    return WriteBatch(batch);
+}
+
+CBlockStatsIndex::CBlockStatsIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+        db(nCacheSize, fMemory, fWipe)
+{
+}
+
+void CBlockStatsIndex::Init()
+{
+    uint256 hashBest;
+    if (!db.ReadBestBlock(hashBest)) {
+        return;
+    }
+
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(hashBest);
+    if (it == mapBlockIndex.end()) {
+        LogPrintf("%s: best block %s not found, indexing from genesis\n", __func__, hashBest.GetHex());
+        return;
+    }
+    // Blocks disconnected while the index was off are indexed again from the fork point
+    pindexSync = chainActive.FindFork(it->second);
+    nBestHeight = pindexSync ? pindexSync->nHeight : -1;
+}
+
+bool CBlockStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo blockundo;
+    if (!ReadBlockUndoFromDisk(blockundo, block, pindex)) {
+        return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+
+    CBlockStats stats;
+    if (!ComputeBlockStats(block, blockundo, stats)) {
+        return false;
+    }
+    if (!db.WriteStats(pindex->nHeight, stats)) {
+        return error("%s: failed to write stats of block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+    nBestHeight = pindex->nHeight;
+    return true;
+}
+
+void CBlockStatsIndex::ThreadSync()
+{
+    int64_t nLastLog = GetTime();
+    while (!ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+
+        const CBlockIndex* pindexNext;
+        {
+            LOCK(cs_main);
+            if (pindexSync && !chainActive.Contains(pindexSync)) {
+                pindexSync = chainActive.FindFork(pindexSync);
+            }
+            pindexNext = pindexSync ? chainActive.Next(pindexSync) : chainActive.Genesis();
+            if (!pindexNext) {
+                // Set under cs_main: the blocks connected from now on are
+                // indexed by the BlockConnected notifications.
+                fSynced = true;
+                LogPrintf("%s: block stats index synced at height %d\n", __func__, nBestHeight);
+                return;
+            }
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexNext)) {
+            LogPrintf("%s: failed to read block %s, block stats index stopped\n", __func__, pindexNext->GetBlockHash().GetHex());
+            return;
+        }
+        if (!WriteBlock(block, pindexNext)) {
+            LogPrintf("%s: block stats index stopped\n", __func__);
+            return;
+        }
+        pindexSync = pindexNext;
+
+        if (GetTime() - nLastLog >= 30) {
+            LogPrintf("Syncing block stats index with block chain from height %d\n", pindexSync->nHeight);
+            nLastLog = GetTime();
+        }
+    }
+}
+
+bool CBlockStatsIndex::LookUpStats(const CBlockIndex* pindex, CBlockStats& stats) const
+{
+    return pindex->nHeight <= nBestHeight &&
+           db.ReadStats(pindex->nHeight, stats) &&
+           stats.hashBlock == pindex->GetBlockHash();
+}
+
+void CBlockStatsIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    if (!fSynced) {
+        return;
+    }
+    WriteBlock(*block, pindex);
+}
+
+void CBlockStatsIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block, const uint256& blockHash, int nBlockHeight, int64_t blockTime)
+{
+    if (!fSynced) {
+        return;
+    }
+    CBlockStats stats;
+    if (db.ReadStats(nBlockHeight, stats) && stats.hashBlock == blockHash) {
+        if (!db.EraseStats(nBlockHeight, block->hashPrevBlock)) {
+            error("%s: failed to erase stats of block %s", __func__, blockHash.GetHex());
+            return;
+        }
+        nBestHeight = nBlockHeight - 1;
+    }
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSTATSINDEX_H
+#define BITCOIN_BLOCKSTATSINDEX_H
+
+#include "amount.h"
+#include "dbwrapper.h"
+#include "serialize.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+
+/** Default for -blockstatsindex */
+static const bool DEFAULT_BLOCKSTATSINDEX = false;
+
+/** Feerate percentiles kept for each block: 10th, 25th, 50th, 75th and 90th (weighted by tx size) */
+static const int NUM_FEERATE_PERCENTILES = 5;
+
+/** Fee and size statistics of a block (coinbase and coinstake are not counted, except in nTxCountAll) */
+struct CBlockStats
+{
+    uint256 hashBlock;
+    int64_t nTxCount{0};
+    int64_t nTxCountAll{0};
+    int64_t nTxBytes{0};
+    CAmount nFees{0};
+    //! Feerates (per kB) at the NUM_FEERATE_PERCENTILES percentiles
+    CAmount nFeeRatePercentiles[NUM_FEERATE_PERCENTILES] = {};
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        READWRITE(VARINT(nTxCount));
+        READWRITE(VARINT(nTxCountAll));
+        READWRITE(VARINT(nTxBytes));
+        READWRITE(nFees);
+        for (CAmount& nFeeRate : nFeeRatePercentiles) {
+            READWRITE(nFeeRate);
+        }
+    }
+};
+
+/** Compute the statistics of a block, valuing its inputs with the block undo data */
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& blockundo, CBlockStats& stats);
+
+/** Access to the block stats database (blockstats) */
+class CBlockStatsDB : public CDBWrapper
+{
+public:
+    CBlockStatsDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CBlockStatsDB(const CBlockStatsDB&);
+    void operator=(const CBlockStatsDB&);
+
+public:
+    bool ReadStats(int nHeight, CBlockStats& stats) const;
+    bool ReadBestBlock(uint256& hashBlock) const;
+    /** Write the stats of the block at nHeight, and make it the best indexed block */
+    bool WriteStats(int nHeight, const CBlockStats& stats);
+    /** Remove the stats of the block at nHeight, and make its parent the best indexed block */
+    bool EraseStats(int nHeight, const uint256& hashPrevBlock);
+};
+
+/**
+ * Per-block fee and size statistics of the active chain, computed from the
+ * block undo data, so that getblockindexstats/getfeeinfo need neither the
+ * blocks nor the txindex.
+ * The blocks already in the chain are indexed by ThreadSync() in the
+ * background. Once it reaches the tip, the index follows the chain with the
+ * BlockConnected/BlockDisconnected notifications.
+ * The entries are keyed by height and hold the block hash: an entry left by
+ * a block that is no longer in the active chain is never returned.
+ */
+class CBlockStatsIndex : public CValidationInterface
+{
+public:
+    CBlockStatsIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Find where the index left off in the active chain. Requires the block index to be loaded. */
+    void Init();
+    /** Index the blocks of the active chain up to the tip. Run by the "blkstats" thread. */
+    void ThreadSync();
+
+    /** Stats of a block of the active chain. Returns false if the block is not indexed yet. */
+    bool LookUpStats(const CBlockIndex* pindex, CBlockStats& stats) const;
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const uint256& blockHash, int nBlockHeight, int64_t blockTime) override;
+
+private:
+    CBlockStatsDB db;
+    //! Last block indexed by ThreadSync() (read and written by the sync thread only)
+    const CBlockIndex* pindexSync{nullptr};
+    std::atomic<int> nBestHeight{-1};
+    std::atomic<bool> fSynced{false};
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex);
+};
+
+extern std::unique_ptr<CBlockStatsIndex> g_blockstatsindex;
+
+#endif // BITCOIN_BLOCKSTATSINDEX_H
@@ -15,6 +15,8 @@
 
 CBudgetManager g_budgetman;
 
+// Protected by its own lock: the proposal and the finalized budget votes are processed on different threads
+static RecursiveMutex cs_askedForSource;
 std::map<uint256, int64_t> askedForSourceProposalOrBudget;
 
 // Used to check both proposals and finalized-budgets collateral txes
@@ -799,7 +801,7 @@ void CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
 
     auto it = prop->mapVotes.begin();
     while (it != prop->mapVotes.end()) {
-        CMasternode* pmn = mnodeman.Find(it->first);
+        MasternodeRef pmn = mnodeman.GetMasternodeRef(it->first);
         (*it).second.SetValid(pmn && pmn->IsEnabled());
         ++it;
     }
@@ -815,7 +817,7 @@ void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
 
     auto it = fbud->mapVotes.begin();
     while (it != fbud->mapVotes.end()) {
-        CMasternode* pmn = mnodeman.Find(it->first);
+        MasternodeRef pmn = mnodeman.GetMasternodeRef(it->first);
         (*it).second.SetValid(pmn && pmn->IsEnabled());
         ++it;
     }
@@ -897,12 +899,15 @@ void CBudgetManager::NewBlock(int height)
     CheckAndRemove();
 
     //remove invalid (from non-active masternode) votes once in a while
-    LogPrint(BCLog::MNBUDGET,"%s:  askedForSourceProposalOrBudget cleanup - size: %d\n", __func__, askedForSourceProposalOrBudget.size());
-    for (auto it = askedForSourceProposalOrBudget.begin(); it !=  askedForSourceProposalOrBudget.end(); ) {
-        if (it->second <= GetTime() - (60 * 60 * 24)) {
-            it = askedForSourceProposalOrBudget.erase(it);
-        } else {
-            it++;
+    {
+        LOCK(cs_askedForSource);
+        LogPrint(BCLog::MNBUDGET,"%s:  askedForSourceProposalOrBudget cleanup - size: %d\n", __func__, askedForSourceProposalOrBudget.size());
+        for (auto it = askedForSourceProposalOrBudget.begin(); it !=  askedForSourceProposalOrBudget.end(); ) {
+            if (it->second <= GetTime() - (60 * 60 * 24)) {
+                it = askedForSourceProposalOrBudget.erase(it);
+            } else {
+                it++;
+            }
         }
     }
     {
@@ -966,7 +971,7 @@ int CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom)
     }
 
     const CTxIn& voteVin = vote.GetVin();
-    CMasternode* pmn = mnodeman.Find(voteVin.prevout);
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(voteVin.prevout);
     if (!pmn) {
         LogPrint(BCLog::MNBUDGET, "mvote - unknown masternode - vin: %s\n", voteVin.ToString());
         mnodeman.AskForMN(pfrom, voteVin);
@@ -1023,7 +1028,7 @@ int CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode
     }
 
     const CTxIn& voteVin = vote.GetVin();
-    CMasternode* pmn = mnodeman.Find(voteVin.prevout);
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(voteVin.prevout);
     if (!pmn) {
         LogPrint(BCLog::MNBUDGET, "fbvote - unknown masternode - vin: %s\n", voteVin.prevout.hash.ToString());
         mnodeman.AskForMN(pfrom, voteVin);
@@ -1183,9 +1188,8 @@ bool CBudgetManager::UpdateProposal(const CBudgetVote& vote, CNode* pfrom, std::
             LogPrint(BCLog::MNBUDGET,"%s: Unknown proposal %d, asking for source proposal\n", __func__, nProposalHash.ToString());
             WITH_LOCK(cs_votes, mapOrphanProposalVotes[nProposalHash] = vote; );
 
-            if (!askedForSourceProposalOrBudget.count(nProposalHash)) {
+            if (WITH_LOCK(cs_askedForSource, return askedForSourceProposalOrBudget.emplace(nProposalHash, GetTime()).second)) {
                 g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::BUDGETVOTESYNC, nProposalHash));
-                askedForSourceProposalOrBudget[nProposalHash] = GetTime();
             }
         }
 
@@ -1211,9 +1215,8 @@ bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pf
             LogPrint(BCLog::MNBUDGET,"%s: Unknown Finalized Proposal %s, asking for source budget\n", __func__, nBudgetHash.ToString());
             WITH_LOCK(cs_finalizedvotes, mapOrphanFinalizedBudgetVotes[nBudgetHash] = vote; );
 
-            if (!askedForSourceProposalOrBudget.count(nBudgetHash)) {
+            if (WITH_LOCK(cs_askedForSource, return askedForSourceProposalOrBudget.emplace(nBudgetHash, GetTime()).second)) {
                 g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::BUDGETVOTESYNC, nBudgetHash));
-                askedForSourceProposalOrBudget[nBudgetHash] = GetTime();
             }
         }
 
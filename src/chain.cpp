@@ -7,6 +7,7 @@
 
 #include "chain.h"
 #include "legacy/stakemodifier.h"  // for ComputeNextStakeModifier
+#include "memusage.h"
 
 
 /**
@@ -224,10 +225,7 @@ bool CBlockIndex::SetStakeEntropyBit(unsigned int nEntropyBit)
 // Sets V1 stake modifier (uint64_t)
 void CBlockIndex::SetStakeModifier(const uint64_t nStakeModifier, bool fGeneratedStakeModifier)
 {
-    vStakeModifier.clear();
-    const size_t modSize = sizeof(nStakeModifier);
-    vStakeModifier.resize(modSize);
-    std::memcpy(vStakeModifier.data(), &nStakeModifier, modSize);
+    stakeModifier.assign((const unsigned char*)&nStakeModifier, sizeof(nStakeModifier));
     if (fGeneratedStakeModifier)
         nFlags |= BLOCK_STAKE_MODIFIER;
 
@@ -249,8 +247,7 @@ void CBlockIndex::SetNewStakeModifier()
 // Sets V2 stake modifiers (uint256)
 void CBlockIndex::SetStakeModifier(const uint256& nStakeModifier)
 {
-    vStakeModifier.clear();
-    vStakeModifier.insert(vStakeModifier.begin(), nStakeModifier.begin(), nStakeModifier.end());
+    stakeModifier.assign(nStakeModifier.begin(), nStakeModifier.size());
 }
 
 // Generates and sets new V2 stake modifier
@@ -270,20 +267,20 @@ void CBlockIndex::SetNewStakeModifier(const uint256& prevoutId)
 // Returns V1 stake modifier (uint64_t)
 uint64_t CBlockIndex::GetStakeModifierV1() const
 {
-    if (vStakeModifier.empty() || Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
+    if (stakeModifier.empty() || Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return 0;
     uint64_t nStakeModifier;
-    std::memcpy(&nStakeModifier, vStakeModifier.data(), vStakeModifier.size());
+    std::memcpy(&nStakeModifier, stakeModifier.data(), stakeModifier.size());
     return nStakeModifier;
 }
 
 // Returns V2 stake modifier (uint256)
 uint256 CBlockIndex::GetStakeModifierV2() const
 {
-    if (vStakeModifier.empty() || !Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
+    if (stakeModifier.empty() || !Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return UINT256_ZERO;
     uint256 nStakeModifier;
-    std::memcpy(nStakeModifier.begin(), vStakeModifier.data(), vStakeModifier.size());
+    std::memcpy(nStakeModifier.begin(), stakeModifier.data(), stakeModifier.size());
     return nStakeModifier;
 }
 
@@ -344,4 +341,16 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     return pa;
 }
 
+void CBlockIndexArena::Clear()
+{
+    for (size_t n = 0; n < nEntries; n++) {
+        Get(n)->~CBlockIndex();
+    }
+    vSlabs.clear();
+    nEntries = 0;
+}
 
+size_t CBlockIndexArena::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vSlabs) + vSlabs.size() * memusage::MallocUsage(sizeof(Storage) * SLAB_ENTRIES);
+}
@@ -20,6 +20,9 @@
 #include "uint256.h"
 #include "util.h"
 
+#include <cstring>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 class CBlockFileInfo
@@ -168,6 +171,48 @@ enum {
     BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
 };
 
+/** Stake modifier bytes of a block index entry, stored inline (no heap allocation).
+ * It is empty for PoW blocks. Modifier V1 is 64 bit while modifier V2 is 256 bit.
+ * Serialized as a byte vector, like the previous std::vector<unsigned char> representation.
+ */
+class CStakeModifier
+{
+public:
+    static const size_t MAX_SIZE = 32;
+
+private:
+    unsigned char vch[MAX_SIZE];
+    uint8_t nSize{0};
+
+public:
+    bool empty() const { return nSize == 0; }
+    size_t size() const { return nSize; }
+    const unsigned char* data() const { return vch; }
+    void clear() { nSize = 0; }
+    void assign(const unsigned char* pch, size_t len)
+    {
+        assert(len <= MAX_SIZE);
+        std::memcpy(vch, pch, len);
+        nSize = (uint8_t) len;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, nSize);
+        if (nSize) s.write((const char*)vch, nSize);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint64_t len = ReadCompactSize(s);
+        if (len > MAX_SIZE) throw std::ios_base::failure("CStakeModifier::Unserialize : stake modifier too large");
+        nSize = (uint8_t) len;
+        if (nSize) s.read((char*)vch, nSize);
+    }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -213,9 +258,6 @@ public:
     unsigned int nStatus{0};
 
     // proof-of-stake specific fields
-    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
-    // Modifier V1 is 64 bit while modifier V2 is 256 bit.
-    std::vector<unsigned char> vStakeModifier{};
     unsigned int nFlags{0};
 
     //! Change in value held by the Sapling circuit over this block.
@@ -238,6 +280,9 @@ public:
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId{0};
 
+    //! stake modifier (proof-of-stake specific), last to keep the entry packed
+    CStakeModifier stakeModifier{};
+
     CBlockIndex() {}
     CBlockIndex(const CBlock& block);
 
@@ -330,7 +375,7 @@ public:
             // Serialization with CLIENT_VERSION = 4009902+
             READWRITE(nFlags);
             READWRITE(this->nVersion);
-            READWRITE(vStakeModifier);
+            READWRITE(stakeModifier);
             READWRITE(hashPrev);
             READWRITE(hashMerkleRoot);
             READWRITE(nTime);
@@ -349,7 +394,7 @@ public:
             READWRITE(nMoneySupply);
             READWRITE(nFlags);
             READWRITE(this->nVersion);
-            READWRITE(vStakeModifier);
+            READWRITE(stakeModifier);
             READWRITE(hashPrev);
             READWRITE(hashMerkleRoot);
             READWRITE(nTime);
@@ -464,7 +509,7 @@ public:
             READWRITE(nMoneySupply);
             READWRITE(nFlags);
             READWRITE(this->nVersion);
-            READWRITE(vStakeModifier);
+            READWRITE(stakeModifier);
             READWRITE(hashPrev);
             READWRITE(hashMerkleRoot);
             READWRITE(nTime);
@@ -498,6 +543,46 @@ public:
     }
 };
 
+/** Storage of the block index entries. The entries are allocated in contiguous slabs,
+ * without one heap allocation per entry, and are only released all together.
+ */
+class CBlockIndexArena
+{
+private:
+    static const size_t SLAB_ENTRIES = 4096;
+    typedef std::aligned_storage<sizeof(CBlockIndex), alignof(CBlockIndex)>::type Storage;
+
+    std::vector<std::unique_ptr<Storage[]>> vSlabs;
+    size_t nEntries{0};
+
+    CBlockIndex* Get(size_t n) { return reinterpret_cast<CBlockIndex*>(&vSlabs[n / SLAB_ENTRIES][n % SLAB_ENTRIES]); }
+
+public:
+    CBlockIndexArena() {}
+    ~CBlockIndexArena() { Clear(); }
+    CBlockIndexArena(const CBlockIndexArena&) = delete;
+    CBlockIndexArena& operator=(const CBlockIndexArena&) = delete;
+
+    //! Construct a new entry in the arena
+    template <typename... Args>
+    CBlockIndex* Create(Args&&... args)
+    {
+        if (nEntries == vSlabs.size() * SLAB_ENTRIES) {
+            vSlabs.emplace_back(new Storage[SLAB_ENTRIES]);
+        }
+        void* p = &vSlabs.back()[nEntries % SLAB_ENTRIES];
+        CBlockIndex* pindex = new (p) CBlockIndex(std::forward<Args>(args)...);
+        nEntries++;
+        return pindex;
+    }
+
+    //! Destroy all the entries and release the slabs
+    void Clear();
+
+    size_t Size() const { return nEntries; }
+    size_t DynamicMemoryUsage() const;
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain
 {
@@ -55,12 +55,18 @@ uint256 CCoinsViewBacked::GetBestAnchor() const { return base->GetBestAnchor();
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 SaltedIdHasher::SaltedIdHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) :
+        CCoinsViewBacked(baseIn),
+        cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource),
+        cachedCoinsUsage(0)
+{
+}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) +
            memusage::DynamicUsage(cacheSaplingAnchors) +
            memusage::DynamicUsage(cacheSaplingNullifiers) +
+           memusage::DynamicUsage(vDirtyCoins) +
            cachedCoinsUsage;
 }
 
@@ -109,6 +115,7 @@ void CCoinsViewCache::AddCoin(const COutPoint& outpoint, Coin&& coin, bool possi
         fresh = !(it->second.flags & CCoinsCacheEntry::DIRTY);
     }
     it->second.coin = std::move(coin);
+    if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) vDirtyCoins.push_back(outpoint);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
@@ -136,6 +143,7 @@ void CCoinsViewCache::SpendCoin(const COutPoint& outpoint, Coin* moveout)
     if (it->second.flags & CCoinsCacheEntry::FRESH) {
         cacheCoins.erase(it);
     } else {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) vDirtyCoins.push_back(outpoint);
         it->second.flags |= CCoinsCacheEntry::DIRTY;
         it->second.coin.Clear();
     }
@@ -251,6 +259,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins,
                     entry.coin = std::move(it->second.coin);
                     cachedCoinsUsage += memusage::DynamicUsage(entry.coin);
                     entry.flags = CCoinsCacheEntry::DIRTY;
+                    vDirtyCoins.push_back(it->first);
                     // We can mark it FRESH in the parent if it was FRESH in the child
                     // Otherwise it might have just been flushed from the parent's cache
                     // and already exist in the grandparent
@@ -277,6 +286,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins,
                     cachedCoinsUsage -= memusage::DynamicUsage(itUs->second.coin);
                     itUs->second.coin = std::move(it->second.coin);
                     cachedCoinsUsage += memusage::DynamicUsage(itUs->second.coin);
+                    if (!(itUs->second.flags & CCoinsCacheEntry::DIRTY)) vDirtyCoins.push_back(it->first);
                     itUs->second.flags |= CCoinsCacheEntry::DIRTY;
                     // NOTE: It is possible the child has a FRESH flag here in
                     // the event the entry we found in the parent is pruned. But
@@ -310,9 +320,65 @@ bool CCoinsViewCache::Flush()
     cacheSaplingAnchors.clear();
     cacheSaplingNullifiers.clear();
     cachedCoinsUsage = 0;
+    std::vector<COutPoint>().swap(vDirtyCoins);
     return fOk;
 }
 
+bool CCoinsViewCache::Sync()
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap mapDirty(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+    mapDirty.reserve(vDirtyCoins.size());
+    for (const COutPoint& outpoint : vDirtyCoins) {
+        CCoinsMap::iterator it = cacheCoins.find(outpoint);
+        // Already synced (listed twice), or spent while FRESH
+        if (it == cacheCoins.end() || !(it->second.flags & CCoinsCacheEntry::DIRTY)) continue;
+        if (it->second.coin.IsSpent()) {
+            // A FRESH spent coin was never seen by the base
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH)) {
+                mapDirty[it->first].flags = CCoinsCacheEntry::DIRTY;
+            }
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            cacheCoins.erase(it);
+        } else {
+            CCoinsCacheEntry& entry = mapDirty[it->first];
+            entry.coin = it->second.coin;
+            entry.flags = CCoinsCacheEntry::DIRTY;
+            // The base has it now
+            it->second.flags = 0;
+        }
+    }
+    std::vector<COutPoint>().swap(vDirtyCoins);
+
+    // Sapling
+    CAnchorsSaplingMap mapAnchorsDirty;
+    for (auto& it : cacheSaplingAnchors) {
+        if (it.second.flags & CAnchorsSaplingCacheEntry::DIRTY) {
+            mapAnchorsDirty.emplace(it.first, it.second);
+            it.second.flags = 0;
+        }
+    }
+    CNullifiersMap mapNullifiersDirty;
+    for (auto& it : cacheSaplingNullifiers) {
+        if (it.second.flags & CNullifiersCacheEntry::DIRTY) {
+            mapNullifiersDirty.emplace(it.first, it.second);
+            it.second.flags = 0;
+        }
+    }
+
+    return base->BatchWrite(mapDirty, hashBlock, hashSaplingAnchor, mapAnchorsDirty, mapNullifiersDirty);
+}
+
+void CCoinsViewCache::ReallocateCache()
+{
+    // Cache should be empty when we're calling this.
+    assert(cacheCoins.size() == 0);
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
+    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource);
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& outpoint)
 {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
@@ -389,22 +455,6 @@ int CCoinsViewCache::GetCoinDepthAtHeight(const COutPoint& output, int nHeight)
     return -1;
 }
 
-CAmount CCoinsViewCache::GetTotalAmount() const
-{
-    CAmount nTotal = 0;
-
-    std::unique_ptr<CCoinsViewCursor> pcursor(Cursor());
-    while (pcursor->Valid()) {
-        Coin coin;
-        if (pcursor->GetValue(coin) && !coin.IsSpent()) {
-            nTotal += coin.out.nValue;
-        }
-        pcursor->Next();
-    }
-
-    return nTotal;
-}
-
 
 static const size_t MAX_OUTPUTS_PER_BLOCK = MAX_BLOCK_SIZE_CURRENT /  ::GetSerializeSize(CTxOut(), SER_NETWORK, PROTOCOL_VERSION); // TODO: merge with similar definition in undo.h.
 
@@ -8,9 +8,15 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#if defined(HAVE_CONFIG_H)
+#include "config/c_note-config.h"
+#endif
+
 #include "compressor.h"
 #include "consensus/consensus.h" // can be removed once policy/ established
 #include "memusage.h"
+#include "nodehashmap.h"
+#include "poolallocator.h"
 #include "sapling/incrementalmerkletree.h"
 #include "script/standard.h"
 #include "serialize.h"
@@ -174,7 +180,22 @@ struct CNullifiersCacheEntry
 typedef std::unordered_map<uint256, CAnchorsSaplingCacheEntry, SaltedIdHasher> CAnchorsSaplingMap;
 typedef std::unordered_map<uint256, CNullifiersCacheEntry, SaltedIdHasher> CNullifiersMap;
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The coins cache entries are allocated from a pool (see PoolResource): one
+ * chunk allocation for thousands of entries instead of one heap allocation
+ * each, and the memory of the spent entries is reused for the new ones.
+ * The pool blocks fit an entry and the node overhead of the map.
+ */
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                      sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4> CCoinsMapAllocator;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
+
+#ifdef ENABLE_FLAT_COINS_CACHE
+//! Open addressing index over the pooled entries (configure --enable-flat-coins-cache)
+typedef nodehashmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+#else
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+#endif
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -288,6 +309,8 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    //! Memory of the cacheCoins entries, released by ReallocateCache
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource;
     mutable CCoinsMap cacheCoins;
 
     // Sapling
@@ -298,6 +321,13 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /**
+     * Outpoints of the entries that became dirty since the last Flush or Sync,
+     * so that Sync does not walk the whole cache. An outpoint may be listed
+     * twice, or no longer be in cacheCoins.
+     */
+    std::vector<COutPoint> vDirtyCoins;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -366,6 +396,19 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modified entries to the base, like Flush, but keep the cache
+     * warm: the unspent entries stay cached (no longer dirty), only the spent
+     * ones are dropped.
+     */
+    bool Sync();
+
+    /**
+     * Free the memory of the (empty) coins cache: the entries of its pool
+     * are reused by the next ones, but never returned to the system.
+     */
+    void ReallocateCache();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is not modified.
      */
@@ -402,11 +445,6 @@ public:
      */
     int GetCoinDepthAtHeight(const COutPoint& output, int nHeight) const;
 
-    /*
-     * Return the sum of the value of all transaction outputs
-     */
-    CAmount GetTotalAmount() const;
-
 
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint& outpoint) const;
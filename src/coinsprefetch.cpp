@@ -0,0 +1,191 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinsprefetch.h"
+
+#include "memusage.h"
+#include "primitives/block.h"
+#include "util.h"
+#include "validation.h"
+
+#include <set>
+
+CCoinsViewPrefetch::CCoinsViewPrefetch(CCoinsView* viewIn, int nThreads, int nBlocksAheadIn, size_t nMaxUsageIn) :
+        CCoinsViewBacked(viewIn),
+        nMaxUsage(nMaxUsageIn),
+        nBlocksAhead(nBlocksAheadIn)
+{
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back(&TraceThread<std::function<void()> >, "prefetch", std::function<void()>(std::bind(&CCoinsViewPrefetch::ThreadPrefetch, this)));
+    }
+}
+
+CCoinsViewPrefetch::~CCoinsViewPrefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void CCoinsViewPrefetch::ThreadPrefetch()
+{
+    while (true) {
+        QueuedBlock next;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            cond.wait(lock, [this] { return fStop || !queue.empty(); });
+            if (fStop) return;
+            next = queue.front();
+            queue.pop_front();
+        }
+        CBlock block;
+        if (!ReadBlockFromDisk(block, next.pos) || block.GetHash() != next.hash) {
+            continue;
+        }
+        PrefetchBlock(block, next.nHeight);
+    }
+}
+
+size_t CCoinsViewPrefetch::StagedUsage() const
+{
+    return memusage::DynamicUsage(mapStaged) + nStagedUsage;
+}
+
+void CCoinsViewPrefetch::EraseStaged(std::unordered_map<COutPoint, Coin, SaltedOutpointHasher>::iterator it) const
+{
+    nStagedUsage -= it->second.DynamicMemoryUsage();
+    mapStaged.erase(it);
+}
+
+void CCoinsViewPrefetch::PrefetchBlock(const CBlock& block, int nHeight)
+{
+    // The outputs created in the block itself are not in the base view yet
+    std::set<uint256> setTxids;
+    for (const auto& tx : block.vtx) {
+        setTxids.insert(tx->GetHash());
+    }
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& in : tx->vin) {
+            if (setTxids.count(in.prevout.hash)) continue;
+            uint64_t nSequence;
+            {
+                std::lock_guard<std::mutex> lock(cs);
+                if (fStop) return;
+                // Full: the coins of the connected blocks make room again (see Prefetch)
+                if (StagedUsage() >= nMaxUsage) return;
+                if (mapStaged.count(in.prevout)) continue;
+                nSequence = nWriteSequence;
+            }
+            // The base view is being written
+            if (nSequence & 1) continue;
+            Coin coin;
+            if (!base->GetCoin(in.prevout, coin)) continue;
+            {
+                std::lock_guard<std::mutex> lock(cs);
+                // Drop the coin if a write went through meanwhile, it may be stale
+                if (nSequence == nWriteSequence) {
+                    const size_t nCoinUsage = coin.DynamicMemoryUsage();
+                    if (mapStaged.emplace(in.prevout, std::move(coin)).second) {
+                        mapStagedHeights[nHeight].push_back(in.prevout);
+                        nStagedUsage += nCoinUsage + sizeof(COutPoint);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool CCoinsViewPrefetch::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        auto it = mapStaged.find(outpoint);
+        if (it != mapStaged.end()) {
+            // The caller caches it from now on
+            nStagedUsage -= it->second.DynamicMemoryUsage();
+            coin = std::move(it->second);
+            mapStaged.erase(it);
+            nHits++;
+            return true;
+        }
+    }
+    nMisses++;
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewPrefetch::HaveCoin(const COutPoint& outpoint) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (mapStaged.count(outpoint)) return true;
+    }
+    return base->HaveCoin(outpoint);
+}
+
+bool CCoinsViewPrefetch::BatchWrite(CCoinsMap& mapCoins,
+                                    const uint256& hashBlock,
+                                    const uint256& hashSaplingAnchor,
+                                    CAnchorsSaplingMap& mapSaplingAnchors,
+                                    CNullifiersMap& mapSaplingNullifiers)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        nWriteSequence++;
+        if (!mapStaged.empty()) {
+            for (const auto& it : mapCoins) {
+                if (!(it.second.flags & CCoinsCacheEntry::DIRTY)) continue;
+                auto itStaged = mapStaged.find(it.first);
+                if (itStaged != mapStaged.end()) EraseStaged(itStaged);
+            }
+        }
+    }
+    bool ret = base->BatchWrite(mapCoins, hashBlock, hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers);
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        nWriteSequence++;
+    }
+    return ret;
+}
+
+void CCoinsViewPrefetch::Prefetch(const CBlockIndex* pindexConnecting, const CBlockIndex* pindexTarget)
+{
+    const int nLast = std::min(pindexConnecting->nHeight + nBlocksAhead, pindexTarget->nHeight);
+    int nHeight = pindexConnecting->nHeight + 1;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pindexQueued && pindexQueued->nHeight >= nHeight) {
+            if (pindexTarget->GetAncestor(pindexQueued->nHeight) == pindexQueued) {
+                nHeight = pindexQueued->nHeight + 1;
+            } else {
+                // Switched to another chain: the queued blocks and staged coins are not needed
+                queue.clear();
+                mapStaged.clear();
+                mapStagedHeights.clear();
+                nStagedUsage = 0;
+            }
+        }
+        // The coins staged for the blocks before this one were not used (pcoinsTip had them)
+        while (!mapStagedHeights.empty() && mapStagedHeights.begin()->first < pindexConnecting->nHeight) {
+            for (const COutPoint& outpoint : mapStagedHeights.begin()->second) {
+                auto it = mapStaged.find(outpoint);
+                if (it != mapStaged.end()) EraseStaged(it);
+                nStagedUsage -= sizeof(COutPoint);
+            }
+            mapStagedHeights.erase(mapStagedHeights.begin());
+        }
+        for (; nHeight <= nLast; nHeight++) {
+            const CBlockIndex* pindex = pindexTarget->GetAncestor(nHeight);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) break;
+            queue.push_back({pindex->GetBlockHash(), pindex->GetBlockPos(), nHeight});
+            pindexQueued = pindex;
+        }
+    }
+    cond.notify_all();
+}
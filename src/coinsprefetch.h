@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSPREFETCH_H
+#define BITCOIN_COINSPREFETCH_H
+
+#include "chain.h"
+#include "coins.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! -prefetchthreads default: no prefetching
+static const int DEFAULT_PREFETCH_THREADS = 0;
+static const int MAX_PREFETCH_THREADS = 8;
+//! -prefetchblocks default
+static const int DEFAULT_PREFETCH_BLOCKS = 16;
+//! Upper bound of the staging cache, in bytes (taken out of the in-memory UTXO set budget of -dbcache)
+static const int64_t MAX_PREFETCH_CACHE = 64 << 20;
+
+/**
+ * CCoinsView that prefetches, from parallel threads, the coins spent by the
+ * blocks about to be connected, while the current one is being connected.
+ *
+ * It sits between pcoinsTip and the coin database: the worker threads read
+ * the next blocks from disk and the coins of their inputs from the base
+ * view into a staging cache, which then answers the lookups that miss
+ * pcoinsTip. A staged coin is handed out once (the lookup moves it into
+ * pcoinsTip), and is dropped when a BatchWrite modifies it, so the staging
+ * cache never shadows a newer state of the base view. The coins staged for
+ * a block that was connected without using them are dropped when the next
+ * one is prefetched.
+ */
+class CCoinsViewPrefetch : public CCoinsViewBacked
+{
+private:
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    mutable std::unordered_map<COutPoint, Coin, SaltedOutpointHasher> mapStaged;
+    //! Outpoints staged for each block height, to drop the ones left behind by the connected blocks
+    std::map<int, std::vector<COutPoint>> mapStagedHeights;
+    //! Memory of the staged coins and of mapStagedHeights (the map nodes are counted by StagedUsage)
+    mutable size_t nStagedUsage{0};
+    const size_t nMaxUsage;
+
+    struct QueuedBlock {
+        uint256 hash;
+        CDiskBlockPos pos;
+        int nHeight;
+    };
+    //! Blocks to read, with the position of their data
+    std::deque<QueuedBlock> queue;
+    //! Last block queued, to resume from it
+    const CBlockIndex* pindexQueued{nullptr};
+    //! Odd while a BatchWrite goes through, incremented around each one
+    uint64_t nWriteSequence{0};
+    const int nBlocksAhead;
+    bool fStop{false};
+    std::vector<std::thread> threads;
+
+    mutable std::atomic<uint64_t> nHits{0};
+    mutable std::atomic<uint64_t> nMisses{0};
+
+    void ThreadPrefetch();
+    void PrefetchBlock(const CBlock& block, int nHeight);
+    //! Memory used by the staging cache (cs must be held)
+    size_t StagedUsage() const;
+    //! Remove a staged coin (cs must be held)
+    void EraseStaged(std::unordered_map<COutPoint, Coin, SaltedOutpointHasher>::iterator it) const;
+
+public:
+    //! nMaxUsageIn: memory budget of the staging cache, in bytes
+    CCoinsViewPrefetch(CCoinsView* viewIn, int nThreads, int nBlocksAheadIn, size_t nMaxUsageIn);
+    ~CCoinsViewPrefetch();
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    bool BatchWrite(CCoinsMap& mapCoins,
+                    const uint256& hashBlock,
+                    const uint256& hashSaplingAnchor,
+                    CAnchorsSaplingMap& mapSaplingAnchors,
+                    CNullifiersMap& mapSaplingNullifiers) override;
+
+    /**
+     * Queue the blocks (with data on disk) after pindexConnecting towards
+     * pindexTarget, up to -prefetchblocks ahead. Called with cs_main held.
+     */
+    void Prefetch(const CBlockIndex* pindexConnecting, const CBlockIndex* pindexTarget);
+
+    //! Lookups answered by the staging cache, and passed to the base view
+    void GetCounters(uint64_t& nHitsOut, uint64_t& nMissesOut) const
+    {
+        nHitsOut = nHits;
+        nMissesOut = nMisses;
+    }
+};
+
+#endif // BITCOIN_COINSPREFETCH_H
@@ -0,0 +1,262 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinstats.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "streams.h"
+#include "undo.h"
+#include "util.h"
+#include "utilmoneystr.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+static const char DB_UTXO_STATS = 's';
+static const char DB_UTXO_TIP = 'T';
+
+CUTXOStatsTracker* putxostats = nullptr;
+
+static void ApplyStats(CCoinsStats& stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    assert(!outputs.empty());
+    ss << hash;
+    const Coin& coin = outputs.begin()->second;
+    ss << VARINT(coin.nHeight * 4 + (coin.fCoinBase ? 2 : 0) + (coin.fCoinStake ? 1 : 0));
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        ss << VARINT(output.first + 1);
+        ss << output.second.out.scriptPubKey;
+        ss << VARINT(output.second.out.nValue);
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+    }
+    ss << VARINT(0);
+}
+
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    stats.hashBlock = pcursor->GetBestBlock();
+    {
+        LOCK(cs_main);
+        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+    }
+    ss << stats.hashBlock;
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyStats(stats, ss, prevkey, outputs);
+                outputs.clear();
+            }
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
+        } else {
+            return error("%s: unable to read value", __func__);
+        }
+        pcursor->Next();
+    }
+    if (!outputs.empty()) {
+        ApplyStats(stats, ss, prevkey, outputs);
+    }
+    stats.hashSerialized = ss.GetHash();
+    stats.nDiskSize = view->EstimateSize();
+    return true;
+}
+
+static std::vector<unsigned char> SerializeCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    std::vector<unsigned char> vch;
+    const uint32_t nCode = coin.nHeight * 4 + (coin.fCoinBase ? 2 : 0) + (coin.fCoinStake ? 1 : 0);
+    CVectorWriter(SER_DISK, PROTOCOL_VERSION, vch, 0, outpoint, VARINT(nCode), coin.out);
+    return vch;
+}
+
+void CUTXOStatsAccumulator::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Insert(SerializeCoin(outpoint, coin));
+    nTransactionOutputs++;
+    nTotalAmount += coin.out.nValue;
+}
+
+void CUTXOStatsAccumulator::RemoveCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Remove(SerializeCoin(outpoint, coin));
+    nTransactionOutputs--;
+    nTotalAmount -= coin.out.nValue;
+}
+
+void CUTXOStatsAccumulator::ConnectTx(const CTransaction& tx, const CTxUndo* txundo, int nTxHeight)
+{
+    if (txundo) {
+        assert(txundo->vprevout.size() == tx.vin.size());
+        for (size_t i = 0; i < tx.vin.size(); i++) {
+            RemoveCoin(tx.vin[i].prevout, txundo->vprevout[i]);
+        }
+    }
+    // same outputs as AddCoins
+    const uint256& txid = tx.GetHash();
+    const bool fCoinBase = tx.IsCoinBase();
+    const bool fCoinStake = tx.IsCoinStake();
+    for (size_t i = 0; i < tx.vout.size(); i++) {
+        if (!tx.vout[i].scriptPubKey.IsUnspendable()) {
+            AddCoin(COutPoint(txid, i), Coin(tx.vout[i], nTxHeight, fCoinBase, fCoinStake));
+        }
+    }
+}
+
+void CUTXOStatsAccumulator::SetBestBlock(const CBlockIndex* pindex)
+{
+    hashBlock = pindex ? pindex->GetBlockHash() : UINT256_ZERO;
+    nHeight = pindex ? pindex->nHeight : -1;
+    nShieldAmount = (pindex && pindex->nChainSaplingValue) ? *pindex->nChainSaplingValue : 0;
+}
+
+CUTXOStats CUTXOStatsAccumulator::GetStats(bool fMuHash) const
+{
+    CUTXOStats stats;
+    stats.hashBlock = hashBlock;
+    stats.nTransactionOutputs = nTransactionOutputs;
+    stats.nTotalAmount = nTotalAmount;
+    stats.nShieldAmount = nShieldAmount;
+    if (fMuHash) {
+        muhash.Finalize(stats.hashMuHash);
+    }
+    return stats;
+}
+
+CUTXOStatsDB::CUTXOStatsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "coinstats", nCacheSize, fMemory, fWipe) {}
+
+bool CUTXOStatsDB::ReadStats(int nHeight, CUTXOStats& stats) const
+{
+    return Read(std::make_pair(DB_UTXO_STATS, nHeight), stats);
+}
+
+bool CUTXOStatsDB::ReadTip(CUTXOStatsAccumulator& tip) const
+{
+    return Read(DB_UTXO_TIP, tip);
+}
+
+bool CUTXOStatsDB::WriteStats(const std::map<int, CUTXOStats>& mapStats, const CUTXOStatsAccumulator& tip)
+{
+    CDBBatch batch;
+    for (const auto& it : mapStats) {
+        batch.Write(std::make_pair(DB_UTXO_STATS, it.first), it.second);
+    }
+    batch.Write(DB_UTXO_TIP, tip);
+    return WriteBatch(batch, true);
+}
+
+CUTXOStatsTracker::CUTXOStatsTracker(size_t nCacheSize, bool fMemory, bool fWipe) :
+        db(nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CUTXOStatsTracker::Init(CCoinsView* view)
+{
+    LOCK2(cs_main, cs);
+    const uint256& hashBest = view->GetBestBlock();
+    if (!db.ReadTip(accTip) || accTip.hashBlock != hashBest) {
+        // First start with the stats, or unclean shutdown between the coins and the stats flushes
+        LogPrintf("%s: rebuilding UTXO set statistics at block %s...\n", __func__, hashBest.GetHex());
+        accTip = CUTXOStatsAccumulator();
+        if (!hashBest.IsNull()) {
+            std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+            while (pcursor->Valid()) {
+                boost::this_thread::interruption_point();
+                COutPoint key;
+                Coin coin;
+                if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+                    return error("%s: unable to read coin", __func__);
+                }
+                accTip.AddCoin(key, coin);
+                pcursor->Next();
+            }
+        }
+        const CBlockIndex* pindex = nullptr;
+        if (!hashBest.IsNull()) {
+            BlockMap::const_iterator it = mapBlockIndex.find(hashBest);
+            if (it == mapBlockIndex.end()) {
+                return error("%s: best block %s of the coins database not found", __func__, hashBest.GetHex());
+            }
+            pindex = it->second;
+        }
+        accTip.SetBestBlock(pindex);
+        mapUnflushed.clear();
+        if (pindex) {
+            mapUnflushed.emplace(pindex->nHeight, accTip.GetStats(true));
+        }
+        if (!db.WriteStats(mapUnflushed, accTip)) {
+            return error("%s: failed to write UTXO set statistics", __func__);
+        }
+        mapUnflushed.clear();
+        LogPrintf("%s: %u unspent outputs, total amount %s\n", __func__, accTip.nTransactionOutputs, FormatMoney(accTip.nTotalAmount));
+    }
+    statsTip = accTip.GetStats(false);
+    return true;
+}
+
+CUTXOStatsAccumulator CUTXOStatsTracker::GetTip() const
+{
+    LOCK(cs);
+    return accTip;
+}
+
+void CUTXOStatsTracker::SetTip(const CUTXOStatsAccumulator& tip, const CBlockIndex* pindex, bool fConnected)
+{
+    LOCK(cs);
+    accTip = tip;
+    accTip.SetBestBlock(pindex);
+    // Finalizing the MuHash for every block would slow down the initial sync
+    statsTip = accTip.GetStats(fConnected && !IsInitialBlockDownload());
+    if (fConnected) {
+        mapUnflushed[pindex->nHeight] = statsTip;
+    } else {
+        mapUnflushed.erase(mapUnflushed.upper_bound(pindex->nHeight), mapUnflushed.end());
+    }
+}
+
+bool CUTXOStatsTracker::LookUpStats(const CBlockIndex* pindex, CUTXOStats& stats) const
+{
+    LOCK(cs);
+    if (pindex->GetBlockHash() == statsTip.hashBlock) {
+        if (statsTip.hashMuHash.IsNull()) {
+            accTip.muhash.Finalize(statsTip.hashMuHash);
+        }
+        stats = statsTip;
+        return true;
+    }
+    auto it = mapUnflushed.find(pindex->nHeight);
+    if (it != mapUnflushed.end()) {
+        stats = it->second;
+    } else if (!db.ReadStats(pindex->nHeight, stats)) {
+        return false;
+    }
+    return stats.hashBlock == pindex->GetBlockHash();
+}
+
+bool CUTXOStatsTracker::Flush()
+{
+    LOCK(cs);
+    // keep the MuHash of the tip if it was computed since it was connected
+    auto it = mapUnflushed.find(accTip.nHeight);
+    if (it != mapUnflushed.end() && it->second.hashBlock == statsTip.hashBlock) {
+        it->second.hashMuHash = statsTip.hashMuHash;
+    }
+    if (!db.WriteStats(mapUnflushed, accTip)) {
+        return error("%s: failed to write UTXO set statistics", __func__);
+    }
+    mapUnflushed.clear();
+    return true;
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSTATS_H
+#define BITCOIN_COINSTATS_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "dbwrapper.h"
+#include "serialize.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <map>
+
+class CBlockIndex;
+class CCoinsView;
+class COutPoint;
+class CTransaction;
+class CTxUndo;
+class Coin;
+
+/** Statistics about the unspent transaction output set, computed by a full scan of a coins view */
+struct CCoinsStats
+{
+    int nHeight{0};
+    uint256 hashBlock{UINT256_ZERO};
+    uint64_t nTransactions{0};
+    uint64_t nTransactionOutputs{0};
+    uint256 hashSerialized{UINT256_ZERO};
+    uint64_t nDiskSize{0};
+    CAmount nTotalAmount{0};
+};
+
+//! Calculate statistics about the unspent transaction output set (slow: reads the whole set)
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats);
+
+/** Statistics about the unspent transaction output set after a block of the active chain */
+struct CUTXOStats
+{
+    uint256 hashBlock;
+    uint64_t nTransactionOutputs{0};
+    CAmount nTotalAmount{0};
+    CAmount nShieldAmount{0};
+    //! MuHash of the set, null if it was not computed for this block (initial block download)
+    uint256 hashMuHash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        READWRITE(VARINT(nTransactionOutputs));
+        READWRITE(nTotalAmount);
+        READWRITE(nShieldAmount);
+        READWRITE(hashMuHash);
+    }
+};
+
+/**
+ * Running statistics of an unspent transaction output set, updated one
+ * coin at a time by ConnectBlock and DisconnectBlock.
+ */
+class CUTXOStatsAccumulator
+{
+public:
+    uint256 hashBlock;
+    int nHeight{-1};
+    uint64_t nTransactionOutputs{0};
+    CAmount nTotalAmount{0};
+    CAmount nShieldAmount{0};
+    MuHash3072 muhash;
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+    /** Spend the inputs of tx (from their undo data) and add its spendable outputs */
+    void ConnectTx(const CTransaction& tx, const CTxUndo* txundo, int nTxHeight);
+    /** The set is now the one after the block pindex */
+    void SetBestBlock(const CBlockIndex* pindex);
+
+    /** Summary of the set, with the MuHash if fMuHash (a modular inversion, a few ms) */
+    CUTXOStats GetStats(bool fMuHash) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(VARINT(nTransactionOutputs));
+        READWRITE(nTotalAmount);
+        READWRITE(nShieldAmount);
+        READWRITE(muhash);
+    }
+};
+
+/** Access to the UTXO set statistics database (coinstats) */
+class CUTXOStatsDB : public CDBWrapper
+{
+public:
+    CUTXOStatsDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CUTXOStatsDB(const CUTXOStatsDB&);
+    void operator=(const CUTXOStatsDB&);
+
+public:
+    bool ReadStats(int nHeight, CUTXOStats& stats) const;
+    bool ReadTip(CUTXOStatsAccumulator& tip) const;
+    /** Write the stats of the blocks in mapStats and the running statistics of the tip */
+    bool WriteStats(const std::map<int, CUTXOStats>& mapStats, const CUTXOStatsAccumulator& tip);
+};
+
+/**
+ * UTXO set statistics of the active chain, kept in step with pcoinsTip so
+ * that gettxoutsetinfo and getsupplyinfo do not need to read the coins
+ * database.
+ * The statistics after each connected block are written, keyed by height,
+ * when the coins cache is flushed, together with the running statistics of
+ * the tip: the database always matches the chainstate on disk.
+ */
+class CUTXOStatsTracker
+{
+public:
+    CUTXOStatsTracker(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Load the statistics of view's best block, with a full scan of the view if they are missing or stale */
+    bool Init(CCoinsView* view);
+
+    /** Running statistics of the tip */
+    CUTXOStatsAccumulator GetTip() const;
+    /** Make tip the running statistics after pindex, the new tip of the active chain (connected or disconnected) */
+    void SetTip(const CUTXOStatsAccumulator& tip, const CBlockIndex* pindex, bool fConnected);
+
+    /** Stats after the block pindex of the active chain. Returns false if they are not known. */
+    bool LookUpStats(const CBlockIndex* pindex, CUTXOStats& stats) const;
+
+    /** Write the statistics of the blocks connected since the last flush. Called once the coins are flushed. */
+    bool Flush();
+
+private:
+    mutable RecursiveMutex cs;
+    CUTXOStatsDB db;
+    CUTXOStatsAccumulator accTip;
+    //! Stats of the tip, with the MuHash once it has been computed
+    mutable CUTXOStats statsTip;
+    //! Stats of the blocks connected since the last flush
+    std::map<int, CUTXOStats> mapUnflushed;
+};
+
+extern CUTXOStatsTracker* putxostats;
+
+#endif // BITCOIN_COINSTATS_H
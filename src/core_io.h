@@ -13,6 +13,7 @@
 class CBlock;
 class CScript;
 class CTransaction;
+class CTxUndo;
 struct CMutableTransaction;
 class uint256;
 class UniValue;
@@ -30,6 +31,6 @@ extern std::vector<unsigned char> ParseHexUV(const UniValue& v, const std::strin
 extern std::string FormatScript(const CScript& script);
 extern std::string EncodeHexTx(const CTransaction& tx);
 extern void ScriptPubKeyToUniv(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
-extern void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry);
+extern void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry, const CTxUndo* txundo = nullptr);
 
 #endif // BITCOIN_CORE_IO_H
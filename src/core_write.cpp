@@ -7,12 +7,14 @@
 #include "core_io.h"
 
 #include "base58.h"
+#include "coins.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "sapling/sapling_core_write.h"
 #include "serialize.h"
 #include "streams.h"
+#include "undo.h"
 #include <univalue.h>
 #include "util.h"
 #include "utilmoneystr.h"
@@ -159,7 +161,7 @@ static void SpecialTxToJSON(const CTransaction& tx, UniValue& entry)
     }
 }
 
-void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
+void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry, const CTxUndo* txundo)
 {
     entry.pushKV("txid", tx.GetHash().GetHex());
     entry.pushKV("version", tx.nVersion);
@@ -167,8 +169,13 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
     entry.pushKV("size", (int)::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
     entry.pushKV("locktime", (int64_t)tx.nLockTime);
 
+    // Spent coins are only known from the block undo data
+    const bool fHaveUndo = txundo && !tx.IsCoinBase() && txundo->vprevout.size() == tx.vin.size();
+    CAmount nValueIn = 0;
+
     UniValue vin(UniValue::VARR);
-    for (const CTxIn& txin : tx.vin) {
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        const CTxIn& txin = tx.vin[i];
         UniValue in(UniValue::VOBJ);
         if (tx.IsCoinBase())
             in.pushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
@@ -179,6 +186,18 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
             o.pushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
             o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
             in.pushKV("scriptSig", o);
+            if (fHaveUndo) {
+                const Coin& prevcoin = txundo->vprevout[i];
+                nValueIn += prevcoin.out.nValue;
+                UniValue prevout(UniValue::VOBJ);
+                prevout.pushKV("value", UniValue(UniValue::VNUM, FormatMoney(prevcoin.out.nValue)));
+                prevout.pushKV("height", (int64_t)prevcoin.nHeight);
+                prevout.pushKV("generated", prevcoin.IsCoinBase() || prevcoin.IsCoinStake());
+                UniValue p(UniValue::VOBJ);
+                ScriptPubKeyToUniv(prevcoin.out.scriptPubKey, p, true);
+                prevout.pushKV("scriptPubKey", p);
+                in.pushKV("prevout", prevout);
+            }
         }
         in.pushKV("sequence", (int64_t)txin.nSequence);
         vin.push_back(in);
@@ -202,6 +221,12 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
     }
     entry.pushKV("vout", vout);
 
+    // The coinstake creates the stake reward, it pays no fee
+    if (fHaveUndo && !tx.IsCoinStake()) {
+        const CAmount nFee = nValueIn + tx.GetShieldedValueIn() - tx.GetValueOut();
+        entry.pushKV("fee", UniValue(UniValue::VNUM, FormatMoney(nFee)));
+    }
+
     // Sapling
     TxSaplingToJSON(tx, entry);
 
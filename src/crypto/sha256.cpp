@@ -9,6 +9,33 @@
 #include <string.h>
 #include <stdexcept>
 
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(USE_ASM)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks);
+}
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* chunks);
+}
+#endif
+
+#if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk);
+}
+#endif
+
 // Internal implementation code.
 namespace
 {
@@ -129,6 +156,76 @@ void Transform(uint32_t* s, const unsigned char* chunk)
 }
 
 } // namespace sha256
+
+/** Maximum number of lanes of the multi-lane transforms. */
+static const int MAX_LANES = 8;
+
+typedef void (*TransformType)(uint32_t* s, const unsigned char* chunk);
+typedef void (*TransformMultiType)(uint32_t* s, const unsigned char* const* chunks);
+
+/** Single-stream transform, used by CSHA256 (selected by SHA256AutoDetect). */
+TransformType Transform = sha256::Transform;
+
+/** Multi-lane transform used by SHA256DBatch (nullptr to hash one input at a time). */
+struct BatchTransform
+{
+    TransformMultiType transform{nullptr};
+    int lanes{1};
+} batch;
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+
+/** Double-SHA256 of the lanes inputs of len bytes at in, with a multi-lane transform. */
+void HashLanes(unsigned char* out, const unsigned char* in, size_t len)
+{
+    uint32_t s[8 * MAX_LANES];
+    unsigned char tail[MAX_LANES][128];
+    const unsigned char* chunks[MAX_LANES];
+    const size_t nBlocks = len / 64;
+    const size_t nRemaining = len % 64;
+    const size_t nTailSize = nRemaining < 56 ? 64 : 128;
+
+    // First hash: the full blocks are read directly from the input, the padded tail from a buffer.
+    for (int lane = 0; lane < batch.lanes; lane++) {
+        sha256::Initialize(s + 8 * lane);
+        memset(tail[lane], 0, nTailSize);
+        memcpy(tail[lane], in + lane * len + nBlocks * 64, nRemaining);
+        tail[lane][nRemaining] = 0x80;
+        WriteBE64(tail[lane] + nTailSize - 8, ((uint64_t)len) << 3);
+    }
+    for (size_t b = 0; b < nBlocks; b++) {
+        for (int lane = 0; lane < batch.lanes; lane++) chunks[lane] = in + lane * len + b * 64;
+        batch.transform(s, chunks);
+    }
+    for (size_t offset = 0; offset < nTailSize; offset += 64) {
+        for (int lane = 0; lane < batch.lanes; lane++) chunks[lane] = tail[lane] + offset;
+        batch.transform(s, chunks);
+    }
+
+    // Second hash, of the 32-byte first hash (one padded block).
+    for (int lane = 0; lane < batch.lanes; lane++) {
+        for (int i = 0; i < 8; i++) WriteBE32(tail[lane] + 4 * i, s[8 * lane + i]);
+        memset(tail[lane] + 32, 0, 32);
+        tail[lane][32] = 0x80;
+        WriteBE64(tail[lane] + 56, 256);
+        sha256::Initialize(s + 8 * lane);
+        chunks[lane] = tail[lane];
+    }
+    batch.transform(s, chunks);
+
+    for (int lane = 0; lane < batch.lanes; lane++) {
+        for (int i = 0; i < 8; i++) WriteBE32(out + 32 * lane + 4 * i, s[8 * lane + i]);
+    }
+}
+
 } // namespace
 
 
@@ -148,12 +245,12 @@ CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
         memcpy(buf + bufsize, data, 64 - bufsize);
         bytes += 64 - bufsize;
         data += 64 - bufsize;
-        sha256::Transform(s, buf);
+        Transform(s, buf);
         bufsize = 0;
     }
     while (end >= data + 64) {
         // Process full chunks directly from the source.
-        sha256::Transform(s, data);
+        Transform(s, data);
         bytes += 64;
         data += 64;
     }
@@ -197,3 +294,85 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation)
+{
+    std::string ret = "standard";
+    Transform = sha256::Transform;
+    batch = BatchTransform();
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    uint32_t eax, ebx, ecx, edx;
+    __cpuid(1, eax, ebx, ecx, edx);
+    bool have_sse41 = (ecx >> 19) & 1;
+    const bool have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled(); // OSXSAVE, AVX
+    bool have_avx2 = false;
+    bool have_shani = false;
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = have_avx && ((ebx >> 5) & 1);
+        have_shani = (ebx >> 29) & 1;
+    }
+    have_sse41 = have_sse41 && (use_implementation & sha256_implementation::USE_SSE41);
+    have_avx2 = have_avx2 && (use_implementation & sha256_implementation::USE_AVX2);
+    have_shani = have_shani && (use_implementation & sha256_implementation::USE_SHANI);
+
+#if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_shani) {
+        // One SHA-NI stream is faster than the multi-lane transforms
+        Transform = sha256_shani::Transform;
+        ret = "shani(1way)";
+        have_sse41 = false;
+        have_avx2 = false;
+    }
+#endif
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse41) {
+        batch.transform = sha256_sse41::Transform_4way;
+        batch.lanes = 4;
+        ret += ",sse41(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2) {
+        batch.transform = sha256_avx2::Transform_8way;
+        batch.lanes = 8;
+        ret += ",avx2(8way)";
+    }
+#endif
+    (void)have_sse41;
+    (void)have_avx2;
+    (void)have_shani;
+#endif
+    return ret;
+}
+
+void SHA256DBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count)
+{
+    if (batch.transform) {
+        while (count >= (size_t)batch.lanes) {
+            HashLanes(output, input, len);
+            output += 32 * batch.lanes;
+            input += len * batch.lanes;
+            count -= batch.lanes;
+        }
+    }
+    // Remaining inputs, one at a time
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    while (count > 0) {
+        CSHA256().Write(input, len).Finalize(hash);
+        CSHA256().Write(hash, CSHA256::OUTPUT_SIZE).Finalize(output);
+        output += 32;
+        input += len;
+        count--;
+    }
+}
+
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks)
+{
+    SHA256DBatch(output, input, 64, blocks);
+}
+
+int SHA256DBatchLanes()
+{
+    return batch.lanes;
+}
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -26,4 +27,35 @@ public:
     CSHA256& Reset();
 };
 
+namespace sha256_implementation {
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_SSE41 = 1 << 0,
+    USE_AVX2 = 1 << 1,
+    USE_SHANI = 1 << 2,
+    USE_ALL = USE_SSE41 | USE_AVX2 | USE_SHANI,
+};
+}
+
+/** Autodetect the best available SHA256 implementation (among those allowed by use_implementation).
+ *  Returns the name of the implementation.
+ *  To be called at startup, before any hashing (it is not thread safe). */
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
+
+/** Compute the double-SHA256 of count inputs of len bytes each, laid out contiguously
+ *  in input, writing the count 32-byte hashes to output.
+ *  Groups of 4 or 8 inputs are hashed at once with the SSE4.1 or AVX2 multi-lane
+ *  transforms, when selected by SHA256AutoDetect. */
+void SHA256DBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
+/** Number of inputs hashed at once by SHA256DBatch (1 without multi-lane support). */
+int SHA256DBatchLanes();
+
 #endif // BITCOIN_CRYPTO_SHA256_H
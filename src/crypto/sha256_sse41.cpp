@@ -0,0 +1,105 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace sha256_sse41 {
+namespace {
+
+__m128i inline K(uint32_t x) { return _mm_set1_epi32(x); }
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z, __m128i w) { return Add(Add(x, y), Add(z, w)); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+__m128i inline ShL(__m128i x, int n) { return _mm_slli_epi32(x, n); }
+__m128i inline RotR(__m128i x, int n) { return Or(ShR(x, n), ShL(x, 32 - n)); }
+
+__m128i inline Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+__m128i inline Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m128i inline Sigma0(__m128i x) { return Xor(RotR(x, 2), RotR(x, 13), RotR(x, 22)); }
+__m128i inline Sigma1(__m128i x) { return Xor(RotR(x, 6), RotR(x, 11), RotR(x, 25)); }
+__m128i inline sigma0(__m128i x) { return Xor(RotR(x, 7), RotR(x, 18), ShR(x, 3)); }
+__m128i inline sigma1(__m128i x) { return Xor(RotR(x, 17), RotR(x, 19), ShR(x, 10)); }
+
+/** One round of SHA-256, on 4 lanes. */
+void inline Round(__m128i a, __m128i b, __m128i c, __m128i& d, __m128i e, __m128i f, __m128i g, __m128i& h, __m128i k)
+{
+    __m128i t1 = Add(h, Sigma1(e), Ch(e, f, g), k);
+    __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+    d = Add(d, t1);
+    h = Add(t1, t2);
+}
+
+/** Message schedule: word i (>= 16) of the expanded block, w being the last 16 words. */
+__m128i inline Expand(__m128i* w, int i)
+{
+    return w[i & 15] = Add(sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]), w[i & 15]);
+}
+
+const uint32_t RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+__m128i inline Read4(const unsigned char* const* chunks, int offset)
+{
+    return _mm_set_epi32(ReadBE32(chunks[3] + offset), ReadBE32(chunks[2] + offset), ReadBE32(chunks[1] + offset), ReadBE32(chunks[0] + offset));
+}
+
+} // namespace
+
+/** Perform one SHA-256 transformation on 4 independent states (stored one after the other in s),
+ *  processing a 64-byte chunk for each of them. */
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks)
+{
+    __m128i v[8];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm_set_epi32(s[24 + i], s[16 + i], s[8 + i], s[i]);
+    }
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    __m128i w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = Read4(chunks, 4 * i);
+    }
+
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(RoundConstants[i + 0]), i < 16 ? w[i + 0] : Expand(w, i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(RoundConstants[i + 1]), i < 16 ? w[i + 1] : Expand(w, i + 1)));
+        Round(g, h, a, b, c, d, e, f, Add(K(RoundConstants[i + 2]), i < 16 ? w[i + 2] : Expand(w, i + 2)));
+        Round(f, g, h, a, b, c, d, e, Add(K(RoundConstants[i + 3]), i < 16 ? w[i + 3] : Expand(w, i + 3)));
+        Round(e, f, g, h, a, b, c, d, Add(K(RoundConstants[i + 4]), i < 16 ? w[i + 4] : Expand(w, i + 4)));
+        Round(d, e, f, g, h, a, b, c, Add(K(RoundConstants[i + 5]), i < 16 ? w[i + 5] : Expand(w, i + 5)));
+        Round(c, d, e, f, g, h, a, b, Add(K(RoundConstants[i + 6]), i < 16 ? w[i + 6] : Expand(w, i + 6)));
+        Round(b, c, d, e, f, g, h, a, Add(K(RoundConstants[i + 7]), i < 16 ? w[i + 7] : Expand(w, i + 7)));
+    }
+
+    v[0] = Add(v[0], a); v[1] = Add(v[1], b); v[2] = Add(v[2], c); v[3] = Add(v[3], d);
+    v[4] = Add(v[4], e); v[5] = Add(v[5], f); v[6] = Add(v[6], g); v[7] = Add(v[7], h);
+    for (int i = 0; i < 8; i++) {
+        s[i] = _mm_extract_epi32(v[i], 0);
+        s[8 + i] = _mm_extract_epi32(v[i], 1);
+        s[16 + i] = _mm_extract_epi32(v[i], 2);
+        s[24 + i] = _mm_extract_epi32(v[i], 3);
+    }
+}
+
+} // namespace sha256_sse41
+
+#endif
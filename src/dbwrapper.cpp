@@ -5,6 +5,7 @@
 #include "dbwrapper.h"
 
 #include "util.h"
+#include "utilstrencodings.h"
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -12,15 +13,152 @@
 #include <memenv.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <mutex>
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+#include <boost/algorithm/string.hpp>
+
+//! Databases with a profile, see GetDBProfile
+static const char* const DB_PROFILE_NAMES[] = {"chainstate", "index", "sporks", "coinstats", "blockstats"};
+
+static bool SetDBProfileOption(CDBProfile& profile, const std::string& strKey, const std::string& strValue)
+{
+    int64_t n;
+    if (!ParseInt64(strValue, &n) || n < 0) return false;
+    if (strKey == "compression") {
+        profile.fCompression = n != 0;
+    } else if (strKey == "maxopenfiles") {
+        if (n < 16 || n > 65536) return false;
+        profile.nMaxOpenFiles = n;
+    } else if (strKey == "blocksize") {
+        if (n < 1024 || n > (1 << 20)) return false;
+        profile.nBlockSize = n;
+    } else if (strKey == "bloombits") {
+        if (n > 32) return false;
+        profile.nBloomBits = n;
+    } else if (strKey == "sharedcache") {
+        profile.fSharedCache = n != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool GetDBProfile(const std::string& strName, CDBProfile& profile, std::string& strError)
+{
+    profile = CDBProfile();
+    if (strName == "chainstate") {
+        // Random reads of small coins spread over the whole database: keep
+        // more tables open, and read larger blocks per table access
+        profile.nMaxOpenFiles = 128;
+        profile.nBlockSize = 16 << 10;
+    } else if (strName == "index") {
+        // The block index entries compress well and are read once at startup
+        profile.fCompression = DB_HAVE_SNAPPY;
+    }
+
+    for (const std::string& strArg : gArgs.GetArgs("-dbprofile")) {
+        if (strArg.empty()) continue;
+        const size_t nColon = strArg.find(':');
+        if (nColon == std::string::npos) {
+            strError = strprintf("Invalid -dbprofile '%s', expected <database>:<option>=<value>[,<option>=<value>...]", strArg);
+            return false;
+        }
+        if (strArg.substr(0, nColon) != strName) continue;
+        std::vector<std::string> vOptions;
+        boost::split(vOptions, strArg.substr(nColon + 1), boost::is_any_of(","));
+        for (const std::string& strOption : vOptions) {
+            const size_t nEqual = strOption.find('=');
+            if (nEqual == std::string::npos || !SetDBProfileOption(profile, strOption.substr(0, nEqual), strOption.substr(nEqual + 1))) {
+                strError = strprintf("Invalid -dbprofile option '%s' for the %s database", strOption, strName);
+                return false;
+            }
+        }
+    }
+    // LevelDB stores the blocks uncompressed without Snappy: report the effective setting
+    profile.fCompression = profile.fCompression && DB_HAVE_SNAPPY;
+    return true;
+}
+
+bool CheckDBProfileArgs(std::string& strError)
+{
+    for (const std::string& strArg : gArgs.GetArgs("-dbprofile")) {
+        if (strArg.empty()) continue;
+        const std::string strName = strArg.substr(0, strArg.find(':'));
+        if (std::find(std::begin(DB_PROFILE_NAMES), std::end(DB_PROFILE_NAMES), strName) == std::end(DB_PROFILE_NAMES)) {
+            strError = strprintf("Unknown database '%s' in -dbprofile", strName);
+            return false;
+        }
+    }
+    CDBProfile profile;
+    for (const char* strName : DB_PROFILE_NAMES) {
+        if (!GetDBProfile(strName, profile, strError)) return false;
+    }
+    return true;
+}
+
+int GetDBProfilesExtraOpenFiles()
+{
+    int nExtra = 0;
+    CDBProfile profile;
+    std::string strError;
+    for (const char* strName : DB_PROFILE_NAMES) {
+        if (GetDBProfile(strName, profile, strError)) {
+            nExtra += std::max(0, profile.nMaxOpenFiles - CDBProfile().nMaxOpenFiles);
+        }
+    }
+    return nExtra;
+}
+
+static std::mutex cs_databases;
+//! The open databases, for getdbinfo
+static std::vector<const CDBWrapper*> vDatabases;
+//! The shared block cache, alive while a database uses it
+static std::weak_ptr<leveldb::Cache> g_shared_cache;
+
+static std::shared_ptr<leveldb::Cache> GetSharedBlockCache()
+{
+    const int64_t nSize = gArgs.GetArg("-dbsharedcache", DEFAULT_DB_SHARED_CACHE);
+    if (nSize <= 0) return nullptr;
+    std::lock_guard<std::mutex> lock(cs_databases);
+    std::shared_ptr<leveldb::Cache> cache = g_shared_cache.lock();
+    if (!cache) {
+        cache.reset(leveldb::NewLRUCache(nSize << 20));
+        g_shared_cache = cache;
+    }
+    return cache;
+}
+
+void GetSharedDBCacheInfo(size_t& nCapacity, size_t& nUsage)
+{
+    nCapacity = nUsage = 0;
+    std::lock_guard<std::mutex> lock(cs_databases);
+    std::shared_ptr<leveldb::Cache> cache = g_shared_cache.lock();
+    if (cache) {
+        nCapacity = gArgs.GetArg("-dbsharedcache", DEFAULT_DB_SHARED_CACHE) << 20;
+        nUsage = cache->TotalCharge();
+    }
+}
+
+std::vector<CDBInfo> GetAllDBInfo()
+{
+    std::vector<CDBInfo> vInfo;
+    std::lock_guard<std::mutex> lock(cs_databases);
+    for (const CDBWrapper* pdbw : vDatabases) {
+        vInfo.push_back(pdbw->GetInfo());
+    }
+    return vInfo;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBProfile& profile, leveldb::Cache* pSharedCache)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    options.block_cache = pSharedCache ? pSharedCache : leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.filter_policy = profile.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(profile.nBloomBits) : nullptr;
+    options.compression = profile.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = profile.nMaxOpenFiles;
+    options.block_size = profile.nBlockSize;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -29,14 +167,22 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CDBWrapper::CDBWrapper(const fs::path& pathIn, size_t nCacheSize, bool fMemoryIn, bool fWipe) :
+        strName(pathIn.filename().string()), path(pathIn), fMemory(fMemoryIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    std::string strError;
+    if (!GetDBProfile(strName, profile, strError)) {
+        // checked at startup (CheckDBProfileArgs)
+        LogPrintf("%s, using the defaults\n", strError);
+        profile = CDBProfile();
+    }
+    if (profile.fSharedCache) shared_cache = GetSharedBlockCache();
+    options = GetOptions(nCacheSize, profile, shared_cache.get());
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -53,15 +199,21 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    std::lock_guard<std::mutex> lock(cs_databases);
+    vDatabases.push_back(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::lock_guard<std::mutex> lock(cs_databases);
+        vDatabases.erase(std::remove(vDatabases.begin(), vDatabases.end(), this), vDatabases.end());
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
     options.filter_policy = NULL;
-    delete options.block_cache;
+    if (!shared_cache) delete options.block_cache;
     options.block_cache = NULL;
     delete penv;
     options.env = NULL;
@@ -81,6 +233,27 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBInfo CDBWrapper::GetInfo() const
+{
+    CDBInfo info;
+    info.strName = strName;
+    info.strPath = path.string();
+    info.fMemory = fMemory;
+    info.profile = profile;
+    info.nBlockCacheSize = shared_cache ? 0 : options.block_cache->TotalCharge();
+    info.nWriteBufferSize = options.write_buffer_size;
+    // All the keys start with a printable prefix character
+    const std::string strLast(8, '\xff');
+    const leveldb::Range range{leveldb::Slice(), leveldb::Slice(strLast)};
+    uint64_t nSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &nSize);
+    info.nApproximateSize = nSize;
+    std::string strValue;
+    info.nMemoryUsage = pdb->GetProperty("leveldb.approximate-memory-usage", &strValue) ? atoi64(strValue) : 0;
+    pdb->GetProperty("leveldb.stats", &info.strStats);
+    return info;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
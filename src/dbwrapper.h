@@ -16,9 +16,76 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+#include <vector>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! -dbsharedcache default (MiB): each database has its own block cache
+static const int64_t DEFAULT_DB_SHARED_CACHE = 0;
+//! Whether the bundled LevelDB is built with Snappy (it is not, see HAVE_SNAPPY in Makefile.leveldb.include)
+static const bool DB_HAVE_SNAPPY = false;
+
+namespace leveldb {
+class Cache;
+}
+
+/**
+ * LevelDB settings of a database. The defaults of each database are set by
+ * GetDBProfile, and can be changed with -dbprofile.
+ */
+struct CDBProfile
+{
+    //! Snappy compression of the table blocks (always off if LevelDB is built without Snappy)
+    bool fCompression{false};
+    int nMaxOpenFiles{64};
+    //! Approximate size of the (uncompressed) table blocks, in bytes
+    size_t nBlockSize{4 << 10};
+    //! Bits per key of the bloom filters, 0 for none
+    int nBloomBits{10};
+    //! Use the block cache shared by the databases when -dbsharedcache is set
+    bool fSharedCache{true};
+};
+
+/**
+ * Settings of the database named strName (the name of its directory:
+ * chainstate, index, sporks, ...), with the -dbprofile=<name>:... options
+ * applied. Returns false, with strError set, if one of them is invalid.
+ */
+bool GetDBProfile(const std::string& strName, CDBProfile& profile, std::string& strError);
+
+//! Check the -dbprofile options of all the databases
+bool CheckDBProfileArgs(std::string& strError);
+
+/**
+ * Open files the database profiles allow beyond the default maxopenfiles of
+ * each database, reserved on top of the file descriptors of the core.
+ */
+int GetDBProfilesExtraOpenFiles();
+
+/** State of an open database, for the getdbinfo RPC */
+struct CDBInfo
+{
+    std::string strName;
+    std::string strPath;
+    bool fMemory;
+    CDBProfile profile;
+    //! Size of the block cache of the database (0 if it uses the shared one)
+    size_t nBlockCacheSize;
+    size_t nWriteBufferSize;
+    //! Approximate size of all the entries on disk
+    uint64_t nApproximateSize;
+    //! "leveldb.approximate-memory-usage"
+    uint64_t nMemoryUsage;
+    //! "leveldb.stats": files, size and compaction time by level
+    std::string strStats;
+};
+
+//! Information about all the open databases
+std::vector<CDBInfo> GetAllDBInfo();
+
+//! Capacity and usage of the shared block cache (zeros if -dbsharedcache is not set)
+void GetSharedDBCacheInfo(size_t& nCapacity, size_t& nUsage);
 
 
 class dbwrapper_error : public std::runtime_error
@@ -196,6 +263,14 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! the name of the database (its directory), the settings of its profile
+    std::string strName;
+    fs::path path;
+    bool fMemory;
+    CDBProfile profile;
+    //! the shared block cache, when the database uses it
+    std::shared_ptr<leveldb::Cache> shared_cache;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -291,6 +366,8 @@ public:
     */
     bool IsEmpty();
 
+    CDBInfo GetInfo() const;
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
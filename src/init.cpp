@@ -18,11 +18,15 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockstatsindex.h"
+#include "coinsprefetch.h"
+#include "coinstats.h"
 #include "budget/budgetdb.h"
 #include "budget/budgetmanager.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
+#include "crypto/sha256.h"
 #include "fs.h"
 #include "guiinterface.h"
 #include "guiinterfaceutil.h"
@@ -38,9 +42,11 @@
 #include "netbase.h"
 #include "policy/feerate.h"
 #include "policy/policy.h"
+#include "reindex.h"
 #include "reverse_iterate.h"
 #include "rpc/register.h"
 #include "rpc/server.h"
+#include "sapling/sapling_validation.h"
 #include "scheduler.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
@@ -286,15 +292,25 @@ void PrepareShutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        delete pcoinsPrefetch;
+        pcoinsPrefetch = nullptr;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
+        delete pcoinsWriter;
+        pcoinsWriter = nullptr;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
+        delete putxostats;
+        putxostats = NULL;
         delete pblocktree;
         pblocktree = NULL;
         delete pSporkDB;
         pSporkDB = NULL;
     }
+    if (g_blockstatsindex) {
+        UnregisterValidationInterface(g_blockstatsindex.get());
+        g_blockstatsindex.reset();
+    }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         bitdb.Flush(true);
@@ -420,6 +436,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
+    strUsage += HelpMessageOpt("-blockstatsindex", strprintf(_("Maintain an index of per-block fee and size statistics, used by the getblockindexstats and getfeeinfo rpc calls (default: %u)"), DEFAULT_BLOCKSTATSINDEX));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), C_Note_CONF_FILENAME));
     if (mode == HMM_BITCOIND) {
@@ -435,10 +452,16 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)"), DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf(_("Disable OS notifications for incoming transactions (default: %u)"), 0));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbsharedcache=<n>", strprintf(_("Use a single block cache of <n> megabytes, taken from -dbcache, for all the databases (default: %d, a cache per database)"), DEFAULT_DB_SHARED_CACHE));
+    strUsage += HelpMessageOpt("-dbprofile=<db>:<opt>=<n>[,...]", _("Set LevelDB options of the database <db> (chainstate, index, sporks, coinstats or blockstats): compression (0/1, no effect as LevelDB is built without Snappy), maxopenfiles (file descriptors are reserved for them, at the expense of -maxconnections), blocksize (bytes), bloombits, sharedcache (0/1). Can be specified multiple times"));
+    strUsage += HelpMessageOpt("-prefetchthreads=<n>", strprintf(_("Number of threads reading the coins spent by the next blocks ahead of their connection (0 to %d, default: %d)"), MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS));
+    strUsage += HelpMessageOpt("-prefetchblocks=<n>", strprintf(_("Number of blocks ahead of the one being connected to prefetch the coins of (default: %d)"), DEFAULT_PREFETCH_BLOCKS));
+    strUsage += HelpMessageOpt("-backgroundflush", strprintf(_("Write the UTXO set to disk from a background thread, keeping the cache warm between the writes (default: %u)"), DEFAULT_BACKGROUND_FLUSH));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-maxvalidationqueue=<n>", strprintf(_("Stop connecting blocks while more than <n> notifications wait for the wallet and other subscribers (default: %u)"), DEFAULT_VALIDATION_QUEUE_LIMIT));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
@@ -446,6 +469,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), C_Note_PID_FILENAME));
 #endif
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-reindexthreads=<n>", strprintf(_("Number of threads deserializing and checking the blocks read by -reindex, ahead of their connection (0 to %d, default: %d, 0 = read and connect them one at a time)"), MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS));
+    strUsage += HelpMessageOpt("-reindexbuffer=<n>", strprintf(_("Keep up to <n> megabytes of out of order blocks in memory during -reindex with -reindexthreads, instead of reading them again from disk (default: %d)"), DEFAULT_REINDEX_BUFFER));
     strUsage += HelpMessageOpt("-resync", _("Delete blockchain folders and resync from scratch") + " " + _("on startup"));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
@@ -469,6 +494,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandthreads=<n>", strprintf(_("Number of threads processing the masternode and budget relay messages concurrently with the other messages (0-%d, default: %d)"), MAX_MSGHAND_THREADS, DEFAULT_MSGHAND_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -477,6 +503,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsModes(), SocketEventsModeToString(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -535,6 +562,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf(_("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf(_("Require high priority for relaying free or low-fee transactions (default:%u)"), DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(_("Limit size of signature cache to <n> MiB (default: %u)"), DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxsaplingcachesize=<n>", strprintf(_("Limit size of Sapling proofs cache to <n> MiB (default: %u)"), DEFAULT_MAX_SAPLING_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/Kb) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"), CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -662,17 +690,32 @@ void ThreadImport(const std::vector<fs::path>& vImportFiles)
     // -reindex
     if (fReindex) {
         CImportingNow imp;
-        int nFile = 0;
-        while (true) {
-            CDiskBlockPos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos, "blk")))
-                break; // No block files left to reindex
-            FILE* file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(file, &pos);
-            nFile++;
+        bool fReindexed = true;
+        int nReindexThreads = gArgs.GetArg("-reindexthreads", DEFAULT_REINDEX_THREADS);
+        if (nReindexThreads > 0) {
+            nReindexThreads = std::min(nReindexThreads, MAX_REINDEX_THREADS);
+            const int64_t nReindexBuffer = std::max((int64_t)0, gArgs.GetArg("-reindexbuffer", DEFAULT_REINDEX_BUFFER));
+            LogPrintf("Reindexing with %d threads deserializing and checking the blocks\n", nReindexThreads);
+            CReindexPipeline pipeline(nReindexThreads, nReindexBuffer << 20);
+            fReindexed = pipeline.Run();
+        } else {
+            int nFile = 0;
+            while (!ShutdownRequested()) {
+                CDiskBlockPos pos(nFile, 0);
+                if (!fs::exists(GetBlockPosFilename(pos, "blk")))
+                    break; // No block files left to reindex
+                FILE* file = OpenBlockFile(pos, true);
+                if (!file)
+                    break; // This error is logged in OpenBlockFile
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                LoadExternalBlockFile(file, &pos);
+                nFile++;
+            }
+        }
+        if (!fReindexed || ShutdownRequested()) {
+            // Keep the reindex flag: it starts over at the next start
+            LogPrintf("Reindexing not finished. Exit %s\n", __func__);
+            return;
         }
         pblocktree->WriteReindexing(false);
         fReindex = false;
@@ -1030,13 +1073,37 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    std::string strDBProfileError;
+    if (!CheckDBProfileArgs(strDBProfileError))
+        return UIError(strDBProfileError);
+    // Also reserve the LevelDB tables kept open past the default of each database (-dbprofile maxopenfiles)
+#ifdef WIN32
+    const int nMinCoreFD = MIN_CORE_FILEDESCRIPTORS;
+#else
+    const int nMinCoreFD = MIN_CORE_FILEDESCRIPTORS + GetDBProfilesExtraOpenFiles();
+#endif
+
+    // Only the select() socket events backend is limited to the sockets below FD_SETSIZE
+    // (an invalid -socketevents is reported in step 11)
+    SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+    if (gArgs.IsArgSet("-socketevents"))
+        ParseSocketEventsMode(gArgs.GetArg("-socketevents", ""), socketEventsMode);
+    const bool fSelectLimit = socketEventsMode == SOCKETEVENTS_SELECT;
+
+    if (fSelectLimit && nMaxConnections > 0 && (int)FD_SETSIZE - nBind - nMinCoreFD <= 0)
+        return UIError(strprintf(_("The -dbprofile maxopenfiles options reserve %d file descriptors, which leaves none for the connections (the limit is %d)."),
+                                 nMinCoreFD - MIN_CORE_FILEDESCRIPTORS, (int)FD_SETSIZE));
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
-    if (nFD < MIN_CORE_FILEDESCRIPTORS)
+    if (fSelectLimit)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - nMinCoreFD)), 0);
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + nMinCoreFD);
+    if (nFD < nMinCoreFD)
         return UIError(_("Not enough file descriptors available."));
-    if (nFD - MIN_CORE_FILEDESCRIPTORS < nMaxConnections)
-        nMaxConnections = nFD - MIN_CORE_FILEDESCRIPTORS;
+    if (nFD - nMinCoreFD < nMaxConnections)
+        nMaxConnections = nFD - nMinCoreFD;
+    if (nMaxConnections < nUserMaxConnections)
+        UIWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
 
     // ********************************************************* Step 3: parameter-to-internal-flags
 
@@ -1201,6 +1268,8 @@ bool AppInitSanityChecks()
     // ********************************************************* Step 4: sanity checks
 
     // Initialize elliptic curve code
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1245,6 +1314,7 @@ bool AppInitMain()
     std::ostringstream strErrors;
 
     InitSignatureCache();
+    SaplingValidation::InitProofCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
@@ -1263,6 +1333,7 @@ bool AppInitMain()
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+    GetMainSignals().SetQueueLimit(std::max<int64_t>(gArgs.GetArg("-maxvalidationqueue", DEFAULT_VALIDATION_QUEUE_LIMIT), 1));
     GetMainSignals().RegisterWithMempoolSignals(mempool);
 
     // Initialize Sapling circuit parameters
@@ -1397,7 +1468,7 @@ bool AppInitMain()
     CConnman& connman = *g_connman;
 
     peerLogic.reset(new PeerLogicValidation(&connman));
-    RegisterValidationInterface(peerLogic.get());
+    RegisterValidationInterface(peerLogic.get(), "peerlogic");
     RegisterNodeSignals(GetNodeSignals());
 
     // sanitize comments per BIP-0014, format user agent and check total size
@@ -1530,7 +1601,7 @@ bool AppInitMain()
     pzmqNotificationInterface = CZMQNotificationInterface::Create();
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        RegisterValidationInterface(pzmqNotificationInterface, "zmq");
     }
 #endif
 
@@ -1545,17 +1616,46 @@ bool AppInitMain()
     int64_t nTotalCache = (gArgs.GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
+    int64_t nSharedDBCache = std::max((int64_t)0, std::min(gArgs.GetArg("-dbsharedcache", DEFAULT_DB_SHARED_CACHE) << 20, nTotalCache / 2));
+    if (nSharedDBCache > 0) {
+        // the shared cache replaces the block caches of the databases, see GetOptions
+        gArgs.ForceSetArg("-dbsharedcache", std::to_string(nSharedDBCache >> 20));
+        nTotalCache -= nSharedDBCache;
+    }
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     if (nBlockTreeDBCache > (1 << 21) && !gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nBlockStatsDBCache = 0;
+    if (gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        nBlockStatsDBCache = std::min(nTotalCache / 8, (int64_t)(1 << 21)); // a few bytes per block, 2 MiB is plenty
+        nTotalCache -= nBlockStatsDBCache;
+    }
+    int64_t nUTXOStatsDBCache = std::min(nTotalCache / 8, (int64_t)(1 << 20)); // written on flush only
+    nTotalCache -= nUTXOStatsDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    // The coins staged by the prefetch threads are part of the in-memory UTXO set budget
+    int64_t nPrefetchCache = 0;
+    if (gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS) > 0) {
+        nPrefetchCache = std::min(nTotalCache / 8, MAX_PREFETCH_CACHE);
+        nCoinCacheUsage -= nPrefetchCache;
+    }
     LogPrintf("Cache configuration:\n");
+    if (nSharedDBCache > 0) {
+        LogPrintf("* Using %.1fMiB for the shared database block cache\n", nSharedDBCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nBlockStatsDBCache > 0) {
+        LogPrintf("* Using %.1fMiB for block stats index database\n", nBlockStatsDBCache * (1.0 / 1024 / 1024));
+    }
+    LogPrintf("* Using %.1fMiB for UTXO set statistics database\n", nUTXOStatsDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    if (nPrefetchCache > 0) {
+        LogPrintf("* Using %.1fMiB for the coins prefetched ahead of the blocks\n", nPrefetchCache * (1.0 / 1024 / 1024));
+    }
 
     const CChainParams& chainparams = Params();
     const Consensus::Params& consensus = chainparams.GetConsensus();
@@ -1571,8 +1671,14 @@ bool AppInitMain()
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
-                delete pcoinsdbview;
+                delete pcoinsPrefetch;
+                pcoinsPrefetch = nullptr;
                 delete pcoinscatcher;
+                delete pcoinsWriter;
+                pcoinsWriter = nullptr;
+                delete pcoinsdbview;
+                delete putxostats;
+                putxostats = NULL;
                 delete pblocktree;
                 delete pSporkDB;
 
@@ -1627,7 +1733,12 @@ bool AppInitMain()
                 // block tree into mapBlockIndex!
 
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                if (gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH)) {
+                    pcoinsWriter = new CCoinsViewBackgroundWriter(pcoinsdbview);
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsWriter);
+                } else {
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                }
 
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex (or -reindex-chainstate !TODO)
@@ -1645,7 +1756,14 @@ bool AppInitMain()
                 }
 
                 // The on-disk coinsdb is now in a good state, create the cache
-                pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                int nPrefetchThreads = gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS);
+                if (nPrefetchThreads > 0) {
+                    nPrefetchThreads = std::min(nPrefetchThreads, MAX_PREFETCH_THREADS);
+                    pcoinsPrefetch = new CCoinsViewPrefetch(pcoinscatcher, nPrefetchThreads, std::max(1, (int)gArgs.GetArg("-prefetchblocks", DEFAULT_PREFETCH_BLOCKS)), nPrefetchCache);
+                    pcoinsTip = new CCoinsViewCache(pcoinsPrefetch);
+                } else {
+                    pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                }
 
                 // !TODO: after enabling reindex-chainstate
                 // if (!fReindex && !fReindexChainState) {
@@ -1658,6 +1776,13 @@ bool AppInitMain()
                     assert(chainActive.Tip() != NULL);
                 }
 
+                uiInterface.InitMessage(_("Loading UTXO set statistics..."));
+                putxostats = new CUTXOStatsTracker(nUTXOStatsDBCache, false, fReindex);
+                if (!putxostats->Init(pcoinsTip)) {
+                    strLoadError = _("Error loading UTXO set statistics database");
+                    break;
+                }
+
 
                 // !TODO: after enabling reindex-chainstate
                 // if (!fReindex && !fReindexChainState) {
@@ -1774,6 +1899,14 @@ bool AppInitMain()
         }
     }
 
+    if (gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        // The index is rebuilt along with the chain on -reindex
+        g_blockstatsindex.reset(new CBlockStatsIndex(nBlockStatsDBCache, false, fReindex));
+        g_blockstatsindex->Init();
+        RegisterValidationInterface(g_blockstatsindex.get(), "blockstatsindex");
+        threadGroup.create_thread(std::bind(&TraceThread<std::function<void()>>, "blkstats", [] { g_blockstatsindex->ThreadSync(); }));
+    }
+
     std::vector<fs::path> vImportFiles;
     for (const std::string& strFile : gArgs.GetArgs("-loadblock")) {
         vImportFiles.emplace_back(strFile);
@@ -1790,9 +1923,7 @@ bool AppInitMain()
         uiInterface.NotifyBlockTip.disconnect(BlockNotifyGenesisWait);
     }
 
-    uiInterface.InitMessage(_("Calculating money supply..."));
     int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height(););
-    MoneySupply.Update(pcoinsTip->GetTotalAmount(), nChainHeight);
 
 
     // ********************************************************* Step 10: setup layer 2 data
@@ -1926,6 +2057,12 @@ bool AppInitMain()
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000 * gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000 * gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nMsgHandlerThreads = std::max(0, std::min((int)gArgs.GetArg("-msghandthreads", DEFAULT_MSGHAND_THREADS), MAX_MSGHAND_THREADS));
+    if (gArgs.IsArgSet("-socketevents")) {
+        const std::string strSocketEvents = gArgs.GetArg("-socketevents", "");
+        if (!ParseSocketEventsMode(strSocketEvents, connOptions.socketEventsMode))
+            return UIError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEvents, GetSupportedSocketEventsModes()));
+    }
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return UIError(strNodeError);
@@ -8,6 +8,7 @@
 
 #include "kernel.h"
 
+#include "crypto/sha256.h"
 #include "db.h"
 #include "legacy/stakemodifier.h"
 #include "policy/policy.h"
@@ -18,6 +19,11 @@
 #include "utilstrencodings.h"
 #include "validation.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 /**
  * CStakeKernel Constructor
  *
@@ -49,19 +55,33 @@ CStakeKernel::CStakeKernel(const CBlockIndex* const pindexPrev, CStakeInput* sta
 
 // Return stake kernel hash
 uint256 CStakeKernel::GetHash() const
+{
+    const CDataStream& ss = GetData();
+    return Hash(ss.begin(), ss.end());
+}
+
+// Return the serialized kernel message
+CDataStream CStakeKernel::GetData() const
 {
     CDataStream ss(stakeModifier);
     ss << nTimeBlockFrom << stakeUniqueness << nTime;
-    return Hash(ss.begin(), ss.end());
+    return ss;
 }
 
-// Check that the kernel hash meets the target required
-bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
+// Return the hash target, weighted by the stake value
+uint256 CStakeKernel::GetTarget() const
 {
-    // Get weighted target
     uint256 bnTarget;
     bnTarget.SetCompact(nBits);
     bnTarget *= (uint256(stakeValue) / 100);
+    return bnTarget;
+}
+
+// Check that the kernel hash meets the target required
+bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
+{
+    // Get weighted target
+    const uint256& bnTarget = GetTarget();
 
     // Check PoS kernel hash
     const uint256& hashProofOfStake = GetHash();
@@ -82,6 +102,170 @@ bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
 }
 
 
+/*
+ * Kernel search
+ */
+
+// Number of kernels hashed by a thread before looking for more work (and polling the abort function)
+static const int KERNEL_SEARCH_BATCH = 256;
+
+/**
+ * Threads of the kernel search. They are started by the first search that
+ * needs them and wait for the next ones, instead of being created at every
+ * staking attempt. A search runs on the calling thread and on the pool.
+ */
+class CKernelSearchThreads
+{
+private:
+    //! Held by Run for the whole search
+    std::mutex csRun;
+    std::mutex cs;
+    //! Signals the threads that a job is posted, or that they must stop
+    std::condition_variable condWork;
+    //! Signals Run that the last thread running the job is done
+    std::condition_variable condDone;
+    std::vector<std::thread> threads;
+    const std::function<void()>* pjob{nullptr};
+    uint64_t nJob{0};
+    //! Threads that can still join the current job, and threads running it
+    int nWanted{0};
+    int nRunning{0};
+    bool fStop{false};
+
+    void Thread()
+    {
+        util::ThreadRename("c_note-kernel");
+        uint64_t nLastJob = 0;
+        std::unique_lock<std::mutex> lock(cs);
+        while (true) {
+            condWork.wait(lock, [&] { return fStop || (nWanted > 0 && nJob != nLastJob); });
+            if (fStop) return;
+            nLastJob = nJob;
+            nWanted--;
+            nRunning++;
+            const std::function<void()>& job = *pjob;
+            lock.unlock();
+            job();
+            lock.lock();
+            if (--nRunning == 0) condDone.notify_all();
+        }
+    }
+
+public:
+    ~CKernelSearchThreads()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            fStop = true;
+        }
+        condWork.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    //! Run job on the calling thread and on (up to) nExtra threads of the pool, return when all are done
+    void Run(int nExtra, const std::function<void()>& job)
+    {
+        std::lock_guard<std::mutex> lockRun(csRun);
+        if (nExtra > 0) {
+            std::lock_guard<std::mutex> lock(cs);
+            while ((int) threads.size() < nExtra) {
+                threads.emplace_back(&CKernelSearchThreads::Thread, this);
+            }
+            pjob = &job;
+            nJob++;
+            nWanted = nExtra;
+        }
+        condWork.notify_all();
+        job();
+        std::unique_lock<std::mutex> lock(cs);
+        // The threads that did not join yet have nothing left to do
+        nWanted = 0;
+        condDone.wait(lock, [&] { return nRunning == 0; });
+        pjob = nullptr;
+    }
+};
+
+static CKernelSearchThreads kernelSearchThreads;
+
+CStakeKernelSearch::CStakeKernelSearch(const CBlockIndex* const pindexPrev, unsigned int nBits, int nTimeTx):
+    pindexPrev(pindexPrev),
+    nBits(nBits),
+    nTime(nTimeTx)
+{}
+
+bool CStakeKernelSearch::AddInput(CStakeInput* stakeInput)
+{
+    if (!stakeInput || !stakeInput->ContextCheck(pindexPrev->nHeight + 1, nTime)) return false;
+
+    CStakeKernel stakeKernel(pindexPrev, stakeInput, nBits, nTime);
+    const CDataStream& ss = stakeKernel.GetData();
+    if (vTargets.empty()) {
+        nKernelSize = ss.size();
+    } else if (ss.size() != nKernelSize) {
+        // All the kernels of a block have the same layout
+        return error("%s : unexpected kernel size %d (expected %d)", __func__, ss.size(), nKernelSize);
+    }
+    vKernels.insert(vKernels.end(), ss.begin(), ss.end());
+    vTargets.emplace_back(stakeKernel.GetTarget());
+    return true;
+}
+
+void CStakeKernelSearch::GetHashes(size_t nBegin, size_t nCount, uint256* hashes) const
+{
+    assert(nBegin + nCount <= Size());
+    SHA256DBatch(hashes->begin(), vKernels.data() + nBegin * nKernelSize, nKernelSize, nCount);
+}
+
+int CStakeKernelSearch::FindInRange(int nBegin, int nEnd) const
+{
+    uint256 hashes[KERNEL_SEARCH_BATCH];
+    GetHashes(nBegin, nEnd - nBegin, hashes);
+    for (int i = nBegin; i < nEnd; i++) {
+        if (hashes[i - nBegin] < vTargets[i]) return i;
+    }
+    return -1;
+}
+
+int CStakeKernelSearch::Find(int nThreads, const std::function<bool()>& fnAbort, int nStart, int* pnHashed) const
+{
+    const int nInputs = (int) Size();
+    if (pnHashed) *pnHashed = 0;
+    if (nStart >= nInputs) return -1;
+    const int nBatches = (nInputs - nStart + KERNEL_SEARCH_BATCH - 1) / KERNEL_SEARCH_BATCH;
+    nThreads = std::max(1, std::min(nThreads, nBatches));
+
+    // Batches are handed out in order, and the lowest kernel found wins, so that
+    // the result doesn't depend on the number of threads.
+    std::atomic<int> nextBatch{0};
+    std::atomic<int> found{nInputs};
+    std::atomic<bool> fAborted{false};
+    std::atomic<int> nHashed{0};
+    const std::function<void()> worker = [&]() {
+        while (!fAborted) {
+            const int nBatch = nextBatch++;
+            const int nBegin = nStart + nBatch * KERNEL_SEARCH_BATCH;
+            if (nBatch >= nBatches || nBegin > found) return;
+            if (fnAbort()) {
+                fAborted = true;
+                return;
+            }
+            const int nEnd = std::min(nBegin + KERNEL_SEARCH_BATCH, nInputs);
+            const int res = FindInRange(nBegin, nEnd);
+            nHashed += nEnd - nBegin;
+            if (res < 0) continue;
+            int prev = found;
+            while (res < prev && !found.compare_exchange_weak(prev, res)) {}
+            return;
+        }
+    };
+
+    kernelSearchThreads.Run(nThreads - 1, worker);
+
+    if (pnHashed) *pnHashed = nHashed;
+    return (fAborted || found == nInputs) ? -1 : (int) found;
+}
+
+
 /*
  * PoS Validation
  */
@@ -111,6 +295,20 @@ bool LoadStakeInput(const CBlock& block, const CBlockIndex* pindexPrev, std::uni
     return stake && stake->InitFromTxIn(txin);
 }
 
+/*
+ * GetStakeTimeSlot     Get the time of a new block staked on top of pindexPrev
+ *
+ * @param[in]   pindexPrev      index of the parent block of the block being staked
+ * @param[out]  nTimeTx         new blocktime (current time slot)
+ * @return      bool            false if the time slot isn't past pindexPrev time
+ */
+bool GetStakeTimeSlot(const CBlockIndex* pindexPrev, int64_t& nTimeTx)
+{
+    const bool fRegTest = Params().IsRegTestNet();
+    nTimeTx = (fRegTest ? GetAdjustedTime() : GetCurrentTimeSlot());
+    return fRegTest || nTimeTx > pindexPrev->nTime;
+}
+
 /*
  * Stake                Check if stakeInput can stake a block on top of pindexPrev
  *
@@ -127,9 +325,7 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
     if (!stakeInput || !stakeInput->ContextCheck(nHeightTx, nTimeTx)) return false;
 
     // Get the new time slot (and verify it's not the same as previous block)
-    const bool fRegTest = Params().IsRegTestNet();
-    nTimeTx = (fRegTest ? GetAdjustedTime() : GetCurrentTimeSlot());
-    if (nTimeTx <= pindexPrev->nTime && !fRegTest) return false;
+    if (!GetStakeTimeSlot(pindexPrev, nTimeTx)) return false;
 
     // Verify Proof Of Stake
     CStakeKernel stakeKernel(pindexPrev, stakeInput, nBits, nTimeTx);
@@ -11,6 +11,8 @@
 
 #include "stakeinput.h"
 
+#include <functional>
+
 class CStakeKernel {
 public:
     /**
@@ -26,6 +28,12 @@ public:
     // Return stake kernel hash
     uint256 GetHash() const;
 
+    // Return the serialized kernel message (the data hashed by GetHash)
+    CDataStream GetData() const;
+
+    // Return the hash target, weighted by the stake value
+    uint256 GetTarget() const;
+
     // Check that the kernel hash meets the target required
     bool CheckKernelHash(bool fSkipLog = false) const;
 
@@ -40,8 +48,64 @@ private:
     CAmount stakeValue{0};     // target multiplier
 };
 
+/*
+ * CStakeKernelSearch   Kernel search over many stake inputs, for the same block
+ *                      (same parent, time and difficulty).
+ *
+ * The kernel message and the weighted target of each input are computed once
+ * when the input is added, so that the hashes can then be evaluated by several
+ * threads without accessing the wallet or the chain.
+ */
+class CStakeKernelSearch {
+public:
+    /**
+     * CStakeKernelSearch Constructor
+     *
+     * @param[in]   pindexPrev      index of the parent of the kernel block
+     * @param[in]   nBits           target difficulty bits of the kernel block
+     * @param[in]   nTimeTx         time of the kernel block
+     */
+    CStakeKernelSearch(const CBlockIndex* const pindexPrev, unsigned int nBits, int nTimeTx);
+
+    // Precompute the kernel of stakeInput (false if the input fails the contextual checks)
+    bool AddInput(CStakeInput* stakeInput);
+
+    // Number of inputs added
+    size_t Size() const { return vTargets.size(); }
+
+    // Compute the kernel hashes of the inputs in [nBegin, nBegin + nCount).
+    // The kernels are hashed in groups of 4 or 8, with the SSE4.1/AVX2 SHA256 transforms, when available.
+    void GetHashes(size_t nBegin, size_t nCount, uint256* hashes) const;
+
+    // Hash the kernels, from position nStart, with (up to) nThreads threads, polling fnAbort between
+    // batches. Return the position, in AddInput order, of the first input meeting its target (-1 if none
+    // or aborted). pnHashed is set to the number of kernels hashed.
+    int Find(int nThreads, const std::function<bool()>& fnAbort, int nStart = 0, int* pnHashed = nullptr) const;
+
+private:
+    // Hash the kernels in [nBegin, nEnd), return the first meeting the target (-1 if none)
+    int FindInRange(int nBegin, int nEnd) const;
+
+    const CBlockIndex* pindexPrev{nullptr};
+    unsigned int nBits{0};
+    int nTime{0};
+    // Kernel messages (all of the same size), laid out contiguously
+    size_t nKernelSize{0};
+    std::vector<unsigned char> vKernels;
+    std::vector<uint256> vTargets;
+};
+
 /* PoS Validation */
 
+/*
+ * GetStakeTimeSlot     Get the time of a new block staked on top of pindexPrev
+ *
+ * @param[in]   pindexPrev      index of the parent block of the block being staked
+ * @param[out]  nTimeTx         new blocktime (current time slot)
+ * @return      bool            false if the time slot isn't past pindexPrev time
+ */
+bool GetStakeTimeSlot(const CBlockIndex* pindexPrev, int64_t& nTimeTx);
+
 /*
  * Stake                Check if stakeInput can stake a block on top of pindexPrev
  *
@@ -38,6 +38,7 @@ bool CBasicKeyStore::AddKeyPubKey(const CKey& key, const CPubKey& pubkey)
 {
     LOCK(cs_KeyStore);
     mapKeys[pubkey.GetID()] = key;
+    nKeyStoreVersion++;
     return true;
 }
 
@@ -48,6 +49,7 @@ bool CBasicKeyStore::AddCScript(const CScript& redeemScript)
 
     LOCK(cs_KeyStore);
     mapScripts[CScriptID(redeemScript)] = redeemScript;
+    nKeyStoreVersion++;
     return true;
 }
 
@@ -88,6 +90,7 @@ bool CBasicKeyStore::AddWatchOnly(const CScript& dest)
 {
     LOCK(cs_KeyStore);
     setWatchOnly.insert(dest);
+    nKeyStoreVersion++;
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey))
         mapWatchKeys[pubKey.GetID()] = pubKey;
@@ -98,6 +101,7 @@ bool CBasicKeyStore::RemoveWatchOnly(const CScript& dest)
 {
     LOCK(cs_KeyStore);
     setWatchOnly.erase(dest);
+    nKeyStoreVersion++;
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey))
         mapWatchKeys.erase(pubKey.GetID());
@@ -175,6 +179,7 @@ bool CBasicKeyStore::AddSaplingFullViewingKey(
     LOCK(cs_KeyStore);
     auto ivk = extfvk.fvk.in_viewing_key();
     mapSaplingFullViewingKeys[ivk] = extfvk;
+    nKeyStoreVersion++;
 
     return CBasicKeyStore::AddSaplingIncomingViewingKey(ivk, extfvk.DefaultAddress());
 }
@@ -268,4 +273,9 @@ void CBasicKeyStore::GetSaplingPaymentAddresses(std::set<libzcash::SaplingPaymen
             mi++;
         }
     }
-}
\ No newline at end of file
+}
+unsigned int CBasicKeyStore::GetKeyStoreVersion() const
+{
+    LOCK(cs_KeyStore);
+    return nKeyStoreVersion;
+}
@@ -103,6 +103,8 @@ protected:
     WatchKeyMap mapWatchKeys;
     ScriptMap mapScripts;
     WatchOnlySet setWatchOnly;
+    //! Incremented whenever the keys, scripts or viewing keys above change
+    unsigned int nKeyStoreVersion{0};
 
 public:
 
@@ -149,6 +151,9 @@ public:
             libzcash::SaplingExtendedSpendingKey &extskOut) const;
 
     void GetSaplingPaymentAddresses(std::set<libzcash::SaplingPaymentAddress> &setAddress) const;
+
+    //! Changes whenever the scripts and notes that IsMine and the note decryption match may change
+    unsigned int GetKeyStoreVersion() const;
 };
 
 typedef std::vector<unsigned char, secure_allocator<unsigned char> > CKeyingMaterial;
@@ -164,7 +164,7 @@ std::string CMasternodePaymentWinner::GetStrMessage() const
 
 bool CMasternodePaymentWinner::IsValid(CNode* pnode, std::string& strError)
 {
-    CMasternode* pmn = mnodeman.Find(vinMasternode.prevout);
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(vinMasternode.prevout);
 
     if (!pmn) {
         strError = strprintf("Unknown Masternode %s", vinMasternode.prevout.hash.ToString());
@@ -413,7 +413,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
 
         int nHeight = mnodeman.GetBestHeight();
 
-        if (masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash())) {
+        if (WITH_LOCK(cs_mapMasternodePayeeVotes, return masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash()))) {
             LogPrint(BCLog::MASTERNODE, "mnw - Already seen - %s bestHeight %d\n", winner.GetHash().ToString().c_str(), nHeight);
             masternodeSync.AddedMasternodeWinner(winner.GetHash());
             return;
@@ -442,7 +442,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
             return;
         }
 
-        const CMasternode* pmn = mnodeman.Find(winner.vinMasternode.prevout);
+        MasternodeRef pmn = mnodeman.GetMasternodeRef(winner.vinMasternode.prevout);
         if (!pmn || !winner.CheckSignature(pmn->pubKeyMasternode.GetID())) {
             if (masternodeSync.IsSynced()) {
                 LogPrintf("CMasternodePayments::ProcessMessageMasternodePayments() : mnw - invalid signature\n");
@@ -521,13 +521,54 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
             CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
             mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
         }
-    }
 
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+        CMasternodeBlockPayees& blockPayees = mapMasternodeBlocks[winnerIn.nBlockHeight];
+        blockPayees.AddPayee(winnerIn.payee, 1);
+        if (blockPayees.HasPayeeWithVotes(winnerIn.payee, MNPAYMENTS_LASTPAID_VOTES)) {
+            mapPayeePaidHeights[winnerIn.payee].insert(winnerIn.nBlockHeight);
+        }
+    }
 
     return true;
 }
 
+void CMasternodePayments::RebuildPaidHeights()
+{
+    LOCK(cs_mapMasternodeBlocks);
+    mapPayeePaidHeights.clear();
+    for (auto& it : mapMasternodeBlocks) {
+        LOCK(cs_vecPayments);
+        for (const CMasternodePayee& payee : it.second.vecPayments) {
+            if (payee.nVotes >= MNPAYMENTS_LASTPAID_VOTES) {
+                mapPayeePaidHeights[payee.scriptPubKey].insert(it.first);
+            }
+        }
+    }
+}
+
+void CMasternodePayments::ErasePaidHeight(int nHeight, const CMasternodeBlockPayees& blockPayees)
+{
+    LOCK(cs_vecPayments);
+    for (const CMasternodePayee& payee : blockPayees.vecPayments) {
+        auto it = mapPayeePaidHeights.find(payee.scriptPubKey);
+        if (it == mapPayeePaidHeights.end()) continue;
+        it->second.erase(nHeight);
+        if (it->second.empty()) mapPayeePaidHeights.erase(it);
+    }
+}
+
+int CMasternodePayments::GetLastPaidHeight(const CScript& payee, int nMaxHeight) const
+{
+    LOCK(cs_mapMasternodeBlocks);
+    const auto it = mapPayeePaidHeights.find(payee);
+    if (it == mapPayeePaidHeights.end()) return -1;
+
+    // first paid height above nMaxHeight (payments up to 10 blocks ahead are already scheduled)
+    auto itHeight = it->second.upper_bound(nMaxHeight);
+    if (itHeight == it->second.begin()) return -1;
+    return *(--itHeight);
+}
+
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransaction& txNew)
 {
     LOCK(cs_vecPayments);
@@ -627,9 +668,13 @@ void CMasternodePayments::CleanPaymentList(int mnCount, int nHeight)
 
         if (nHeight - winner.nBlockHeight > nLimit) {
             LogPrint(BCLog::MASTERNODE, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
-            masternodeSync.mapSeenSyncMNW.erase((*it).first);
+            WITH_LOCK(masternodeSync.cs_mapSeenSync, masternodeSync.mapSeenSyncMNW.erase((*it).first));
             mapMasternodePayeeVotes.erase(it++);
-            mapMasternodeBlocks.erase(winner.nBlockHeight);
+            auto itBlock = mapMasternodeBlocks.find(winner.nBlockHeight);
+            if (itBlock != mapMasternodeBlocks.end()) {
+                ErasePaidHeight(itBlock->first, itBlock->second);
+                mapMasternodeBlocks.erase(itBlock);
+            }
         } else {
             ++it;
         }
@@ -23,6 +23,8 @@ extern CMasternodePayments masternodePayments;
 
 #define MNPAYMENTS_SIGNATURES_REQUIRED 6
 #define MNPAYMENTS_SIGNATURES_TOTAL 10
+// votes a payee needs at a height to be considered paid (last paid tracking)
+#define MNPAYMENTS_LASTPAID_VOTES 2
 
 void ProcessMessageMasternodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 bool IsBlockPayeeValid(const CBlock& block, int nBlockHeight);
@@ -231,6 +233,13 @@ class CMasternodePayments
 private:
     int nLastBlockHeight;
 
+    // Heights at which each payee has at least MNPAYMENTS_LASTPAID_VOTES votes.
+    // Index over mapMasternodeBlocks (rebuilt on load), protected by cs_mapMasternodeBlocks.
+    std::map<CScript, std::set<int>> mapPayeePaidHeights;
+
+    void RebuildPaidHeights();
+    void ErasePaidHeight(int nHeight, const CMasternodeBlockPayees& blockPayees);
+
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -246,6 +255,7 @@ public:
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapPayeePaidHeights.clear();
     }
 
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
@@ -257,6 +267,8 @@ public:
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(const CMasternode& mn, int nNotBlockHeight);
+    /// Last height, not above nMaxHeight, at which the payee was voted with enough votes (-1 if none)
+    int GetLastPaidHeight(const CScript& payee, int nMaxHeight) const;
 
     bool CanVote(const COutPoint& outMasternode, int nBlockHeight)
     {
@@ -285,6 +297,7 @@ public:
     {
         READWRITE(mapMasternodePayeeVotes);
         READWRITE(mapMasternodeBlocks);
+        if (ser_action.ForRead()) RebuildPaidHeights();
     }
 };
 
@@ -91,9 +91,12 @@ void CMasternodeSync::Reset()
     lastMasternodeList = 0;
     lastMasternodeWinner = 0;
     lastBudgetItem = 0;
-    mapSeenSyncMNB.clear();
-    mapSeenSyncMNW.clear();
-    mapSeenSyncBudget.clear();
+    {
+        LOCK(cs_mapSeenSync);
+        mapSeenSyncMNB.clear();
+        mapSeenSyncMNW.clear();
+        mapSeenSyncBudget.clear();
+    }
     lastFailure = 0;
     nCountFailures = 0;
     sumMasternodeList = 0;
@@ -111,7 +114,9 @@ void CMasternodeSync::Reset()
 
 void CMasternodeSync::AddedMasternodeList(const uint256& hash)
 {
-    if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
+    const bool fSeen = mnodeman.HasSeenBroadcast(hash);
+    LOCK(cs_mapSeenSync);
+    if (fSeen) {
         if (mapSeenSyncMNB[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastMasternodeList = GetTime();
             mapSeenSyncMNB[hash]++;
@@ -124,7 +129,9 @@ void CMasternodeSync::AddedMasternodeList(const uint256& hash)
 
 void CMasternodeSync::AddedMasternodeWinner(const uint256& hash)
 {
-    if (masternodePayments.mapMasternodePayeeVotes.count(hash)) {
+    const bool fSeen = WITH_LOCK(cs_mapMasternodePayeeVotes, return masternodePayments.mapMasternodePayeeVotes.count(hash));
+    LOCK(cs_mapSeenSync);
+    if (fSeen) {
         if (mapSeenSyncMNW[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastMasternodeWinner = GetTime();
             mapSeenSyncMNW[hash]++;
@@ -137,10 +144,12 @@ void CMasternodeSync::AddedMasternodeWinner(const uint256& hash)
 
 void CMasternodeSync::AddedBudgetItem(const uint256& hash)
 {
-    if (g_budgetman.HaveProposal(hash) ||
-            g_budgetman.HaveSeenProposalVote(hash) ||
-            g_budgetman.HaveFinalizedBudget(hash) ||
-            g_budgetman.HaveSeenFinalizedBudgetVote(hash)) {
+    const bool fSeen = g_budgetman.HaveProposal(hash) ||
+                       g_budgetman.HaveSeenProposalVote(hash) ||
+                       g_budgetman.HaveFinalizedBudget(hash) ||
+                       g_budgetman.HaveSeenFinalizedBudgetVote(hash);
+    LOCK(cs_mapSeenSync);
+    if (fSeen) {
         if (mapSeenSyncBudget[hash] < MASTERNODE_SYNC_THRESHOLD) {
             lastBudgetItem = GetTime();
             mapSeenSyncBudget[hash]++;
@@ -8,6 +8,7 @@
 #define MASTERNODE_SYNC_H
 
 #include "net.h"    // for NodeId
+#include "sync.h"
 #include "uint256.h"
 
 #include <atomic>
@@ -42,6 +43,8 @@ struct TierTwoPeerData {
 class CMasternodeSync
 {
 public:
+    // The relay messages of different peers are processed concurrently (see -msghandthreads)
+    RecursiveMutex cs_mapSeenSync;
     std::map<uint256, int> mapSeenSyncMNB;
     std::map<uint256, int> mapSeenSyncMNW;
     std::map<uint256, int> mapSeenSyncBudget;
@@ -136,7 +136,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
         int nDoS = 0;
         if (mnb.lastPing.IsNull() || (!mnb.lastPing.IsNull() && mnb.lastPing.CheckAndUpdate(nDoS, false))) {
             lastPing = mnb.lastPing;
-            mnodeman.mapSeenMasternodePing.emplace(lastPing.GetHash(), lastPing);
+            mnodeman.AddSeenPing(lastPing);
         }
         return true;
     }
@@ -362,7 +362,7 @@ bool CMasternodeBroadcast::CheckSignature() const
                             GetStrMessage()
                             );
 
-    if(!CMessageSigner::VerifyMessage(pubKeyCollateralAddress, vchSig, strMessage, strError))
+    if (!VerifySignatureHash(CMessageSigner::GetMessageHash(strMessage), pubKeyCollateralAddress.GetID(), strError))
         return error("%s : VerifyMessage (nMessVersion=%d) failed: %s", __func__, nMessVersion, strError);
 
     return true;
@@ -438,7 +438,7 @@ bool CMasternodeBroadcast::CheckAndUpdate(int& nDos)
     }
 
     //search existing Masternode list, this is where we update existing Masternodes with new mnb broadcasts
-    CMasternode* pmn = mnodeman.Find(vin.prevout);
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(vin.prevout);
 
     // no such masternode, nothing to update
     if (pmn == NULL) return true;
@@ -485,16 +485,18 @@ bool CMasternodeBroadcast::CheckInputsAndAdd(int nChainHeight, int& nDoS)
     }
 
     // search existing Masternode list
-    CMasternode* pmn = mnodeman.Find(vin.prevout);
-    if (pmn != NULL) {
+    // (a shared reference: the entry can be removed by another message handler thread)
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(vin.prevout);
+    if (pmn) {
         // nothing to do here if we already know about this masternode and it's enabled
         if (pmn->IsEnabled()) return true;
         // if it's not enabled, remove old MN first and continue
         else
-            mnodeman.Remove(pmn->vin.prevout);
+            mnodeman.Remove(vin.prevout);
     }
 
-    const Coin& collateralUtxo = pcoinsTip->AccessCoin(vin.prevout);
+    // blocks are connected in parallel with the masternode messages: copy the coin under cs_main
+    const Coin collateralUtxo = WITH_LOCK(cs_main, return pcoinsTip->AccessCoin(vin.prevout));
     if (collateralUtxo.IsSpent()) {
         LogPrint(BCLog::MASTERNODE,"mnb - vin %s spent\n", vin.prevout.ToString());
         return false;
@@ -506,8 +508,8 @@ bool CMasternodeBroadcast::CheckInputsAndAdd(int nChainHeight, int& nDoS)
     if (collateralUtxoDepth < MasternodeCollateralMinConf()) {
         LogPrint(BCLog::MASTERNODE,"mnb - Input must have at least %d confirmations\n", MasternodeCollateralMinConf());
         // maybe we miss few blocks, let this mnb to be checked again later
-        mnodeman.mapSeenMasternodeBroadcast.erase(GetHash());
-        masternodeSync.mapSeenSyncMNB.erase(GetHash());
+        mnodeman.RemoveSeenBroadcast(GetHash());
+        WITH_LOCK(masternodeSync.cs_mapSeenSync, masternodeSync.mapSeenSyncMNB.erase(GetHash()));
         return false;
     }
 
@@ -620,7 +622,7 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireAvailable, bool fCh
     }
 
     // see if we have this Masternode
-    CMasternode* pmn = mnodeman.Find(vin.prevout);
+    MasternodeRef pmn = mnodeman.GetMasternodeRef(vin.prevout);
     const bool isMasternodeFound = (pmn != nullptr);
     const bool isSignatureValid = (isMasternodeFound && CheckSignature(pmn->pubKeyMasternode.GetID()));
 
@@ -651,17 +653,14 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireAvailable, bool fCh
             }
 
             // ping have passed the basic checks, can be updated now
-            mnodeman.mapSeenMasternodePing.emplace(GetHash(), *this);
+            mnodeman.AddSeenPing(*this);
 
             // SetLastPing locks masternode cs. Be careful with the lock ordering.
             pmn->SetLastPing(*this);
 
             //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
             CMasternodeBroadcast mnb(*pmn);
-            const uint256& hash = mnb.GetHash();
-            if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = *this;
-            }
+            mnodeman.UpdateSeenBroadcastLastPing(mnb.GetHash(), *this);
 
             if (!pmn->IsEnabled()) return false;
 
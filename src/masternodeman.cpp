@@ -19,6 +19,7 @@
 #include "util.h"
 
 #include <boost/thread/thread.hpp>
+#include <thread>
 
 #define MN_WINNER_MINIMUM_AGE 8000    // Age in seconds. This should be > MASTERNODE_REMOVAL_SECONDS to avoid misconfigured new nodes in the list.
 
@@ -36,14 +37,6 @@ struct CompareLastPaid {
     }
 };
 
-struct CompareScoreTxIn {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 struct CompareScoreMN {
     bool operator()(const std::pair<int64_t, MasternodeRef>& t1,
         const std::pair<int64_t, MasternodeRef>& t2) const
@@ -201,6 +194,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (it == mapMasternodes.end()) {
         LogPrint(BCLog::MASTERNODE, "Adding new Masternode %s\n", mn.vin.prevout.ToString());
         mapMasternodes.emplace(mn.vin.prevout, std::make_shared<CMasternode>(mn));
+        mapScoresCache.clear();
         LogPrint(BCLog::MASTERNODE, "Masternode added. New total count: %d\n", mapMasternodes.size());
         return true;
     }
@@ -210,18 +204,21 @@ bool CMasternodeMan::Add(CMasternode& mn)
 
 void CMasternodeMan::AskForMN(CNode* pnode, const CTxIn& vin)
 {
-    std::map<COutPoint, int64_t>::iterator i = mWeAskedForMasternodeListEntry.find(vin.prevout);
-    if (i != mWeAskedForMasternodeListEntry.end()) {
-        int64_t t = (*i).second;
-        if (GetTime() < t) return; // we've asked recently
+    {
+        LOCK(cs);
+        std::map<COutPoint, int64_t>::iterator i = mWeAskedForMasternodeListEntry.find(vin.prevout);
+        if (i != mWeAskedForMasternodeListEntry.end()) {
+            int64_t t = (*i).second;
+            if (GetTime() < t) return; // we've asked recently
+        }
+        int64_t askAgain = GetTime() + MasternodeMinPingSeconds();
+        mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
     }
 
     // ask for the mnb info once from the node that sent mnp
 
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::AskForMN - Asking node for missing entry, vin: %s\n", vin.prevout.hash.ToString());
     g_connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::GETMNLIST, vin));
-    int64_t askAgain = GetTime() + MasternodeMinPingSeconds();
-    mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
 }
 
 int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
@@ -242,10 +239,11 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             //erase all of the broadcasts we've seen from this vin
             // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
             //    sending a brand new mnb
+            LOCK(cs_mapSeen);
             std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
             while (it3 != mapSeenMasternodeBroadcast.end()) {
                 if (it3->second.vin == it->second->vin) {
-                    masternodeSync.mapSeenSyncMNB.erase((*it3).first);
+                    WITH_LOCK(masternodeSync.cs_mapSeenSync, masternodeSync.mapSeenSyncMNB.erase((*it3).first));
                     it3 = mapSeenMasternodeBroadcast.erase(it3);
                 } else {
                     ++it3;
@@ -263,6 +261,7 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             }
 
             it = mapMasternodes.erase(it);
+            mapScoresCache.clear();
             LogPrint(BCLog::MASTERNODE, "Masternode removed.\n");
         } else {
             ++it;
@@ -300,11 +299,12 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
         }
     }
 
+    LOCK(cs_mapSeen);
     // remove expired mapSeenMasternodeBroadcast
     std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
     while (it3 != mapSeenMasternodeBroadcast.end()) {
         if ((*it3).second.lastPing.sigTime < GetTime() - (MasternodeRemovalSeconds() * 2)) {
-            masternodeSync.mapSeenSyncMNB.erase((*it3).second.GetHash());
+            WITH_LOCK(masternodeSync.cs_mapSeenSync, masternodeSync.mapSeenSyncMNB.erase((*it3).second.GetHash()));
             it3 = mapSeenMasternodeBroadcast.erase(it3);
         } else {
             ++it3;
@@ -328,11 +328,15 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    mapScoresCache.clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
-    mapSeenMasternodeBroadcast.clear();
-    mapSeenMasternodePing.clear();
+    {
+        LOCK(cs_mapSeen);
+        mapSeenMasternodeBroadcast.clear();
+        mapSeenMasternodePing.clear();
+    }
     nDsqCount = 0;
 }
 
@@ -451,6 +455,73 @@ const CMasternode* CMasternodeMan::Find(const COutPoint& collateralOut) const
     return it != mapMasternodes.end() ? it->second.get() : nullptr;
 }
 
+bool CMasternodeMan::GetMasternodeKeyID(const COutPoint& collateralOut, CKeyID& keyIDRet) const
+{
+    LOCK(cs);
+    auto const& it = mapMasternodes.find(collateralOut);
+    if (it == mapMasternodes.end()) return false;
+    keyIDRet = it->second->pubKeyMasternode.GetID();
+    return true;
+}
+
+MasternodeRef CMasternodeMan::GetMasternodeRef(const COutPoint& collateralOut) const
+{
+    LOCK(cs);
+    auto const& it = mapMasternodes.find(collateralOut);
+    return it != mapMasternodes.end() ? it->second : nullptr;
+}
+
+bool CMasternodeMan::HasSeenBroadcast(const uint256& hash) const
+{
+    LOCK(cs_mapSeen);
+    return mapSeenMasternodeBroadcast.count(hash);
+}
+
+bool CMasternodeMan::GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet) const
+{
+    LOCK(cs_mapSeen);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end()) return false;
+    mnbRet = it->second;
+    return true;
+}
+
+void CMasternodeMan::RemoveSeenBroadcast(const uint256& hash)
+{
+    LOCK(cs_mapSeen);
+    mapSeenMasternodeBroadcast.erase(hash);
+}
+
+void CMasternodeMan::UpdateSeenBroadcastLastPing(const uint256& hash, const CMasternodePing& mnp)
+{
+    LOCK(cs_mapSeen);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it != mapSeenMasternodeBroadcast.end()) {
+        it->second.lastPing = mnp;
+    }
+}
+
+bool CMasternodeMan::HasSeenPing(const uint256& hash) const
+{
+    LOCK(cs_mapSeen);
+    return mapSeenMasternodePing.count(hash);
+}
+
+bool CMasternodeMan::GetSeenPing(const uint256& hash, CMasternodePing& mnpRet) const
+{
+    LOCK(cs_mapSeen);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end()) return false;
+    mnpRet = it->second;
+    return true;
+}
+
+void CMasternodeMan::AddSeenPing(const CMasternodePing& mnp)
+{
+    LOCK(cs_mapSeen);
+    mapSeenMasternodePing.emplace(mnp.GetHash(), mnp);
+}
+
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
     LOCK(cs);
@@ -510,7 +581,7 @@ const CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlock
         //make sure it has as many confirmations as there are masternodes
         if (pcoinsTip->GetCoinDepthAtHeight(mn->vin.prevout, nBlockHeight) < nMnCount) continue;
 
-        vecMasternodeLastPaid.emplace_back(SecondsSincePayment(mn, BlockReading), mn->vin);
+        vecMasternodeLastPaid.emplace_back(SecondsSincePayment(mn, BlockReading, nMnCount * 1.25), mn->vin);
     }
 
     nCount = (int)vecMasternodeLastPaid.size();
@@ -528,12 +599,13 @@ const CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlock
     int nTenthNetwork = CountEnabled() / 10;
     int nCountTenth = 0;
     uint256 nHigh;
-    const uint256& hash = GetHashAtHeight(nBlockHeight - 101);
+    const MasternodeScoresRef& scores = GetScores(GetHashAtHeight(nBlockHeight - 101));
     for (std::pair<int64_t, CTxIn> & s : vecMasternodeLastPaid) {
         const CMasternode* pmn = Find(s.second.prevout);
-        if (!pmn) break;
+        const uint256* pscore = scores->Find(s.second.prevout);
+        if (!pmn || !pscore) break;
 
-        const uint256& n = pmn->CalculateScore(hash);
+        const uint256& n = *pscore;
         if (n > nHigh) {
             nHigh = n;
             pBestMasternode = pmn;
@@ -544,29 +616,82 @@ const CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlock
     return pBestMasternode;
 }
 
-const CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol) const
+const uint256* CMasternodeScores::Find(const COutPoint& collateralOut) const
 {
-    int64_t score = 0;
-    const CMasternode* winner = nullptr;
-    const uint256& hash = GetHashAtHeight(nBlockHeight - 1);
+    const auto it = std::lower_bound(vScores.begin(), vScores.end(), collateralOut,
+            [](const std::pair<MasternodeRef, uint256>& score, const COutPoint& out) {
+                return score.first->vin.prevout < out;
+            });
+    if (it == vScores.end() || it->first->vin.prevout != collateralOut) return nullptr;
+    return &it->second;
+}
 
-    // scan for winner
-    for (const auto& it : mapMasternodes) {
-        const MasternodeRef& mn = it.second;
-        if (mn->protocolVersion < minProtocol || !mn->IsEnabled()) continue;
+MasternodeScoresRef CMasternodeMan::GetScores(const uint256& hash) const
+{
+    AssertLockHeld(cs);
+    const auto it = mapScoresCache.find(hash);
+    if (it != mapScoresCache.end()) return it->second;
 
-        // calculate the score for each Masternode
-        uint256 n = mn->CalculateScore(hash);
-        int64_t n2 = n.GetCompact(false);
+    auto scores = std::make_shared<CMasternodeScores>();
+    scores->vScores.reserve(mapMasternodes.size());
+    for (const auto& it : mapMasternodes) {
+        scores->vScores.emplace_back(it.second, UINT256_ZERO);
+    }
 
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = mn.get();
+    // calculate the score for each Masternode (split among the cores for large lists)
+    const size_t nSize = scores->vScores.size();
+    auto calculate = [&scores, &hash](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            scores->vScores[i].second = scores->vScores[i].first->CalculateScore(hash);
+        }
+    };
+    const size_t nThreads = nSize < SCORES_PARALLEL_MIN_SIZE ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    const size_t nChunk = (nSize + nThreads - 1) / nThreads;
+    std::vector<std::thread> threads;
+    for (size_t nBegin = nChunk; nBegin < nSize; nBegin += nChunk) {
+        threads.emplace_back(calculate, nBegin, std::min(nBegin + nChunk, nSize));
+    }
+    calculate(0, std::min(nChunk, nSize));
+    for (std::thread& t : threads) t.join();
+
+    uint256 nHigh = UINT256_ZERO;
+    scores->vCompact.reserve(nSize);
+    scores->vRanks.reserve(nSize);
+    for (size_t i = 0; i < nSize; i++) {
+        const uint256& n = scores->vScores[i].second;
+        scores->vCompact.emplace_back(n.GetCompact(false));
+        scores->vRanks.emplace_back(i);
+        if (n > nHigh) {
+            nHigh = n;
+            scores->nBest = (int) i;
         }
     }
+    const std::vector<int64_t>& vCompact = scores->vCompact;
+    std::stable_sort(scores->vRanks.begin(), scores->vRanks.end(), [&vCompact](size_t a, size_t b) {
+        return vCompact[a] > vCompact[b];
+    });
+
+    if (mapScoresCache.size() >= CACHED_SCORES_BLOCKS) mapScoresCache.clear();
+    mapScoresCache.emplace(hash, scores);
+    return scores;
+}
+
+const CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol) const
+{
+    const uint256& hash = GetHashAtHeight(nBlockHeight - 1);
+
+    LOCK(cs);
+    const MasternodeScoresRef& scores = GetScores(hash);
 
-    return winner;
+    // the winner is the first valid Masternode, starting from the highest score
+    for (size_t i : scores->vRanks) {
+        const MasternodeRef& mn = scores->vScores[i].first;
+        if (mn->protocolVersion < minProtocol || !mn->IsEnabled()) continue;
+        if (scores->vCompact[i] <= 0) break;
+        return mn.get();
+    }
+
+    return nullptr;
 }
 
 std::vector<std::pair<MasternodeRef, int>> CMasternodeMan::GetMnScores(int nLast) const
@@ -575,19 +700,16 @@ std::vector<std::pair<MasternodeRef, int>> CMasternodeMan::GetMnScores(int nLast
     int nChainHeight = GetBestHeight();
     if (nChainHeight < 0) return ret;
 
+    std::vector<std::pair<int, uint256>> vHashes;
     for (int nHeight = nChainHeight - nLast; nHeight < nChainHeight + 20; nHeight++) {
-        const uint256& hash = GetHashAtHeight(nHeight - 101);
-        uint256 nHigh = UINT256_ZERO;
-        MasternodeRef pBestMasternode;
-        for (const auto& it : mapMasternodes) {
-            const uint256& n = it.second->CalculateScore(hash);
-            if (n > nHigh) {
-                nHigh = n;
-                pBestMasternode = it.second;
-            }
-        }
-        if (nHigh > UINT256_ZERO) {
-            ret.emplace_back(pBestMasternode, nHeight);
+        vHashes.emplace_back(nHeight, GetHashAtHeight(nHeight - 101));
+    }
+
+    LOCK(cs);
+    for (const auto& it : vHashes) {
+        const MasternodeScoresRef& scores = GetScores(it.second);
+        if (scores->nBest >= 0) {
+            ret.emplace_back(scores->vScores[scores->nBest].first, it.first);
         }
     }
     return ret;
@@ -595,7 +717,6 @@ std::vector<std::pair<MasternodeRef, int>> CMasternodeMan::GetMnScores(int nLast
 
 int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive) const
 {
-    std::vector<std::pair<int64_t, CTxIn> > vecMasternodeScores;
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
 
@@ -603,16 +724,23 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
     // height outside range
     if (!hash) return -1;
 
-    // scan for winner
-    for (const auto& it : mapMasternodes) {
-        const MasternodeRef& mn = it.second;
+    const bool fCheckAge = sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT);
+    const int64_t nNow = GetAdjustedTime();
+
+    LOCK(cs);
+    const MasternodeScoresRef& scores = GetScores(hash);
+
+    // count the valid masternodes, starting from the highest score
+    int rank = 0;
+    for (size_t i : scores->vRanks) {
+        const MasternodeRef& mn = scores->vScores[i].first;
         if (mn->protocolVersion < minProtocol) {
             LogPrint(BCLog::MASTERNODE,"Skipping Masternode with obsolete version %d\n", mn->protocolVersion);
             continue;                                                       // Skip obsolete versions
         }
 
-        if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
-            nMasternode_Age = GetAdjustedTime() - mn->sigTime;
+        if (fCheckAge) {
+            nMasternode_Age = nNow - mn->sigTime;
             if ((nMasternode_Age) < nMasternode_Min_Age) {
                 LogPrint(BCLog::MASTERNODE,"Skipping just activated Masternode. Age: %ld\n", nMasternode_Age);
                 continue;                                                   // Skip masternodes younger than (default) 1 hour
@@ -621,18 +749,9 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
         if (fOnlyActive) {
             if (!mn->IsEnabled()) continue;
         }
-        uint256 n = mn->CalculateScore(hash);
-        int64_t n2 = n.GetCompact(false);
 
-        vecMasternodeScores.emplace_back(n2, mn->vin);
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (std::pair<int64_t, CTxIn> & s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (mn->vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -648,16 +767,11 @@ std::vector<std::pair<int64_t, MasternodeRef>> CMasternodeMan::GetMasternodeRank
     if (!hash) return vecMasternodeScores;
     {
         LOCK(cs);
-        // scan for winner
-        for (const auto& it : mapMasternodes) {
-            const MasternodeRef& mn = it.second;
-            if (!mn->IsEnabled()) {
-                vecMasternodeScores.emplace_back(9999, mn);
-                continue;
-            }
-
-            int64_t n2 = mn->CalculateScore(hash).GetCompact(false);
-            vecMasternodeScores.emplace_back(n2, mn);
+        const MasternodeScoresRef& scores = GetScores(hash);
+        vecMasternodeScores.reserve(scores->vScores.size());
+        for (size_t i = 0; i < scores->vScores.size(); i++) {
+            const MasternodeRef& mn = scores->vScores[i].first;
+            vecMasternodeScores.emplace_back(mn->IsEnabled() ? scores->vCompact[i] : 9999, mn);
         }
     }
     sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
@@ -667,7 +781,7 @@ std::vector<std::pair<int64_t, MasternodeRef>> CMasternodeMan::GetMasternodeRank
 int CMasternodeMan::ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
 {
     const uint256& mnbHash = mnb.GetHash();
-    if (mapSeenMasternodeBroadcast.count(mnbHash)) { //seen
+    if (HasSeenBroadcast(mnbHash)) { //seen
         masternodeSync.AddedMasternodeList(mnbHash);
         return 0;
     }
@@ -685,7 +799,7 @@ int CMasternodeMan::ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
     }
 
     // now that did the basic mnb checks, can add it.
-    mapSeenMasternodeBroadcast.emplace(mnbHash, mnb);
+    WITH_LOCK(cs_mapSeen, mapSeenMasternodeBroadcast.emplace(mnbHash, mnb));
 
     // make sure it's still unspent
     //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
@@ -704,7 +818,7 @@ int CMasternodeMan::ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
 int CMasternodeMan::ProcessMNPing(CNode* pfrom, CMasternodePing& mnp)
 {
     const uint256& mnpHash = mnp.GetHash();
-    if (mapSeenMasternodePing.count(mnpHash)) return 0; //seen
+    if (HasSeenPing(mnpHash)) return 0; //seen
 
     int nDoS = 0;
     if (mnp.CheckAndUpdate(nDoS)) return 0;
@@ -734,6 +848,7 @@ int CMasternodeMan::ProcessGetMNList(CNode* pfrom, CTxIn& vin)
         bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
 
         if (!isLocal && Params().NetworkIDString() == CBaseChainParams::MAIN) {
+            LOCK(cs);
             std::map<CNetAddr, int64_t>::iterator i = mAskedUsForMasternodeList.find(pfrom->addr);
             if (i != mAskedUsForMasternodeList.end()) {
                 int64_t t = (*i).second;
@@ -762,7 +877,7 @@ int CMasternodeMan::ProcessGetMNList(CNode* pfrom, CTxIn& vin)
                     pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
                     nInvCount++;
 
-                    if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.emplace(hash, mnb);
+                    WITH_LOCK(cs_mapSeen, mapSeenMasternodeBroadcast.emplace(hash, mnb));
 
                     if (vin == mn->vin) {
                         LogPrint(BCLog::MASTERNODE, "dseg - Sent 1 Masternode entry to peer %i\n", pfrom->GetId());
@@ -796,11 +911,16 @@ int CMasternodeMan::ProcessMessageInner(CNode* pfrom, std::string& strCommand, C
     if (fLiteMode) return 0; //disable all Masternode related functionality
     if (!masternodeSync.IsBlockchainSynced()) return 0;
 
-    LOCK(cs_process_message);
-
+    // The signatures are verified before taking cs_process_message, so that the messages
+    // relayed by different peers are checked in parallel by the message handler workers.
+    // The message keeps the result, the checks done while holding the lock don't verify
+    // the signature again.
     if (strCommand == NetMsgType::MNBROADCAST) {
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
+        if (!HasSeenBroadcast(mnb.GetHash()))
+            mnb.CheckSignature();
+        LOCK(cs_process_message);
         return ProcessMNBroadcast(pfrom, mnb);
 
     } else if (strCommand == NetMsgType::MNPING) {
@@ -808,12 +928,18 @@ int CMasternodeMan::ProcessMessageInner(CNode* pfrom, std::string& strCommand, C
         CMasternodePing mnp;
         vRecv >> mnp;
         LogPrint(BCLog::MNPING, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
+        CKeyID keyID;
+        if (!HasSeenPing(mnp.GetHash()) && GetMasternodeKeyID(mnp.vin.prevout, keyID)) {
+            mnp.CheckSignature(keyID);
+        }
+        LOCK(cs_process_message);
         return ProcessMNPing(pfrom, mnp);
 
     } else if (strCommand == NetMsgType::GETMNLIST) {
         //Get Masternode list or specific entry
         CTxIn vin;
         vRecv >> vin;
+        LOCK(cs_process_message);
         return ProcessGetMNList(pfrom, vin);
     }
     // Nothing to report
@@ -826,13 +952,17 @@ void CMasternodeMan::Remove(const COutPoint& collateralOut)
     const auto it = mapMasternodes.find(collateralOut);
     if (it != mapMasternodes.end()) {
         mapMasternodes.erase(it);
+        mapScoresCache.clear();
     }
 }
 
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast& mnb)
 {
-    mapSeenMasternodePing.emplace(mnb.lastPing.GetHash(), mnb.lastPing);
-    mapSeenMasternodeBroadcast.emplace(mnb.GetHash(), mnb);
+    {
+        LOCK(cs_mapSeen);
+        mapSeenMasternodePing.emplace(mnb.lastPing.GetHash(), mnb.lastPing);
+        mapSeenMasternodeBroadcast.emplace(mnb.GetHash(), mnb);
+    }
     masternodeSync.AddedMasternodeList(mnb.GetHash());
 
     LogPrint(BCLog::MASTERNODE,"CMasternodeMan::UpdateMasternodeList() -- masternode=%s\n", mnb.vin.prevout.ToString());
@@ -848,7 +978,12 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast& mnb)
 
 int64_t CMasternodeMan::SecondsSincePayment(const MasternodeRef& mn, const CBlockIndex* BlockReading) const
 {
-    int64_t sec = (GetAdjustedTime() - GetLastPaid(mn, BlockReading));
+    return SecondsSincePayment(mn, BlockReading, CountEnabled() * 1.25);
+}
+
+int64_t CMasternodeMan::SecondsSincePayment(const MasternodeRef& mn, const CBlockIndex* BlockReading, int nMaxDepth) const
+{
+    int64_t sec = (GetAdjustedTime() - GetLastPaid(mn, BlockReading, nMaxDepth));
     int64_t month = 60 * 60 * 24 * 30;
     if (sec < month) return sec; //if it's less than 30 days, give seconds
 
@@ -862,11 +997,21 @@ int64_t CMasternodeMan::SecondsSincePayment(const MasternodeRef& mn, const CBloc
 }
 
 int64_t CMasternodeMan::GetLastPaid(const MasternodeRef& mn, const CBlockIndex* BlockReading) const
+{
+    return GetLastPaid(mn, BlockReading, CountEnabled() * 1.25);
+}
+
+int64_t CMasternodeMan::GetLastPaid(const MasternodeRef& mn, const CBlockIndex* BlockReading, int nMaxDepth) const
 {
     if (BlockReading == nullptr) return false;
 
-    CScript mnpayee;
-    mnpayee = GetScriptForDestination(mn->pubKeyCollateralAddress.GetID());
+    const CScript& mnpayee = GetScriptForDestination(mn->pubKeyCollateralAddress.GetID());
+
+    // Search for this payee, with at least 2 votes, in the last nMaxDepth blocks. This will aid in consensus
+    // allowing the network to converge on the same payees quickly, then keep the same schedule.
+    const int nPaidHeight = masternodePayments.GetLastPaidHeight(mnpayee, BlockReading->nHeight);
+    if (nPaidHeight < 0 || nPaidHeight <= BlockReading->nHeight - nMaxDepth) return 0;
+    if (nPaidHeight == 0 && BlockReading->nHeight > 0) return 0;
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << mn->vin;
@@ -876,23 +1021,7 @@ int64_t CMasternodeMan::GetLastPaid(const MasternodeRef& mn, const CBlockIndex*
     // use a deterministic offset to break a tie -- 2.5 minutes
     int64_t nOffset = hash.GetCompact(false) % 150;
 
-    int nMnCount = CountEnabled() * 1.25;
-    for (int n = 0; n < nMnCount; n++) {
-        const auto& it = masternodePayments.mapMasternodeBlocks.find(BlockReading->nHeight);
-        if (it != masternodePayments.mapMasternodeBlocks.end()) {
-            // Search for this payee, with at least 2 votes. This will aid in consensus
-            // allowing the network to converge on the same payees quickly, then keep the same schedule.
-            if (it->second.HasPayeeWithVotes(mnpayee, 2))
-                return BlockReading->nTime + nOffset;
-        }
-        BlockReading = BlockReading->pprev;
-
-        if (BlockReading == nullptr || BlockReading->nHeight <= 0) {
-            break;
-        }
-    }
-
-    return 0;
+    return BlockReading->GetAncestor(nPaidHeight)->nTime + nOffset;
 }
 
 std::string CMasternodeMan::ToString() const
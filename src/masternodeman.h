@@ -21,6 +21,10 @@
 
 /** Maximum number of block hashes to cache */
 static const unsigned int CACHED_BLOCK_HASHES = 200;
+/** Maximum number of block hashes with cached masternode scores */
+static const unsigned int CACHED_SCORES_BLOCKS = 250;
+/** Minimum number of masternodes to calculate the scores in parallel */
+static const unsigned int SCORES_PARALLEL_MIN_SIZE = 1000;
 
 class CMasternodeMan;
 class CActiveMasternode;
@@ -57,6 +61,25 @@ public:
 //
 typedef std::shared_ptr<CMasternode> MasternodeRef;
 
+/** Scores of the masternode list for a block hash (see CMasternode::CalculateScore).
+ *  Computed once per block hash and shared by the election and ranking functions.
+ */
+struct CMasternodeScores
+{
+    // Masternodes with their score, in collateral outpoint order
+    std::vector<std::pair<MasternodeRef, uint256>> vScores;
+    // Compact scores, in the same order
+    std::vector<int64_t> vCompact;
+    // Positions in vScores, from the highest compact score (ties in outpoint order)
+    std::vector<size_t> vRanks;
+    // Position of the highest score (first in outpoint order on ties), -1 if all the scores are zero
+    int nBest{-1};
+
+    /// Score of a masternode in the list (nullptr if not found)
+    const uint256* Find(const COutPoint& collateralOut) const;
+};
+typedef std::shared_ptr<const CMasternodeScores> MasternodeScoresRef;
+
 class CMasternodeMan
 {
 private:
@@ -66,6 +89,15 @@ private:
     // critical section to protect the inner data structures specifically on messaging
     mutable RecursiveMutex cs_process_message;
 
+    // critical section to protect the seen maps. Taken after cs, and before
+    // masternodeSync.cs_mapSeenSync, nothing else is locked while holding it.
+    mutable RecursiveMutex cs_mapSeen;
+
+    // Keep track of all broadcasts I've seen
+    std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
+    // Keep track of all pings I've seen
+    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+
     // map to hold all MNs
     std::vector<CMasternode> vMasternodes;
     // map to hold all MNs (indexed by collateral outpoint)
@@ -83,17 +115,22 @@ private:
     // Memory Only. Cache last block hashes. Used to verify mn pings and winners.
     CyclingVector<uint256> cvLastBlockHashes;
 
+    // Memory Only. Masternode scores by block hash. Cleared when the list changes.
+    mutable std::map<uint256, MasternodeScoresRef> mapScoresCache;
+
+    // Return the (cached) scores of the masternode list for the given block hash. Requires cs.
+    MasternodeScoresRef GetScores(const uint256& hash) const;
+
     // Return the banning score (0 if no ban score increase is needed).
     int ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb);
     int ProcessMNPing(CNode* pfrom, CMasternodePing& mnp);
     int ProcessMessageInner(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
-public:
-    // Keep track of all broadcasts I've seen
-    std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    // Last paid time looking back at most nMaxDepth blocks from BlockReading
+    int64_t GetLastPaid(const MasternodeRef& mn, const CBlockIndex* BlockReading, int nMaxDepth) const;
+    int64_t SecondsSincePayment(const MasternodeRef& mn, const CBlockIndex* BlockReading, int nMaxDepth) const;
 
+public:
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
     // TODO: Remove this from serialization
     int64_t nDsqCount;
@@ -105,11 +142,13 @@ public:
     {
         LOCK(cs);
         READWRITE(mapMasternodes);
+        if (ser_action.ForRead()) mapScoresCache.clear();
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
         READWRITE(nDsqCount);
 
+        LOCK(cs_mapSeen);
         READWRITE(mapSeenMasternodeBroadcast);
         READWRITE(mapSeenMasternodePing);
     }
@@ -138,6 +177,21 @@ public:
 
     void DsegUpdate(CNode* pnode);
 
+    /// Seen broadcasts and pings, by hash
+    bool HasSeenBroadcast(const uint256& hash) const;
+    bool GetSeenBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet) const;
+    void RemoveSeenBroadcast(const uint256& hash);
+    /// Update the last ping of a seen broadcast, if it is known
+    void UpdateSeenBroadcastLastPing(const uint256& hash, const CMasternodePing& mnp);
+    bool HasSeenPing(const uint256& hash) const;
+    bool GetSeenPing(const uint256& hash, CMasternodePing& mnpRet) const;
+    void AddSeenPing(const CMasternodePing& mnp);
+
+    /// Get the key id of the masternode key of an entry, false if not found
+    bool GetMasternodeKeyID(const COutPoint& collateralOut, CKeyID& keyIDRet) const;
+    /// Get a shared reference to an entry (still valid after the entry is removed), null if not found
+    MasternodeRef GetMasternodeRef(const COutPoint& collateralOut) const;
+
     /// Find an entry
     CMasternode* Find(const CTxIn& vin);
     CMasternode* Find(const COutPoint& collateralOut);
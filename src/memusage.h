@@ -6,6 +6,8 @@
 #define BITCOIN_MEMUSAGE_H
 
 #include "indirectmap.h"
+#include "nodehashmap.h"
+#include "poolallocator.h"
 #include "prevector.h"
 
 #include <stdlib.h>
@@ -221,6 +223,28 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+// Pool allocated containers: all the chunks of the pool, in use or not
+
+template<std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t PoolResourceUsage(const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& resource)
+{
+    // The chunks are stored in a std::list: next, previous, and a pointer to the chunk per node
+    return (MallocUsage(sizeof(void*) * 3) + MallocUsage(resource.ChunkSizeBytes())) * resource.NumAllocatedChunks();
+}
+
+template<typename X, typename Y, typename Z, typename P, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z, P, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    return PoolResourceUsage(*m.get_allocator().resource()) + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
+template<typename X, typename Y, typename Z, typename P, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const nodehashmap<X, Y, Z, P, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    // One (node pointer, hash) slot per bucket
+    return PoolResourceUsage(*m.get_allocator().resource()) + MallocUsage((sizeof(void*) + sizeof(size_t)) * m.bucket_count());
+}
+
 // Dispatch to class method as fallback
 
 template<typename X>
@@ -8,6 +8,7 @@
 #include "merkleblock.h"
 
 #include "consensus/consensus.h"
+#include "crypto/sha256.h"
 #include "hash.h"
 #include "primitives/block.h" // for MAX_BLOCK_SIZE
 #include "utilstrencodings.h"
@@ -38,20 +39,20 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
 
 uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid)
 {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+    // hash at height 0 is the txids themself
+    if (height == 0) return vTxid[pos];
+
+    // compute the subtree level by level, from its txids, hashing all the pairs of a level at once
+    const size_t nBegin = ((size_t)pos) << height;
+    const size_t nEnd = std::min(((size_t)pos + 1) << height, vTxid.size());
+    std::vector<uint256> hashes(vTxid.begin() + nBegin, vTxid.begin() + nEnd);
+    for (int h = 0; h < height; h++) {
+        // copy the left hash if the right one is beyond the end of the array
+        if (hashes.size() & 1) hashes.push_back(hashes.back());
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
     }
+    return hashes[0];
 }
 
 void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch)
@@ -5,14 +5,62 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
 #include "hash.h"
 #include "messagesigner.h"
+#include "random.h"
+#include "script/sigcache.h"
 #include "tinyformat.h"
 #include "util.h"
 #include "utilstrencodings.h"
 
+#include <boost/thread/shared_mutex.hpp>
+
 const std::string strMessageMagic = "DarkNet Signed Message:\n";
 
+namespace {
+/**
+ * Valid signatures of the signed network messages, so that a message relayed by
+ * several peers (or to several message handler workers) is verified once.
+ */
+class CMessageSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || key id || signature)
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CMessageSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        // 32768 entries
+        setValid.setup_bytes(1 << 20);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+};
+
+static CMessageSignatureCache messageSignatureCache;
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string& strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     keyRet = DecodeSecret(strSecret);
@@ -58,6 +106,11 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, keyID, vchSig);
+    if (messageSignatureCache.Get(entry))
+        return true;
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -71,6 +124,7 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std
         return false;
     }
 
+    messageSignatureCache.Set(entry);
     return true;
 }
 
@@ -107,17 +161,28 @@ bool CSignedMessage::Sign(const std::string strSignKey)
     return Sign(key, pubkey.GetID());
 }
 
+bool CSignedMessage::VerifySignatureHash(const uint256& hash, const CKeyID& keyID, std::string& strErrorRet) const
+{
+    if (!vchSigChecked.empty() && vchSigChecked == vchSig && hashSigChecked == hash && keyIDSigChecked == keyID) {
+        if (!fSigValid) strErrorRet = "Invalid signature (already checked).";
+        return fSigValid;
+    }
+    fSigValid = CHashSigner::VerifyHash(hash, keyID, vchSig, strErrorRet);
+    vchSigChecked = vchSig;
+    hashSigChecked = hash;
+    keyIDSigChecked = keyID;
+    return fSigValid;
+}
+
 bool CSignedMessage::CheckSignature(const CKeyID& keyID) const
 {
     std::string strError = "";
 
     if (nMessVersion == MessageVersion::MESS_VER_HASH) {
-        uint256 hash = GetSignatureHash();
-        return CHashSigner::VerifyHash(hash, keyID, vchSig, strError);
+        return VerifySignatureHash(GetSignatureHash(), keyID, strError);
     }
 
-    std::string strMessage = GetStrMessage();
-    return CMessageSigner::VerifyMessage(keyID, vchSig, strMessage, strError);
+    return VerifySignatureHash(CMessageSigner::GetMessageHash(GetStrMessage()), keyID, strError);
 }
 
 std::string CSignedMessage::GetSignatureBase64() const
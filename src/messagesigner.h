@@ -54,6 +54,16 @@ class CSignedMessage
 protected:
     std::vector<unsigned char> vchSig;
 
+    // Memory only: the last signature checked, its signer and the result. The relay
+    // messages are checked before their manager lock is taken, and again under it.
+    mutable std::vector<unsigned char> vchSigChecked;
+    mutable uint256 hashSigChecked;
+    mutable CKeyID keyIDSigChecked;
+    mutable bool fSigValid{false};
+
+    /// Verify vchSig over hash, without verifying the same signature twice
+    bool VerifySignatureHash(const uint256& hash, const CKeyID& keyID, std::string& strErrorRet) const;
+
 public:
     int nMessVersion;
 
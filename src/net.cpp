@@ -364,7 +364,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char* pszDest, bool fCo
     bool proxyConnectionFailed = false;
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!socketEvents->IsUsableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -1032,7 +1032,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket)) {
+    if (!socketEvents->IsUsableSocket(hSocket)) {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
         return;
@@ -1063,15 +1063,28 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    InsertNode(pnode);
+}
+
+void CConnman::InsertNode(CNode* pnode)
+{
+    LOCK(cs_vNodes);
     {
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket != INVALID_SOCKET && socketEvents->Add(pnode->hSocket, true)) {
+            pnode->hSocketEvents = pnode->hSocket;
+            mapSocketNodes[pnode->hSocket] = pnode;
+        }
     }
+    vNodes.push_back(pnode);
 }
 
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    // Whether some sockets still have data to recv, known from an edge-triggered event
+    bool fMoreWork = false;
+    std::vector<CSocketEvents::Event> vEvents;
     while (!interruptNet) {
         //
         // Disconnect nodes
@@ -1085,6 +1098,11 @@ void CConnman::ThreadSocketHandler()
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
+                    // the socket might have been closed and reused already
+                    auto it = mapSocketNodes.find(pnode->hSocketEvents);
+                    if (it != mapSocketNodes.end() && it->second == pnode)
+                        mapSocketNodes.erase(it);
+
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
 
@@ -1135,26 +1153,13 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        const bool fPolled = socketEvents->IsPolled();
+        if (fPolled) {
+            // select() has no memory: pass the listening and node sockets on each iteration
+            for (const ListenSocket& hListenSocket : vhListenSocket) {
+                socketEvents->Want(hListenSocket.socket, true, false);
+            }
 
-        {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodes) {
                 // Implement the following logic:
@@ -1179,44 +1184,30 @@ void CConnman::ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                socketEvents->Want(pnode->hSocket, select_recv && !select_send, select_send);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        if (interruptNet)
-            return;
-
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+        // frequency to poll pnode->vSend, unless sockets are known to have more data
+        const int64_t nTimeout = fMoreWork ? 0 : 50;
+        if (!socketEvents->Wait(nTimeout, vEvents)) {
+            LogPrintf("socket %s error %s\n", SocketEventsModeToString(socketEvents->GetMode()), NetworkErrorString(WSAGetLastError()));
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(nTimeout)))
                 return;
         }
+        if (interruptNet)
+            return;
 
         //
         // Accept new connections
         //
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
-                AcceptConnection(hListenSocket);
+        for (const CSocketEvents::Event& ev : vEvents) {
+            if (!ev.fRecv)
+                continue;
+            for (const ListenSocket& hListenSocket : vhListenSocket) {
+                if (hListenSocket.socket != INVALID_SOCKET && hListenSocket.socket == ev.socket) {
+                    AcceptConnection(hListenSocket);
+                }
             }
         }
 
@@ -1226,10 +1217,19 @@ void CConnman::ThreadSocketHandler()
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
+            // Edge-triggered events are kept by the nodes until a recv() or send() would block
+            for (const CSocketEvents::Event& ev : vEvents) {
+                auto it = mapSocketNodes.find(ev.socket);
+                if (it == mapSocketNodes.end())
+                    continue;
+                it->second->fHasRecvData |= ev.fRecv || ev.fError;
+                it->second->fCanSendData |= ev.fSend;
+            }
             vNodesCopy = vNodes;
             for (CNode* pnode : vNodesCopy)
                 pnode->AddRef();
         }
+        fMoreWork = false;
         for (CNode* pnode : vNodesCopy) {
             if (interruptNet)
                 return;
@@ -1237,18 +1237,13 @@ void CConnman::ThreadSocketHandler()
             //
             // Receive
             //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+            // select() only reports readable sockets when their receive buffer is not paused
+            bool recvSet = pnode->fHasRecvData && (fPolled || !pnode->fPauseRecv);
+            bool sendSet = pnode->fCanSendData;
+            if (fPolled) {
+                pnode->fHasRecvData = pnode->fCanSendData = false;
             }
-            if (recvSet || errorSet) {
+            if (recvSet) {
                 {
                     {
                         // typical socket buffer is 8K-64K
@@ -1260,6 +1255,9 @@ void CConnman::ThreadSocketHandler()
                                 continue;
                             nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                         }
+                        // A short read drained the socket: the next data will raise a new event
+                        if (nBytes < (int)sizeof(pchBuf))
+                            pnode->fHasRecvData = false;
                         if (nBytes > 0) {
                             bool notify = false;
                             if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
@@ -1297,6 +1295,8 @@ void CConnman::ThreadSocketHandler()
                         }
                     }
                 }
+                if (!fPolled && pnode->fHasRecvData && !pnode->fPauseRecv)
+                    fMoreWork = true;
             }
 
             //
@@ -1307,6 +1307,9 @@ void CConnman::ThreadSocketHandler()
                 size_t nBytes = SocketSendData(pnode);
                 if (nBytes)
                     RecordBytesSent(nBytes);
+                // The send buffer is full, wait until the socket is reported writable again
+                if (!pnode->vSendMsg.empty())
+                    pnode->fCanSendData = false;
             }
 
             //
@@ -1833,10 +1836,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fFeeler = true;
 
     GetNodeSignals().InitializeNode(pnode, *this);
-    {
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
-    }
+    InsertNode(pnode);
 
     return true;
 }
@@ -1859,6 +1859,21 @@ void CConnman::ThreadMessageHandler()
             if (pnode->fDisconnect)
                 continue;
 
+            // A worker is processing the next message of the node
+            if (pnode->fWorkerBusy)
+                continue;
+
+            if (IsWorkerMessagePending(pnode)) {
+                {
+                    std::lock_guard<std::mutex> lock(mutexMsgWorkers);
+                    pnode->fWorkerBusy = true;
+                    pnode->AddRef();
+                    queueWorkerNodes.push_back(pnode);
+                }
+                condMsgWorkers.notify_one();
+                continue;
+            }
+
             // Receive messages
             bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -1889,6 +1904,43 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+bool CConnman::IsWorkerMessagePending(CNode* pnode)
+{
+    if (nMsgHandlerThreads == 0)
+        return false;
+    // ProcessMessages answers the pending getdata requests first, and waits for the send buffer to drain
+    if (!pnode->vRecvGetData.empty() || pnode->fPauseSend)
+        return false;
+    LOCK(pnode->cs_vProcessMsg);
+    return !pnode->vProcessMsg.empty() && IsTierTwoRelayMessageType(pnode->vProcessMsg.front().hdr.GetCommand());
+}
+
+void CConnman::ThreadMessageWorker()
+{
+    while (!flagInterruptMsgProc) {
+        CNode* pnode;
+        {
+            std::unique_lock<std::mutex> lock(mutexMsgWorkers);
+            condMsgWorkers.wait(lock, [this] { return flagInterruptMsgProc || !queueWorkerNodes.empty(); });
+            if (flagInterruptMsgProc)
+                return;
+            pnode = queueWorkerNodes.front();
+            queueWorkerNodes.pop_front();
+        }
+
+        if (!pnode->fDisconnect)
+            GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
+
+        pnode->fWorkerBusy = false;
+        {
+            LOCK(cs_vNodes);
+            pnode->Release();
+        }
+        // The node may have more messages to process, and data to send
+        WakeMessageHandler();
+    }
+}
+
 bool CConnman::BindListenPort(const CService& addrBind, std::string& strError, bool fWhitelisted)
 {
     strError = "";
@@ -2033,6 +2085,10 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+
+    for (const std::string& msg : getAllNetMessageTypes())
+        mapLatencyPerMsgCmd[msg];
+    mapLatencyPerMsgCmd[NET_MESSAGE_COMMAND_OTHER];
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2053,6 +2109,16 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
+    nMsgHandlerThreads = connOptions.nMsgHandlerThreads;
+
+    socketEvents.reset(new CSocketEvents(connOptions.socketEventsMode));
+    LogPrintf("Using %s for socket events\n", SocketEventsModeToString(socketEvents->GetMode()));
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (!socketEvents->Add(hListenSocket.socket, false)) {
+            strNodeError = _("Failed to listen for incoming connections");
+            return false;
+        }
+    }
 
     SetBestHeight(connOptions.nBestHeight);
 
@@ -2141,6 +2207,10 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMsgHandlerThreads; i++) {
+        threadMessageWorkers.emplace_back(&TraceThread<std::function<void()> >, "msgworker", std::function<void()>(std::bind(&CConnman::ThreadMessageWorker, this)));
+    }
+    LogPrintf("Using %d message handler workers\n", nMsgHandlerThreads);
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
@@ -2178,6 +2248,11 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    {
+        // synchronize with the workers waiting for a node
+        std::lock_guard<std::mutex> lock(mutexMsgWorkers);
+    }
+    condMsgWorkers.notify_all();
 
     interruptNet();
     InterruptSocks5(true);
@@ -2191,6 +2266,12 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& thread : threadMessageWorkers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageWorkers.clear();
+    queueWorkerNodes.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2222,8 +2303,10 @@ void CConnman::Stop()
         DeleteNode(pnode);
     }
     vNodes.clear();
+    mapSocketNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    socketEvents.reset();
     delete semOutbound;
     semOutbound = NULL;
     if(pnodeLocalHost)
@@ -2398,6 +2481,33 @@ int CConnman::GetBestHeight() const
     return nBestHeight.load(std::memory_order_acquire);
 }
 
+void CConnman::RecordMessageLatency(const std::string& strCommand, int64_t nQueueTime, int64_t nProcessTime)
+{
+    LOCK(cs_msgLatency);
+    // only valid commands have an entry, see mapRecvBytesPerMsgCmd
+    mapMsgCmdLatency::iterator it = mapLatencyPerMsgCmd.find(strCommand);
+    if (it == mapLatencyPerMsgCmd.end())
+        it = mapLatencyPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(it != mapLatencyPerMsgCmd.end());
+    CMessageLatencyStats& stats = it->second;
+    stats.nCount++;
+    stats.nQueueTimeTotal += nQueueTime;
+    stats.nQueueTimeMax = std::max(stats.nQueueTimeMax, nQueueTime);
+    stats.nProcessTimeTotal += nProcessTime;
+    stats.nProcessTimeMax = std::max(stats.nProcessTimeMax, nProcessTime);
+}
+
+mapMsgCmdLatency CConnman::GetMessageLatencyStats() const
+{
+    LOCK(cs_msgLatency);
+    return mapLatencyPerMsgCmd;
+}
+
+int CConnman::GetMessageHandlerThreads() const
+{
+    return nMsgHandlerThreads;
+}
+
 unsigned int CConnman::GetReceiveFloodSize() const { return nReceiveFloodSize; }
 unsigned int CConnman::GetSendBufferSize() const{ return nSendBufferMaxSize; }
 
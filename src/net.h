@@ -18,6 +18,7 @@
 #include "netaddress.h"
 #include "protocol.h"
 #include "random.h"
+#include "socketevents.h"
 #include "streams.h"
 #include "sync.h"
 #include "uint256.h"
@@ -29,6 +30,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -82,12 +84,29 @@ static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -msghandthreads default: workers processing tier two relay messages next to the msghand thread */
+static const int DEFAULT_MSGHAND_THREADS = 2;
+/** Maximum number of message handler workers */
+static const int MAX_MSGHAND_THREADS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
 typedef int NodeId;
 
+/** Processing latency of the messages of a command, in microseconds */
+struct CMessageLatencyStats
+{
+    uint64_t nCount{0};
+    //! from the receipt of the message to the start of its processing
+    int64_t nQueueTimeTotal{0};
+    int64_t nQueueTimeMax{0};
+    //! ProcessMessage run time
+    int64_t nProcessTimeTotal{0};
+    int64_t nProcessTimeMax{0};
+};
+typedef std::map<std::string, CMessageLatencyStats> mapMsgCmdLatency;
+
 struct AddedNodeInfo
 {
     std::string strAddedNode;
@@ -143,6 +162,8 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+        int nMsgHandlerThreads = DEFAULT_MSGHAND_THREADS;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -276,6 +297,11 @@ public:
     CSipHasher GetDeterministicRandomizer(uint64_t id);
 
     unsigned int GetReceiveFloodSize() const;
+
+    /** Record the latency of a processed message (called by ProcessMessages) */
+    void RecordMessageLatency(const std::string& strCommand, int64_t nQueueTime, int64_t nProcessTime);
+    mapMsgCmdLatency GetMessageLatencyStats() const;
+    int GetMessageHandlerThreads() const;
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -288,7 +314,12 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections();
     void ThreadMessageHandler();
+    void ThreadMessageWorker();
+    /** Whether the next message of the node can be processed by a message handler worker */
+    bool IsWorkerMessagePending(CNode* pnode);
     void AcceptConnection(const ListenSocket& hListenSocket);
+    /** Add a connected node to vNodes, and its socket to the socket events */
+    void InsertNode(CNode* pnode);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -353,6 +384,8 @@ private:
     RecursiveMutex cs_vAddedNodes;
     std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
+    //! Nodes of vNodes by socket, to dispatch the socket events. Protected by cs_vNodes.
+    std::unordered_map<SOCKET, CNode*> mapSocketNodes;
     mutable RecursiveMutex cs_vNodes;
     std::atomic<NodeId> nLastNodeId;
 
@@ -379,6 +412,22 @@ private:
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
+    int nMsgHandlerThreads{0};
+    /**
+     * Nodes whose next message is processed by the message handler workers.
+     * The msghand thread skips a node while it is queued here or being processed
+     * (CNode::fWorkerBusy), so the messages of a peer are still processed in order.
+     */
+    std::deque<CNode*> queueWorkerNodes;
+    std::condition_variable condMsgWorkers;
+    std::mutex mutexMsgWorkers;
+
+    mutable RecursiveMutex cs_msgLatency;
+    mapMsgCmdLatency mapLatencyPerMsgCmd;
+
+    /** Readiness of the node and listening sockets (select or epoll backend) */
+    std::unique_ptr<CSocketEvents> socketEvents;
+
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
@@ -386,6 +435,7 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageWorkers;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover();
@@ -594,6 +644,13 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    //! Set while the next message of the node is queued for, or processed by, a message handler worker
+    std::atomic_bool fWorkerBusy{false};
+    //! Socket as registered in the socket events, kept after it is closed.
+    SOCKET hSocketEvents{INVALID_SOCKET};
+    //! Whether the socket has data to recv / room to send: only used by the socket handler thread.
+    bool fHasRecvData{false};
+    bool fCanSendData{false};
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
@@ -7,6 +7,7 @@
 
 #include "net_processing.h"
 
+#include "blockencodings.h"
 #include "budget/budgetmanager.h"
 #include "chain.h"
 #include "masternodeman.h"
@@ -84,6 +85,15 @@ int nQueuedValidatedHeaders = 0;
 /** Number of preferable block download peers. */
 int nPreferredDownload = 0;
 
+/** Peers asked to announce new blocks to us with cmpctblock messages, oldest first. Protected by cs_main. */
+std::list<NodeId> lNodesAnnouncingHeaderAndIDs;
+
+/** Other peers that announced a block already in flight, in announce order. The block is asked
+ *  to the first one still connected when the request fails (timeout, disconnection, invalid
+ *  cmpctblock). Protected by cs_main. */
+std::map<uint256, std::list<NodeId> > mapBlockAnnouncers;
+static const unsigned int MAX_BLOCK_ANNOUNCERS = 8;
+
 } // anon namespace
 
 
@@ -210,6 +220,13 @@ struct CNodeState {
     int nBlocksInFlight;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
+    //! Whether this peer wants new blocks announced with a cmpctblock rather than an inv.
+    bool fPreferHeaderAndIDs;
+    //! Whether this peer will send us cmpctblocks if we request them.
+    bool fProvidesHeaderAndIDs;
+    //! The block being reconstructed from this peer's last cmpctblock, waiting for a blocktxn.
+    uint256 hashPartialBlock;
+    std::shared_ptr<PartiallyDownloadedBlock> partialBlock;
 
     CNodeBlocks nodeBlocks;
 
@@ -224,6 +241,8 @@ struct CNodeState {
         nStallingSince = 0;
         nBlocksInFlight = 0;
         fPreferredDownload = false;
+        fPreferHeaderAndIDs = false;
+        fProvidesHeaderAndIDs = false;
     }
 };
 
@@ -298,6 +317,7 @@ void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime)
         mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
+    lNodesAnnouncingHeaderAndIDs.remove(nodeid);
 
     mapNodeState.erase(nodeid);
 }
@@ -332,6 +352,31 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex*
     mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
 }
 
+// Requires cs_main.
+/** Ask a peer that just delivered us a new tip to announce the next blocks with a cmpctblock
+ *  (high-bandwidth mode), dropping the peer that was selected the longest time ago. */
+void MaybeSetPeerAsAnnouncingHeaderAndIDs(CNode* pfrom, CConnman& connman)
+{
+    CNodeState* nodestate = State(pfrom->GetId());
+    if (!nodestate || !nodestate->fProvidesHeaderAndIDs) {
+        return;
+    }
+    const NodeId nodeid = pfrom->GetId();
+    if (std::find(lNodesAnnouncingHeaderAndIDs.begin(), lNodesAnnouncingHeaderAndIDs.end(), nodeid) != lNodesAnnouncingHeaderAndIDs.end()) {
+        return;
+    }
+    if (lNodesAnnouncingHeaderAndIDs.size() >= MAX_CMPCTBLOCK_ANNOUNCING_PEERS) {
+        // As per BIP152, we only get 3 of our peers to announce blocks using compact encodings.
+        connman.ForNode(lNodesAnnouncingHeaderAndIDs.front(), [&connman](CNode* pnodeStop) {
+            connman.PushMessage(pnodeStop, CNetMsgMaker(pnodeStop->GetSendVersion()).Make(NetMsgType::SENDCMPCT, false, (uint64_t)1));
+            return true;
+        });
+        lNodesAnnouncingHeaderAndIDs.pop_front();
+    }
+    connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SENDCMPCT, true, (uint64_t)1));
+    lNodesAnnouncingHeaderAndIDs.push_back(nodeid);
+}
+
 /** Check whether the last unknown block a peer advertised is not yet known. */
 void ProcessBlockAvailability(NodeId nodeid)
 {
@@ -608,9 +653,38 @@ void PeerLogicValidation::UpdatedBlockTip(const CBlockIndex* pindexNew, const CB
 
     if (!fInitialDownload) {
         const uint256& hashNewTip = pindexNew->GetBlockHash();
+        // A tip that extends the previous one is pushed as a cmpctblock to the peers
+        // that asked for it, the block is read from disk once for all of them, before
+        // taking cs_main and the nodes lock.
+        std::unique_ptr<CBlockHeaderAndShortTxIDs> pcmpctblock;
+        bool fCompactRelay = false;
+        if (pindexFork == pindexNew->pprev) {
+            LOCK(cs_main);
+            for (const auto& entry : mapNodeState) {
+                if (entry.second.fPreferHeaderAndIDs) {
+                    fCompactRelay = true;
+                    break;
+                }
+            }
+        }
+        if (fCompactRelay) {
+            CBlock block;
+            if (ReadBlockFromDisk(block, pindexNew)) {
+                pcmpctblock.reset(new CBlockHeaderAndShortTxIDs(block));
+            }
+        }
+        LOCK(cs_main);
         // Relay inventory, but don't relay old inventory during initial block download.
-        connman->ForEachNode([nNewHeight, hashNewTip](CNode* pnode) {
-            if (nNewHeight > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : 0)) {
+        connman->ForEachNode([this, nNewHeight, hashNewTip, &pcmpctblock](CNode* pnode) {
+            if (nNewHeight <= (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : 0)) {
+                return;
+            }
+            CNodeState* state = State(pnode->GetId());
+            if (pcmpctblock && state && state->fPreferHeaderAndIDs) {
+                LogPrint(BCLog::CMPCTBLOCK, "%s sending cmpctblock %s to peer=%d\n", __func__, hashNewTip.ToString(), pnode->GetId());
+                pnode->AddInventoryKnown(CInv(MSG_BLOCK, hashNewTip));
+                connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            } else {
                 pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
             }
         });
@@ -710,13 +784,13 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         }
         return false;
     case MSG_MASTERNODE_ANNOUNCE:
-        if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
+        if (mnodeman.HasSeenBroadcast(inv.hash)) {
             masternodeSync.AddedMasternodeList(inv.hash);
             return true;
         }
         return false;
     case MSG_MASTERNODE_PING:
-        return mnodeman.mapSeenMasternodePing.count(inv.hash);
+        return mnodeman.HasSeenPing(inv.hash);
     }
     // Don't know what it is, just say we already got one
     return true;
@@ -812,20 +886,22 @@ bool static PushTierTwoGetDataRequest(const CInv& inv,
     }
 
     if (inv.type == MSG_MASTERNODE_ANNOUNCE) {
-        if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
+        CMasternodeBroadcast mnb;
+        if (mnodeman.GetSeenBroadcast(inv.hash, mnb)) {
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss.reserve(1000);
-            ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash];
+            ss << mnb;
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, ss));
             return true;
         }
     }
 
     if (inv.type == MSG_MASTERNODE_PING) {
-        if (mnodeman.mapSeenMasternodePing.count(inv.hash)) {
+        CMasternodePing mnp;
+        if (mnodeman.GetSeenPing(inv.hash, mnp)) {
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss.reserve(1000);
-            ss << mnodeman.mapSeenMasternodePing[inv.hash];
+            ss << mnp;
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss));
             return true;
         }
@@ -858,14 +934,25 @@ void static ProcessGetBlockData(CNode* pfrom, const CInv& inv, CConnman& connman
     }
     // Don't send not-validated blocks
     if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
-        // Send block from disk
-        CBlock block;
-        if (!ReadBlockFromDisk(block, (*mi).second))
-            assert(!"cannot load block from disk");
-        if (inv.type == MSG_BLOCK)
-            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
-        else // MSG_FILTERED_BLOCK)
+        // Only blocks near the tip can be rebuilt from the peer's mempool, older ones are sent in full
+        const bool fSendCmpct = inv.type == MSG_CMPCT_BLOCK && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+        if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fSendCmpct)) {
+            // Send the block as stored on disk, without deserializing it
+            std::vector<unsigned char> vchBlock;
+            if (!ReadRawBlockFromDisk(vchBlock, mi->second))
+                assert(!"cannot load block from disk");
+            connman.PushMessage(pfrom, msgMaker.MakeRaw(NetMsgType::BLOCK, std::move(vchBlock)));
+        } else if (fSendCmpct) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, mi->second))
+                assert(!"cannot load block from disk");
+            CBlockHeaderAndShortTxIDs cmpctblock(block);
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
+        } else // MSG_FILTERED_BLOCK)
         {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, mi->second))
+                assert(!"cannot load block from disk");
             bool send_ = false;
             CMerkleBlock merkleBlock;
             {
@@ -965,7 +1052,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, const std::atomic<bo
     if (it != pfrom->vRecvGetData.end()) {
         const CInv &inv = *it;
         it++;
-        if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+        if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
             ProcessGetBlockData(pfrom, inv, connman, interruptMsgProc);
         }
     }
@@ -1018,6 +1105,90 @@ static void CheckBlockSpam(CValidationState& state, CNode* pfrom, const uint256&
     }
 }
 
+/** Process a block received from a peer, either in full or rebuilt from a cmpctblock. */
+static void ProcessBlockFromPeer(CNode* pfrom, const std::shared_ptr<CBlock>& pblock, CConnman& connman)
+{
+    CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    const uint256& hashBlock = pblock->GetHash();
+    CInv inv(MSG_BLOCK, hashBlock);
+
+    // sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
+    if (!mapBlockIndex.count(pblock->hashPrevBlock)) {
+        CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator(););
+        if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
+            // we already asked for this block, so lets work backwards and ask for the previous block
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, locator, pblock->hashPrevBlock));
+            pfrom->vBlockRequested.emplace_back(pblock->hashPrevBlock);
+        } else {
+            // ask to sync to this block
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, locator, hashBlock));
+            pfrom->vBlockRequested.emplace_back(hashBlock);
+        }
+    } else {
+        pfrom->AddInventoryKnown(inv);
+        CValidationState state;
+        if (!mapBlockIndex.count(hashBlock)) {
+            WITH_LOCK(cs_main, MarkBlockAsReceived(hashBlock); );
+            bool fAccepted = true;
+            ProcessNewBlock(state, pfrom, pblock, nullptr, &fAccepted);
+            if (!fAccepted) {
+                CheckBlockSpam(state, pfrom, hashBlock);
+            } else if (state.IsValid()) {
+                LOCK(cs_main);
+                // A peer that delivered us a new tip is likely to be a good source for the next ones
+                if (!IsInitialBlockDownload() && chainActive.Tip()->GetBlockHash() == hashBlock) {
+                    MaybeSetPeerAsAnnouncingHeaderAndIDs(pfrom, connman);
+                }
+            }
+            WITH_LOCK(cs_main, mapBlockSource.emplace(hashBlock, pfrom->GetId()); );
+            int nDoS;
+            if(state.IsInvalid(nDoS)) {
+                assert (state.GetRejectCode() < REJECT_INTERNAL); // Blocks are never rejected with internal reject codes
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, std::string(NetMsgType::BLOCK), state.GetRejectCode(),
+                    state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
+                if(nDoS > 0) {
+                    TRY_LOCK(cs_main, lockMain);
+                    if(lockMain) Misbehaving(pfrom->GetId(), nDoS);
+                }
+            }
+            //disconnect this node if its old protocol version
+            pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol(), NetMsgType::BLOCK);
+        } else {
+            LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, pblock->GetHash().GetHex());
+        }
+    }
+}
+
+static void RequestFullBlock(CNode* pfrom, const uint256& hashBlock, CConnman& connman)
+{
+    std::vector<CInv> vInv(1, CInv(MSG_BLOCK, hashBlock));
+    connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::GETDATA, vInv));
+}
+
+// Requires cs_main.
+/** Complete the block being reconstructed from a peer's cmpctblock with the transactions that
+ *  were missing from our mempool. Returns null if that fails, after asking for the full block
+ *  or punishing the peer for sending invalid data. */
+static std::shared_ptr<CBlock> FillPartialBlock(CNode* pfrom, CNodeState* nodestate, const std::vector<CTransactionRef>& vtx_missing, CConnman& connman)
+{
+    const uint256 hashBlock = nodestate->hashPartialBlock;
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    ReadStatus status = nodestate->partialBlock->FillBlock(*pblock, vtx_missing);
+    nodestate->partialBlock.reset();
+    nodestate->hashPartialBlock.SetNull();
+    if (status == READ_STATUS_INVALID) {
+        MarkBlockAsReceived(hashBlock);
+        Misbehaving(pfrom->GetId(), 100);
+        LogPrintf("Peer %d sent us invalid compact block/non-matching block transactions\n", pfrom->id);
+        return nullptr;
+    } else if (status == READ_STATUS_FAILED) {
+        // Might have collided, fall back to getdata now
+        RequestFullBlock(pfrom, hashBlock, connman);
+        return nullptr;
+    }
+    return pblock;
+}
+
 bool fRequestedSporksIDB = false;
 bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
@@ -1212,6 +1383,12 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         LogPrintf("New outbound peer connected: version: %d, blocks=%d, peer=%d%s\n",
                   pfrom->nVersion.load(), pfrom->nStartingHeight, pfrom->GetId(),
                   (fLogIPs ? strprintf(", peeraddr=%s", pfrom->addr.ToString()) : ""));
+
+        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
+            // Tell our peer we are willing to provide version-1 cmpctblocks, without
+            // asking it to announce new blocks with them (yet).
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, false, (uint64_t)1));
+        }
     }
 
 
@@ -1295,10 +1472,25 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
-                if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
-                    // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
+                auto itInFlight = mapBlocksInFlight.find(inv.hash);
+                if (!fAlreadyHave && !fImporting && !fReindex && itInFlight == mapBlocksInFlight.end()) {
+                    // Add this to the list of blocks to request, once synced the block is
+                    // rebuilt from a cmpctblock and our mempool when the peer can provide it.
+                    // The header of an announced block is not known yet, no pindex to pass.
+                    if (!IsInitialBlockDownload() && State(pfrom->GetId())->fProvidesHeaderAndIDs) {
+                        vToFetch.emplace_back(MSG_CMPCT_BLOCK, inv.hash);
+                        MarkBlockAsInFlight(pfrom->GetId(), inv.hash);
+                    } else {
+                        vToFetch.push_back(inv);
+                    }
                     LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                } else if (!fAlreadyHave && itInFlight != mapBlocksInFlight.end() && itInFlight->second.first != pfrom->GetId()) {
+                    // Requested from another peer already, this one is asked if that request fails
+                    std::list<NodeId>& announcers = mapBlockAnnouncers[inv.hash];
+                    if (announcers.size() < MAX_BLOCK_ANNOUNCERS &&
+                            std::find(announcers.begin(), announcers.end(), pfrom->GetId()) == announcers.end()) {
+                        announcers.push_back(pfrom->GetId());
+                    }
                 }
             }
 
@@ -1585,51 +1777,158 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     {
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
-        const uint256& hashBlock = pblock->GetHash();
-        CInv inv(MSG_BLOCK, hashBlock);
-        LogPrint(BCLog::NET, "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
-
-        // sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
-        if (!mapBlockIndex.count(pblock->hashPrevBlock)) {
-            CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator(););
-            if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
-                // we already asked for this block, so lets work backwards and ask for the previous block
-                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, locator, pblock->hashPrevBlock));
-                pfrom->vBlockRequested.emplace_back(pblock->hashPrevBlock);
-            } else {
-                // ask to sync to this block
-                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, locator, hashBlock));
-                pfrom->vBlockRequested.emplace_back(hashBlock);
+        LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->id);
+        ProcessBlockFromPeer(pfrom, pblock, connman);
+    }
+
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == 1) {
+            LOCK(cs_main);
+            CNodeState* nodestate = State(pfrom->GetId());
+            nodestate->fProvidesHeaderAndIDs = true;
+            nodestate->fPreferHeaderAndIDs = fAnnounceUsingCMPCTBLOCK;
+        }
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+        const uint256& hashBlock = cmpctblock.header.GetHash();
+        LogPrint(BCLog::CMPCTBLOCK, "received cmpctblock %s (%u txn) peer=%d\n", hashBlock.ToString(), cmpctblock.BlockTxCount(), pfrom->id);
+
+        std::shared_ptr<CBlock> pblock;
+        {
+            LOCK(cs_main);
+            pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hashBlock));
+            if (mapBlockIndex.count(hashBlock)) {
+                MarkBlockAsReceived(hashBlock);
+                return true;
             }
-        } else {
-            pfrom->AddInventoryKnown(inv);
+            // A block on top of an unknown parent, or during the initial sync, is requested in full:
+            // the block handler then asks for the missing blocks.
+            if (!mapBlockIndex.count(cmpctblock.header.hashPrevBlock) || IsInitialBlockDownload()) {
+                RequestFullBlock(pfrom, hashBlock, connman);
+                return true;
+            }
+
+            // Validate the header before reconstructing the block and asking for its missing
+            // transactions. It is not added to the block index: the block would then be seen as
+            // known by the other peers announcing it (AlreadyHave), while we only have the header.
             CValidationState state;
-            if (!mapBlockIndex.count(hashBlock)) {
-                WITH_LOCK(cs_main, MarkBlockAsReceived(hashBlock); );
-                bool fAccepted = true;
-                ProcessNewBlock(state, pfrom, pblock, nullptr, &fAccepted);
-                if (!fAccepted) {
-                    CheckBlockSpam(state, pfrom, hashBlock);
-                }
-                WITH_LOCK(cs_main, mapBlockSource.emplace(hashBlock, pfrom->GetId()); );
+            if (!TestBlockHeader(CBlock(cmpctblock.header), state)) {
                 int nDoS;
-                if(state.IsInvalid(nDoS)) {
-                    assert (state.GetRejectCode() < REJECT_INTERNAL); // Blocks are never rejected with internal reject codes
-                    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, strCommand, state.GetRejectCode(),
-                        state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
-                    if(nDoS > 0) {
-                        TRY_LOCK(cs_main, lockMain);
-                        if(lockMain) Misbehaving(pfrom->GetId(), nDoS);
+                if (state.IsInvalid(nDoS)) {
+                    MarkBlockAsReceived(hashBlock);
+                    if (nDoS > 0)
+                        Misbehaving(pfrom->GetId(), nDoS);
+                    LogPrintf("Peer %d sent us a compact block with an invalid header %s\n", pfrom->id, hashBlock.ToString());
+                }
+                return true;
+            }
+
+            CNodeState* nodestate = State(pfrom->GetId());
+            nodestate->hashPartialBlock = hashBlock;
+            nodestate->partialBlock = std::make_shared<PartiallyDownloadedBlock>(&mempool);
+            ReadStatus status = nodestate->partialBlock->InitData(cmpctblock);
+            if (status != READ_STATUS_OK) {
+                nodestate->partialBlock.reset();
+                nodestate->hashPartialBlock.SetNull();
+                if (status == READ_STATUS_INVALID) {
+                    MarkBlockAsReceived(hashBlock);
+                    Misbehaving(pfrom->GetId(), 100);
+                    LogPrintf("Peer %d sent us invalid compact block\n", pfrom->id);
+                } else {
+                    // Duplicate txindexes, request the full block
+                    RequestFullBlock(pfrom, hashBlock, connman);
+                }
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+                if (!nodestate->partialBlock->IsTxAvailable(i))
+                    req.indexes.push_back(i);
+            }
+            if (req.indexes.empty()) {
+                pblock = FillPartialBlock(pfrom, nodestate, std::vector<CTransactionRef>(), connman);
+            } else {
+                req.blockhash = hashBlock;
+                if (!mapBlocksInFlight.count(hashBlock))
+                    MarkBlockAsInFlight(pfrom->GetId(), hashBlock);
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKTXN, req));
+            }
+        } // release cs_main
+
+        if (pblock)
+            ProcessBlockFromPeer(pfrom, pblock, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        bool fSendFullBlock = false;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
+            if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrint(BCLog::CMPCTBLOCK, "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->id);
+                return true;
+            }
+
+            if (it->second->nHeight >= chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+                CBlock block;
+                if (!ReadBlockFromDisk(block, it->second))
+                    assert(!"cannot load block from disk");
+
+                BlockTransactions resp(req);
+                for (size_t i = 0; i < req.indexes.size(); i++) {
+                    if (req.indexes[i] >= block.vtx.size()) {
+                        Misbehaving(pfrom->GetId(), 100);
+                        LogPrintf("Peer %d sent us a getblocktxn with out-of-bounds tx indices\n", pfrom->id);
+                        return true;
                     }
+                    resp.txn[i] = block.vtx[req.indexes[i]];
                 }
-                //disconnect this node if its old protocol version
-                pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol(), strCommand);
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
             } else {
-                LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, pblock->GetHash().GetHex());
+                // Only recent blocks are served through blocktxn, a peer asking for an older
+                // one gets the full block, subject to the usual getdata checks.
+                LogPrint(BCLog::CMPCTBLOCK, "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->id, MAX_BLOCKTXN_DEPTH);
+                fSendFullBlock = true;
             }
+        } // release cs_main
+
+        if (fSendFullBlock) {
+            pfrom->vRecvGetData.emplace_back(MSG_BLOCK, req.blockhash);
+            ProcessGetData(pfrom, connman, interruptMsgProc);
         }
     }
 
+    else if (strCommand == NetMsgType::BLOCKTXN && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        std::shared_ptr<CBlock> pblock;
+        {
+            LOCK(cs_main);
+            CNodeState* nodestate = State(pfrom->GetId());
+            if (!nodestate->partialBlock || nodestate->hashPartialBlock != resp.blockhash) {
+                LogPrint(BCLog::CMPCTBLOCK, "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->id);
+                return true;
+            }
+            pblock = FillPartialBlock(pfrom, nodestate, resp.txn, connman);
+        } // release cs_main
+
+        if (pblock)
+            ProcessBlockFromPeer(pfrom, pblock, connman);
+    }
+
     // This asymmetric behavior for inbound and outbound connections was introduced
     // to prevent a fingerprinting attack: an attacker can send specific fake addresses
     // to users' AddrMan and later request them by sending getaddr messages.
@@ -1914,6 +2213,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
 
     // Process message
     bool fRet = false;
+    const int64_t nProcessStart = GetTimeMicros();
     try {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
         if (interruptMsgProc)
@@ -1936,6 +2236,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
     } catch (...) {
         PrintExceptionContinue(NULL, "ProcessMessages()");
     }
+    connman.RecordMessageLatency(strCommand, nProcessStart - msg.nTime, GetTimeMicros() - nProcessStart);
 
     if (!fRet)
         LogPrint(BCLog::NET, "ProcessMessage(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -2237,6 +2538,28 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
             }
         }
 
+        // Blocks this peer announced, whose request to another peer failed
+        for (auto it = mapBlockAnnouncers.begin(); it != mapBlockAnnouncers.end();) {
+            std::list<NodeId>& announcers = it->second;
+            while (!announcers.empty() && !State(announcers.front()))
+                announcers.pop_front();
+            if (announcers.empty() || mapBlockIndex.count(it->first)) {
+                it = mapBlockAnnouncers.erase(it);
+                continue;
+            }
+            if (announcers.front() == pto->GetId() && !mapBlocksInFlight.count(it->first)) {
+                announcers.pop_front();
+                if (!IsInitialBlockDownload() && state.fProvidesHeaderAndIDs) {
+                    vGetData.emplace_back(MSG_CMPCT_BLOCK, it->first);
+                } else {
+                    vGetData.emplace_back(MSG_BLOCK, it->first);
+                }
+                MarkBlockAsInFlight(pto->GetId(), it->first);
+                LogPrint(BCLog::NET, "Requesting block %s again from announcer peer=%d\n", it->first.ToString(), pto->id);
+            }
+            ++it;
+        }
+
         //
         // Message: getdata (non-blocks)
         //
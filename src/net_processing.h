@@ -28,6 +28,12 @@ static const unsigned int INVENTORY_BROADCAST_INTERVAL = 5;
 /** Maximum number of inventory items to send per transmission.
  *  Limits the impact of low-fee transaction floods. */
 static const unsigned int INVENTORY_BROADCAST_MAX = 7 * INVENTORY_BROADCAST_INTERVAL;
+/** Maximum number of peers asked to announce new blocks with cmpctblock messages (BIP152 high-bandwidth mode). */
+static const unsigned int MAX_CMPCTBLOCK_ANNOUNCING_PEERS = 3;
+/** Maximum depth of blocks served as a cmpctblock, deeper blocks are sent in full. */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth of blocks whose transactions are served through blocktxn, deeper blocks are sent in full. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
 
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
@@ -0,0 +1,305 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODEHASHMAP_H
+#define BITCOIN_NODEHASHMAP_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Hash map with an open addressing (linear probing) index of pointers to
+ * separately allocated nodes.
+ *
+ * Lookups probe a flat array of (hash, node pointer) slots, compare the
+ * stored hashes first and only dereference the nodes whose hash matches,
+ * instead of walking the bucket lists of std::unordered_map. The nodes
+ * themselves do not move: like with std::unordered_map, pointers and
+ * references to the elements stay valid until they are erased, and only the
+ * iterators are invalidated by an insertion that grows the index. Erased
+ * slots are marked as deleted, so erasing while iterating (erase returns the
+ * next element) does not skip or repeat elements.
+ *
+ * It implements the subset of the std::unordered_map interface used by the
+ * coins cache (see CCoinsMap), with the nodes allocated by Alloc, which is
+ * meant to be a PoolAllocator.
+ */
+template <typename K, typename T, typename Hash, typename Pred, typename Alloc>
+class nodehashmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef Hash hasher;
+    typedef Pred key_equal;
+    typedef Alloc allocator_type;
+    typedef std::size_t size_type;
+
+private:
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<value_type> node_allocator;
+    typedef std::allocator_traits<node_allocator> node_traits;
+
+    struct Slot {
+        //! null if the slot is free, Deleted() if its node was erased
+        value_type* node;
+        std::size_t hash;
+    };
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Slot> slot_allocator;
+    typedef std::allocator_traits<slot_allocator> slot_traits;
+
+    static value_type* Deleted() { return reinterpret_cast<value_type*>(alignof(value_type)); }
+    static bool IsUsed(const Slot& slot) { return slot.node != nullptr && slot.node != Deleted(); }
+
+    static const std::size_t MIN_SLOTS = 16;
+
+    hasher m_hash;
+    key_equal m_equal;
+    node_allocator m_node_alloc;
+    slot_allocator m_slot_alloc;
+    Slot* m_slots{nullptr};
+    //! Number of slots, a power of two
+    std::size_t m_capacity{0};
+    std::size_t m_size{0};
+    std::size_t m_deleted{0};
+
+    template <bool Const>
+    class iterator_base
+    {
+        friend class nodehashmap;
+        typedef typename std::conditional<Const, const Slot*, Slot*>::type slot_pointer;
+        slot_pointer m_slot;
+        slot_pointer m_end;
+
+        void SkipFree()
+        {
+            while (m_slot != m_end && !IsUsed(*m_slot)) ++m_slot;
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename nodehashmap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        iterator_base() : m_slot(nullptr), m_end(nullptr) {}
+        iterator_base(slot_pointer slot, slot_pointer end) : m_slot(slot), m_end(end) { SkipFree(); }
+        //! iterator to const_iterator conversion
+        template <bool C, typename = typename std::enable_if<Const && !C>::type>
+        iterator_base(const iterator_base<C>& it) : m_slot(it.m_slot), m_end(it.m_end) {}
+
+        reference operator*() const { return *m_slot->node; }
+        pointer operator->() const { return m_slot->node; }
+        iterator_base& operator++()
+        {
+            ++m_slot;
+            SkipFree();
+            return *this;
+        }
+        iterator_base operator++(int)
+        {
+            iterator_base ret = *this;
+            ++*this;
+            return ret;
+        }
+        template <bool C>
+        bool operator==(const iterator_base<C>& other) const { return m_slot == other.m_slot; }
+        template <bool C>
+        bool operator!=(const iterator_base<C>& other) const { return m_slot != other.m_slot; }
+
+        template <bool C>
+        friend class iterator_base;
+    };
+
+public:
+    typedef iterator_base<false> iterator;
+    typedef iterator_base<true> const_iterator;
+
+    explicit nodehashmap(size_type nSlots, const hasher& hash = hasher(), const key_equal& equal = key_equal(), const allocator_type& alloc = allocator_type())
+        : m_hash(hash), m_equal(equal), m_node_alloc(alloc), m_slot_alloc(alloc)
+    {
+        if (nSlots > 0) Rehash(nSlots);
+    }
+    nodehashmap(const nodehashmap&) = delete;
+    nodehashmap& operator=(const nodehashmap&) = delete;
+
+    ~nodehashmap()
+    {
+        clear();
+        if (m_slots) slot_traits::deallocate(m_slot_alloc, m_slots, m_capacity);
+    }
+
+    iterator begin() { return iterator(m_slots, m_slots + m_capacity); }
+    iterator end() { return iterator(m_slots + m_capacity, m_slots + m_capacity); }
+    const_iterator begin() const { return const_iterator(m_slots, m_slots + m_capacity); }
+    const_iterator end() const { return const_iterator(m_slots + m_capacity, m_slots + m_capacity); }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    //! Number of slots of the index, for the memory usage
+    size_type bucket_count() const { return m_capacity; }
+    allocator_type get_allocator() const { return allocator_type(m_node_alloc); }
+
+    iterator find(const key_type& key)
+    {
+        Slot* slot = Find(key, m_hash(key));
+        return slot ? iterator(slot, m_slots + m_capacity) : end();
+    }
+
+    const_iterator find(const key_type& key) const
+    {
+        const Slot* slot = const_cast<nodehashmap*>(this)->Find(key, m_hash(key));
+        return slot ? const_iterator(slot, m_slots + m_capacity) : end();
+    }
+
+    size_type count(const key_type& key) const { return find(key) != end(); }
+
+    //! Like std::unordered_map::emplace, with the key given as a single argument (usually forward_as_tuple(key))
+    template <typename KeyArg, typename... ValueArgs>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, std::tuple<KeyArg> key_arg, std::tuple<ValueArgs...> value_args)
+    {
+        const key_type& key = std::get<0>(key_arg);
+        const std::size_t hash = m_hash(key);
+        Slot* slot = Find(key, hash);
+        if (slot) return std::make_pair(iterator(slot, m_slots + m_capacity), false);
+        value_type* node = node_traits::allocate(m_node_alloc, 1);
+        try {
+            node_traits::construct(m_node_alloc, node, std::piecewise_construct, std::forward_as_tuple(key), std::move(value_args));
+        } catch (...) {
+            node_traits::deallocate(m_node_alloc, node, 1);
+            throw;
+        }
+        return std::make_pair(iterator(Insert(node, hash), m_slots + m_capacity), true);
+    }
+
+    std::pair<iterator, bool> emplace(const key_type& key, mapped_type&& value)
+    {
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::move(value)));
+    }
+
+    mapped_type& operator[](const key_type& key)
+    {
+        const std::size_t hash = m_hash(key);
+        Slot* slot = Find(key, hash);
+        if (slot) return slot->node->second;
+        value_type* node = node_traits::allocate(m_node_alloc, 1);
+        try {
+            node_traits::construct(m_node_alloc, node, std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+        } catch (...) {
+            node_traits::deallocate(m_node_alloc, node, 1);
+            throw;
+        }
+        return Insert(node, hash)->node->second;
+    }
+
+    //! Erase the element at it, return an iterator to the next one
+    iterator erase(const_iterator it)
+    {
+        Slot* slot = const_cast<Slot*>(it.m_slot);
+        DestroyNode(slot->node);
+        slot->node = Deleted();
+        m_size--;
+        m_deleted++;
+        return iterator(slot + 1, m_slots + m_capacity);
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    size_type erase(const key_type& key)
+    {
+        const_iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    //! Destroy all the elements, keeping the index allocated
+    void clear()
+    {
+        for (Slot* slot = m_slots; slot != m_slots + m_capacity; ++slot) {
+            if (IsUsed(*slot)) DestroyNode(slot->node);
+        }
+        if (m_slots) memset(m_slots, 0, m_capacity * sizeof(Slot));
+        m_size = 0;
+        m_deleted = 0;
+    }
+
+    void reserve(size_type n)
+    {
+        if (NeedsGrow(n)) Rehash(n);
+    }
+
+private:
+    //! The index is rebuilt when more than 3/4 of the slots are used or deleted
+    bool NeedsGrow(std::size_t nUsed) const { return nUsed * 4 > m_capacity * 3; }
+
+    void DestroyNode(value_type* node)
+    {
+        node_traits::destroy(m_node_alloc, node);
+        node_traits::deallocate(m_node_alloc, node, 1);
+    }
+
+    Slot* Find(const key_type& key, std::size_t hash)
+    {
+        if (m_size == 0) return nullptr;
+        const std::size_t mask = m_capacity - 1;
+        for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = m_slots[i];
+            if (slot.node == nullptr) return nullptr;
+            if (slot.hash == hash && slot.node != Deleted() && m_equal(slot.node->first, key)) return &slot;
+        }
+    }
+
+    //! Add node (whose key is not in the map yet) to the index
+    Slot* Insert(value_type* node, std::size_t hash)
+    {
+        if (NeedsGrow(m_size + m_deleted + 1)) {
+            // Drop the deleted slots, doubling the capacity if they are not enough
+            Rehash(m_size + 1);
+        }
+        Slot* slot = Place(m_slots, m_capacity, hash);
+        if (slot->node == Deleted()) m_deleted--;
+        slot->node = node;
+        slot->hash = hash;
+        m_size++;
+        return slot;
+    }
+
+    //! First slot, from the position of hash, that is free or deleted
+    static Slot* Place(Slot* slots, std::size_t capacity, std::size_t hash)
+    {
+        const std::size_t mask = capacity - 1;
+        std::size_t i = hash & mask;
+        while (IsUsed(slots[i])) i = (i + 1) & mask;
+        return &slots[i];
+    }
+
+    /**
+     * Reallocate the index, at least half free with n elements. It is never
+     * shrunk (like the buckets of std::unordered_map): rebuilding it to drop
+     * the deleted slots leaves room for at least capacity/4 more insertions.
+     */
+    void Rehash(std::size_t n)
+    {
+        std::size_t capacity = m_capacity > MIN_SLOTS ? m_capacity : MIN_SLOTS;
+        while (n * 2 > capacity) capacity *= 2;
+        Slot* slots = slot_traits::allocate(m_slot_alloc, capacity);
+        memset(slots, 0, capacity * sizeof(Slot));
+        for (Slot* slot = m_slots; slot != m_slots + m_capacity; ++slot) {
+            if (IsUsed(*slot)) *Place(slots, capacity, slot->hash) = *slot;
+        }
+        if (m_slots) slot_traits::deallocate(m_slot_alloc, m_slots, m_capacity);
+        m_slots = slots;
+        m_capacity = capacity;
+        m_deleted = 0;
+    }
+};
+
+#endif // BITCOIN_NODEHASHMAP_H
@@ -90,6 +90,8 @@ public:
 
     // memory only
     mutable bool fChecked{false};
+    //! PoW, merkle root and block signature verified (see CheckBlockIntegrity)
+    mutable bool fCheckedIntegrity{false};
 
     CBlock()
     {
@@ -117,6 +119,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fCheckedIntegrity = false;
         vchBlockSig.clear();
     }
 
@@ -52,6 +52,10 @@ const char* FINALBUDGET = "fbs";
 const char* FINALBUDGETVOTE = "fbvote";
 const char* SYNCSTATUSCOUNT = "ssc";
 const char* GETMNLIST = "dseg";
+const char* SENDCMPCT = "sendcmpct";
+const char* CMPCTBLOCK = "cmpctblock";
+const char* GETBLOCKTXN = "getblocktxn";
+const char* BLOCKTXN = "blocktxn";
 }; // namespace NetMsgType
 
 static const char* ppszTypeName[] = {
@@ -71,7 +75,8 @@ static const char* ppszTypeName[] = {
     "mnq",
     NetMsgType::MNBROADCAST,
     NetMsgType::MNPING,
-    "dstx"  // deprecated
+    "dstx", // deprecated
+    NetMsgType::CMPCTBLOCK
 };
 
 /** All known message types. Keep this in the same order as the list of
@@ -118,7 +123,11 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::GETMNLIST,
     NetMsgType::BUDGETVOTESYNC,
     NetMsgType::GETSPORKS,
-    NetMsgType::SYNCSTATUSCOUNT
+    NetMsgType::SYNCSTATUSCOUNT,
+    NetMsgType::SENDCMPCT,
+    NetMsgType::CMPCTBLOCK,
+    NetMsgType::GETBLOCKTXN,
+    NetMsgType::BLOCKTXN
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes + ARRAYLEN(allNetMessageTypes));
 
@@ -216,7 +225,7 @@ bool CInv::IsKnownType() const
 }
 
 bool CInv::IsMasterNodeType() const{
-     return type > 2;
+     return type > 2 && type != MSG_CMPCT_BLOCK;
 }
 
 const char* CInv::GetCommand() const
@@ -238,3 +247,12 @@ const std::vector<std::string>& getAllNetMessageTypes()
 {
     return allNetMessageTypesVec;
 }
+
+bool IsTierTwoRelayMessageType(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::MNBROADCAST ||
+           strCommand == NetMsgType::MNPING ||
+           strCommand == NetMsgType::MNWINNER ||
+           strCommand == NetMsgType::BUDGETVOTE ||
+           strCommand == NetMsgType::FINALBUDGETVOTE;
+}
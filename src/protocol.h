@@ -279,11 +279,41 @@ extern const char* FINALBUDGETVOTE;
  * The syncstatuscount message is used to track the layer 2 syncing process
  */
 extern const char* SYNCSTATUSCOUNT;
+/**
+ * Contains a 1-byte bool and 8-byte LE version number.
+ * Indicates that a node is willing to provide blocks via "cmpctblock" messages.
+ * May indicate that a node prefers to receive new block announcements via a
+ * "cmpctblock" message rather than an "inv", depending on message contents.
+ * @see BIP152
+ */
+extern const char* SENDCMPCT;
+/**
+ * Contains a CBlockHeaderAndShortTxIDs object - providing a header, the block
+ * signature and a list of "short txids".
+ * @see BIP152
+ */
+extern const char* CMPCTBLOCK;
+/**
+ * Contains a BlockTransactionsRequest
+ * Peer should respond with "blocktxn" message.
+ * @see BIP152
+ */
+extern const char* GETBLOCKTXN;
+/**
+ * Contains a BlockTransactions.
+ * Sent in response to a "getblocktxn" message.
+ * @see BIP152
+ */
+extern const char* BLOCKTXN;
 }; // namespace NetMsgType
 
 /* Get a vector of all valid message types (see above) */
 const std::vector<std::string>& getAllNetMessageTypes();
 
+/* Whether the message is a tier two relay message (masternode broadcasts, pings and
+ * winners, budget votes), which can be processed concurrently with other peers' messages */
+bool IsTierTwoRelayMessageType(const std::string& strCommand);
+
 /** nServices flags */
 enum ServiceFlags : uint64_t {
     // Nothing
@@ -396,7 +426,10 @@ enum {
     MSG_MASTERNODE_QUORUM,
     MSG_MASTERNODE_ANNOUNCE,
     MSG_MASTERNODE_PING,
-    MSG_DSTX
+    MSG_DSTX,
+    // Nodes may only request a MSG_CMPCT_BLOCK in a getdata (BIP152),
+    // it should not appear in any invs.
+    MSG_CMPCT_BLOCK
 };
 
 #endif // BITCOIN_PROTOCOL_H
@@ -0,0 +1,271 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "reindex.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/consensus.h"
+#include "consensus/validation.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+#include <chrono>
+#include <functional>
+
+#include <boost/thread.hpp>
+
+CReindexPipeline::CReindexPipeline(int nThreads, size_t nMaxBufferBytesIn) :
+        nMaxBufferBytes(nMaxBufferBytesIn)
+{
+    threads.emplace_back(&TraceThread<std::function<void()> >, "reindexread", std::function<void()>(std::bind(&CReindexPipeline::ThreadRead, this)));
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back(&TraceThread<std::function<void()> >, "reindexparse", std::function<void()>(std::bind(&CReindexPipeline::ThreadParse, this)));
+    }
+}
+
+CReindexPipeline::~CReindexPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condRead.notify_all();
+    condParse.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void CReindexPipeline::ThreadRead()
+{
+    for (int nFile = 0;; nFile++) {
+        CDiskBlockPos pos(nFile, 0);
+        if (!fs::exists(GetBlockPosFilename(pos, "blk")))
+            break; // No block files left to reindex
+        FILE* file = OpenBlockFile(pos, true);
+        if (!file)
+            break; // This error is logged in OpenBlockFile
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+        if (!ReadFile(file, nFile))
+            break;
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fReadDone = true;
+    }
+    condParsed.notify_all();
+}
+
+bool CReindexPipeline::ReadFile(FILE* fileIn, int nFile)
+{
+    // Same scan as LoadExternalBlockFile, the blocks are deserialized by the workers
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        while (!blkdat.eof()) {
+            blkdat.SetPos(nRewind);
+            nRewind++;         // start one byte further next time, in case of failure
+            blkdat.SetLimit(); // remove former limit
+            unsigned int nSize = 0;
+            try {
+                // locate a header
+                unsigned char buf[MESSAGE_START_SIZE];
+                blkdat.FindByte(Params().MessageStart()[0]);
+                nRewind = blkdat.GetPos() + 1;
+                blkdat >> FLATDATA(buf);
+                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                    continue;
+                // read size
+                blkdat >> nSize;
+                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                    continue;
+            } catch (const std::exception&) {
+                // no valid block header found; don't complain
+                break;
+            }
+            try {
+                // read block
+                Item item;
+                item.pos = CDiskBlockPos(nFile, blkdat.GetPos());
+                item.nSize = nSize;
+                blkdat.SetLimit(item.pos.nPos + nSize);
+                item.vData.resize(nSize);
+                blkdat.read(item.vData.data(), nSize);
+                nRewind = blkdat.GetPos();
+                if (!PushItem(std::move(item)))
+                    return false;
+            } catch (const std::exception& e) {
+                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::lock_guard<std::mutex> lock(cs);
+        strReadError = e.what();
+        return false;
+    }
+    return true;
+}
+
+bool CReindexPipeline::PushItem(Item&& item)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        // Always let the next block to process in, the reader is never stuck behind Run
+        condRead.wait(lock, [this] { return fStop || nBytesAhead < REINDEX_READ_AHEAD_BYTES || nNextRead == nNextProcess; });
+        if (fStop) return false;
+        nBytesAhead += item.nSize;
+        mapItems.emplace(nNextRead, std::move(item));
+        queueParse.push_back(nNextRead);
+        nNextRead++;
+    }
+    condParse.notify_one();
+    return true;
+}
+
+void CReindexPipeline::ThreadParse()
+{
+    while (true) {
+        Item* pitem;
+        std::vector<char> vData;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            condParse.wait(lock, [this] { return fStop || !queueParse.empty(); });
+            if (fStop) return;
+            // The item stays in mapItems until Run takes it, after it is parsed
+            pitem = &mapItems.at(queueParse.front());
+            queueParse.pop_front();
+            vData.swap(pitem->vData);
+        }
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        uint256 hash;
+        try {
+            CDataStream ss(vData.data(), vData.data() + vData.size(), SER_DISK, CLIENT_VERSION);
+            ss >> *pblock;
+            hash = pblock->GetHash();
+            // A block failing it is rejected by CheckBlock, with the reason
+            CheckBlockIntegrity(*pblock);
+        } catch (const std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+            pblock.reset();
+        }
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            pitem->pblock = std::move(pblock);
+            pitem->hash = hash;
+            pitem->fParsed = true;
+        }
+        condParsed.notify_all();
+    }
+}
+
+bool CReindexPipeline::Run()
+{
+    int64_t nStart = GetTimeMillis();
+    bool fRet = true;
+    while (true) {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            auto it = mapItems.find(nNextProcess);
+            while (it == mapItems.end() || !it->second.fParsed) {
+                if (fReadDone && nNextProcess == nNextRead) break;
+                condParsed.wait_for(lock, std::chrono::milliseconds(100));
+                boost::this_thread::interruption_point();
+                it = mapItems.find(nNextProcess);
+            }
+            if (it == mapItems.end()) {
+                if (!strReadError.empty()) {
+                    AbortNode(std::string("System error: ") + strReadError);
+                    fRet = false;
+                }
+                break;
+            }
+            item = std::move(it->second);
+            mapItems.erase(it);
+            nNextProcess++;
+            nBytesAhead -= item.nSize;
+        }
+        condRead.notify_one();
+
+        if (!item.pblock) continue;
+        if (!ProcessBlock(item.hash, item.pblock, item.pos, item.nSize)) {
+            fRet = false;
+            break;
+        }
+    }
+    LogPrintf("Reindexed %i blocks in %dms, %i out of order (%i read again from disk)\n",
+              nLoaded, GetTimeMillis() - nStart, nOutOfOrder, nReread);
+    return fRet;
+}
+
+bool CReindexPipeline::ProcessBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock, const CDiskBlockPos& pos, size_t nSize)
+{
+    const uint256& hashGenesis = Params().GetConsensus().hashGenesisBlock;
+    bool fHaveParent;
+    const CBlockIndex* pindex = nullptr;
+    {
+        LOCK(cs_main);
+        fHaveParent = hash == hashGenesis || mapBlockIndex.count(pblock->hashPrevBlock);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi != mapBlockIndex.end()) pindex = mi->second;
+    }
+
+    // hold out of order blocks until their parent is processed
+    if (!fHaveParent) {
+        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                hash.GetHex(), pblock->hashPrevBlock.GetHex());
+        nOutOfOrder++;
+        if (nBufferBytes + nSize <= nMaxBufferBytes) {
+            nBufferBytes += nSize;
+            mapUnknownParent.emplace(pblock->hashPrevBlock, Orphan{pos, hash, pblock, nSize});
+        } else {
+            mapUnknownParent.emplace(pblock->hashPrevBlock, Orphan{pos, hash, nullptr, 0});
+        }
+        return true;
+    }
+
+    // process in case the block isn't known yet
+    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        CDiskBlockPos dbp = pos;
+        if (ProcessNewBlock(state, nullptr, pblock, &dbp))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != hashGenesis && pindex->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        auto range = mapUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            Orphan orphan = std::move(range.first->second);
+            nBufferBytes -= orphan.nSize;
+            range.first = mapUnknownParent.erase(range.first);
+            if (!orphan.pblock) {
+                std::shared_ptr<CBlock> pread = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pread, orphan.pos))
+                    continue;
+                nReread++;
+                orphan.pblock = pread;
+            }
+            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, orphan.hash.ToString(),
+                head.ToString());
+            CValidationState dummy;
+            if (ProcessNewBlock(dummy, nullptr, orphan.pblock, &orphan.pos)) {
+                nLoaded++;
+                queue.push_back(orphan.hash);
+            }
+        }
+    }
+    return true;
+}
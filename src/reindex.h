@@ -0,0 +1,112 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_REINDEX_H
+#define BITCOIN_REINDEX_H
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! -reindexthreads default: reindex the blk files sequentially (LoadExternalBlockFile)
+static const int DEFAULT_REINDEX_THREADS = 0;
+static const int MAX_REINDEX_THREADS = 16;
+//! -reindexbuffer default (MiB): out of order blocks held in memory until their parent is processed
+static const int64_t DEFAULT_REINDEX_BUFFER = 64;
+//! Serialized size of the blocks read ahead of the one being processed
+static const size_t REINDEX_READ_AHEAD_BYTES = 32 << 20;
+
+/**
+ * Reindex of the blk files in three stages:
+ * - a reader thread scans the files in order and extracts the serialized
+ *   blocks, up to REINDEX_READ_AHEAD_BYTES ahead of the processing;
+ * - worker threads deserialize them and run CheckBlockIntegrity (proof of
+ *   work, merkle root and block signature) in parallel;
+ * - the thread calling Run takes the blocks back in file order and passes
+ *   them to ProcessNewBlock, which connects them.
+ *
+ * A block whose parent is not known yet is held in memory until the parent
+ * is processed, up to -reindexbuffer. Past that bound only its position is
+ * kept, and it is read again from disk when its parent shows up (like
+ * LoadExternalBlockFile does for all of them).
+ */
+class CReindexPipeline
+{
+private:
+    //! A block read from a file
+    struct Item {
+        CDiskBlockPos pos;
+        size_t nSize{0};
+        //! Serialized block, until a worker deserializes it
+        std::vector<char> vData;
+        //! Null if the block could not be deserialized
+        std::shared_ptr<const CBlock> pblock;
+        uint256 hash;
+        bool fParsed{false};
+    };
+
+    //! A block waiting for its parent
+    struct Orphan {
+        CDiskBlockPos pos;
+        uint256 hash;
+        //! Null if only the position is kept
+        std::shared_ptr<const CBlock> pblock;
+        size_t nSize;
+    };
+
+    std::mutex cs;
+    //! Signals the reader that there is room to read ahead
+    std::condition_variable condRead;
+    //! Signals the workers that blocks are waiting to be deserialized
+    std::condition_variable condParse;
+    //! Signals Run that a block is deserialized, or that the reader is done
+    std::condition_variable condParsed;
+    //! Blocks read and not processed yet, by sequence number (file order)
+    std::map<uint64_t, Item> mapItems;
+    //! Sequence numbers of the blocks to deserialize
+    std::deque<uint64_t> queueParse;
+    uint64_t nNextRead{0};
+    uint64_t nNextProcess{0};
+    size_t nBytesAhead{0};
+    bool fReadDone{false};
+    bool fStop{false};
+    //! I/O error of the reader
+    std::string strReadError;
+    std::vector<std::thread> threads;
+
+    // Only used by the thread calling Run
+    std::multimap<uint256, Orphan> mapUnknownParent;
+    size_t nBufferBytes{0};
+    const size_t nMaxBufferBytes;
+    int nLoaded{0};
+    int nOutOfOrder{0};
+    int nReread{0};
+
+    void ThreadRead();
+    void ThreadParse();
+    //! Extract the blocks of a file, false if stopped or on I/O error
+    bool ReadFile(FILE* fileIn, int nFile);
+    //! Queue a block read, waiting while the reader is too far ahead
+    bool PushItem(Item&& item);
+    //! Process a block and its children held in mapUnknownParent, false on a fatal error
+    bool ProcessBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock, const CDiskBlockPos& pos, size_t nSize);
+
+public:
+    CReindexPipeline(int nThreads, size_t nMaxBufferBytesIn);
+    ~CReindexPipeline();
+
+    //! Process the blocks of all the blk files, false if stopped by an I/O or a validation system error
+    bool Run();
+};
+
+#endif // BITCOIN_REINDEX_H
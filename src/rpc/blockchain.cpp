@@ -7,9 +7,11 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "blockstatsindex.h"
 #include "budget/budgetmanager.h"
 #include "checkpoints.h"
 #include "clientversion.h"
+#include "coinstats.h"
 #include "core_io.h"
 #include "consensus/upgrades.h"
 #include "kernel.h"
@@ -17,8 +19,10 @@
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "rpc/server.h"
+#include "sapling/sapling_validation.h"
 #include "sync.h"
 #include "txdb.h"
+#include "undo.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
@@ -43,7 +47,7 @@ static std::mutex cs_blockchange;
 static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock;
 
-extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, const CTxUndo* txundo);
 
 UniValue syncwithvalidationinterfacequeue(const JSONRPCRequest& request)
 {
@@ -141,12 +145,16 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.pushKV("version", block.nVersion);
     result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
     result.pushKV("finalsaplingroot", block.hashFinalSaplingRoot.GetHex());
+    // The inputs of the transactions are detailed with the coins they spend, from the undo data
+    CBlockUndo blockundo;
+    const bool fHaveUndo = txDetails && (blockindex->nStatus & BLOCK_HAVE_UNDO) &&
+                           ReadBlockUndoFromDisk(blockundo, block, blockindex);
     UniValue txs(UniValue::VARR);
-    for (const auto& txIn : block.vtx) {
-        const CTransaction& tx = *txIn;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
         if (txDetails) {
             UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, UINT256_ZERO, objTx);
+            TxToJSON(tx, UINT256_ZERO, objTx, fHaveUndo && i > 0 ? &blockundo.vtxundo[i - 1] : nullptr);
             txs.push_back(objTx);
         } else
             txs.push_back(tx.GetHash().GetHex());
@@ -567,19 +575,20 @@ UniValue getblock(const JSONRPCRequest& request)
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-
     if (!fVerbose) {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        // The hex data is the serialized block on disk, no need to deserialize it
+        std::vector<unsigned char> vchBlock;
+        if (!ReadRawBlockFromDisk(vchBlock, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        return HexStr(vchBlock.begin(), vchBlock.end());
     }
 
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pblockindex))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
     return blockToJSON(block, pblockindex);
 }
 
@@ -641,153 +650,149 @@ UniValue getblockheader(const JSONRPCRequest& request)
     return blockheaderToJSON(pblockindex);
 }
 
+/** Block of the active chain at the height given in params[nParam], or the tip if it is missing */
+static const CBlockIndex* ParseHeightParam(const UniValue& params, size_t nParam)
+{
+    LOCK(cs_main);
+    if (params.size() <= nParam || params[nParam].isNull()) {
+        return chainActive.Tip();
+    }
+    const int nHeight = params[nParam].get_int();
+    if (nHeight < 0 || nHeight > chainActive.Height()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+    }
+    return chainActive[nHeight];
+}
+
+static CUTXOStats LookUpUTXOStats(const CBlockIndex* pindex)
+{
+    CUTXOStats stats;
+    if (!putxostats || !putxostats->LookUpStats(pindex, stats)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("No UTXO set statistics for block %d", pindex->nHeight));
+    }
+    return stats;
+}
+
 UniValue getsupplyinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 1)
+    if (request.fHelp || request.params.size() > 2)
         throw std::runtime_error(
-            "getsupplyinfo ( forceupdate )\n"
-            "\nIf forceupdate=false (default if no argument is given): return the last cached money supply"
-            "\n(sum of spendable transaction outputs) and the height of the chain when it was last updated"
-            "\n(it is updated periodically, whenever the chainstate is flushed)."
-            "\n"
-            "\nIf forceupdate=true: Flush the chainstate to disk and return the money supply updated to"
-            "\nthe current chain height.\n"
+            "getsupplyinfo ( forceupdate height )\n"
+            "\nReturn the money supply (sum of spendable transaction outputs and shield pool value)"
+            "\nafter the block at the given height, or at the chain tip."
+            "\nThe supply is updated with every block connected or disconnected."
+            "\nThe statistics are kept from the first start of a version maintaining them, or from"
+            "\nthe genesis block after a -reindex.\n"
 
             "\nArguments:\n"
-            "1. forceupdate       (boolean, optional, default=false) flush chainstate to disk and update cache\n"
+            "1. forceupdate       (boolean, optional) DEPRECATED and ignored: the supply no longer needs a chainstate\n"
+            "                     flush to be up to date. Will be removed in a future version, pass false\n"
+            "2. height            (numeric, optional, default=tip) the block height\n"
 
             "\nResult:\n"
             "{\n"
-            "  \"updateheight\" : n,       (numeric) The chain height when the transparent supply was updated\n"
+            "  \"updateheight\" : n,       (numeric) The chain height of the supply\n"
             "  \"transparentsupply\" : n   (numeric) The sum of all spendable transaction outputs at height updateheight\n"
-            "  \"shieldsupply\": n         (numeric) Chain tip shield pool value\n"
+            "  \"shieldsupply\": n         (numeric) Shield pool value at height updateheight\n"
             "  \"totalsupply\": n          (numeric) The sum of transparentsupply and shieldsupply\n"
             "}\n"
 
             "\nExamples:\n" +
-            HelpExampleCli("getsupplyinfo", "") + HelpExampleCli("getsupplyinfo", "true") +
+            HelpExampleCli("getsupplyinfo", "") + HelpExampleCli("getsupplyinfo", "false 1000") +
             HelpExampleRpc("getsupplyinfo", ""));
 
-    const bool fForceUpdate = request.params.size() > 0 ? request.params[0].get_bool() : false;
-
-    if (fForceUpdate) {
-        // Flush state to disk (which updates the cached supply)
-        FlushStateToDisk();
-    }
-
+    const CBlockIndex* pindex = ParseHeightParam(request.params, 1);
     UniValue ret(UniValue::VOBJ);
-    const CAmount tSupply = MoneySupply.Get();
-    ret.pushKV("updateheight", MoneySupply.GetCacheHeight());
-    ret.pushKV("transparentsupply", ValueFromAmount(tSupply));
-    Optional<CAmount> shieldedPoolValue = WITH_LOCK(cs_main, return (chainActive.Tip() ? chainActive.Tip()->nChainSaplingValue : nullopt); );
-    ret.pushKV("shieldsupply", ValuePoolDesc(shieldedPoolValue, nullopt)["chainValue"]);
-    const CAmount totalSupply = tSupply + (shieldedPoolValue ? *shieldedPoolValue : 0);
-    ret.pushKV("totalsupply", ValueFromAmount(totalSupply));
-
-    return ret;
-}
-
-struct CCoinsStats
-{
-    int nHeight{0};
-    uint256 hashBlock{UINT256_ZERO};
-    uint64_t nTransactions{0};
-    uint64_t nTransactionOutputs{0};
-    uint256 hashSerialized{UINT256_ZERO};
-    uint64_t nDiskSize{0};
-    CAmount nTotalAmount{0};
-};
-
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
-{
-    assert(!outputs.empty());
-    ss << hash;
-    const Coin& coin = outputs.begin()->second;
-    ss << VARINT(coin.nHeight * 4 + (coin.fCoinBase ? 2 : 0) + (coin.fCoinStake ? 1 : 0));
-    stats.nTransactions++;
-    for (const auto& output : outputs) {
-        ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT(output.second.out.nValue);
-        stats.nTransactionOutputs++;
-        stats.nTotalAmount += output.second.out.nValue;
+    if (!pindex) {
+        // no block connected yet
+        ret.pushKV("updateheight", -1);
+        ret.pushKV("transparentsupply", ValueFromAmount(0));
+        ret.pushKV("shieldsupply", ValueFromAmount(0));
+        ret.pushKV("totalsupply", ValueFromAmount(0));
+        return ret;
     }
-    ss << VARINT(0);
-}
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
-{
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    const CUTXOStats stats = LookUpUTXOStats(pindex);
+    ret.pushKV("updateheight", pindex->nHeight);
+    ret.pushKV("transparentsupply", ValueFromAmount(stats.nTotalAmount));
+    ret.pushKV("shieldsupply", ValueFromAmount(stats.nShieldAmount));
+    ret.pushKV("totalsupply", ValueFromAmount(stats.nTotalAmount + stats.nShieldAmount));
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
-    }
-    ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        COutPoint key;
-        Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-        } else {
-            return error("%s: unable to read value", __func__);
-        }
-        pcursor->Next();
-    }
-    if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
-    }
-    stats.hashSerialized = ss.GetHash();
-    stats.nDiskSize = view->EstimateSize();
-    return true;
+    return ret;
 }
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 2)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" height )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time with the default hash_type, it reads the whole set.\n"
+            "With \"muhash\", the statistics are maintained with the chain and returned immediately,\n"
+            "after the block at the given height or at the chain tip.\n"
+
+            "\nArguments:\n"
+            "1. \"hash_type\"   (string, optional, default=\"hash_serialized_2\") Which UTXO set hash to return: \"hash_serialized_2\" or \"muhash\"\n"
+            "2. height          (numeric, optional, default=tip) The block height (muhash only)\n"
 
             "\nResult:\n"
             "{\n"
-            "  \"height\":n,     (numeric) The current block height (index)\n"
-            "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"height\":n,     (numeric) The block height (index)\n"
+            "  \"bestblock\": \"hex\",   (string) the block hash hex\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (hash_serialized_2 only)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash\n"
-            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"muhash\": \"hash\",     (string) The MuHash of the set (muhash only, if it was computed for the block)\n"
+            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash (hash_serialized_2 only)\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk (at the chain tip only)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"shield_amount\": x.xxx         (numeric) The shield pool value (muhash only)\n"
             "}\n"
 
             "\nExamples:\n" +
-            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "\"muhash\" 1000") +
+            HelpExampleRpc("gettxoutsetinfo", ""));
+
+    const std::string strHashType = request.params.size() > 0 && !request.params[0].isNull() ? request.params[0].get_str() : "hash_serialized_2";
 
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsTip, stats)) {
-        ret.pushKV("height", (int64_t)stats.nHeight);
-        ret.pushKV("bestblock", stats.hashBlock.GetHex());
-        ret.pushKV("transactions", (int64_t)stats.nTransactions);
-        ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
-        ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
-        ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
-        ret.pushKV("disk_size", stats.nDiskSize);
+    if (strHashType == "hash_serialized_2") {
+        if (request.params.size() > 1 && !request.params[1].isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_serialized_2 is only available at the chain tip");
+        }
+        CCoinsStats stats;
+        FlushStateToDisk();
+        if (GetUTXOStats(pcoinsTip, stats)) {
+            ret.pushKV("height", (int64_t)stats.nHeight);
+            ret.pushKV("bestblock", stats.hashBlock.GetHex());
+            ret.pushKV("transactions", (int64_t)stats.nTransactions);
+            ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
+            ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+            ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+            ret.pushKV("disk_size", stats.nDiskSize);
+        }
+        return ret;
+    }
+    if (strHashType != "muhash") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", strHashType));
+    }
+
+    const CBlockIndex* pindex = ParseHeightParam(request.params, 1);
+    if (!pindex) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No block connected yet");
     }
+    const CUTXOStats stats = LookUpUTXOStats(pindex);
+    ret.pushKV("height", pindex->nHeight);
+    ret.pushKV("bestblock", stats.hashBlock.GetHex());
+    ret.pushKV("txouts", stats.nTransactionOutputs);
+    if (!stats.hashMuHash.IsNull()) {
+        ret.pushKV("muhash", stats.hashMuHash.GetHex());
+    }
+    if (pindex == WITH_LOCK(cs_main, return chainActive.Tip())) {
+        ret.pushKV("disk_size", pcoinsTip->EstimateSize());
+    }
+    ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+    ret.pushKV("shield_amount", ValueFromAmount(stats.nShieldAmount));
     return ret;
 }
 
@@ -1153,6 +1158,12 @@ UniValue mempoolInfoToJSON()
     size_t maxmempool = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     ret.pushKV("mempoolminfee", ValueFromAmount(std::max(mempool.GetMinFee(maxmempool), ::minRelayTxFee).GetFeePerK()));
     ret.pushKV("minrelaytxfee", ValueFromAmount(::minRelayTxFee.GetFeePerK()));
+    uint64_t nSaplingCacheHits, nSaplingCacheMisses;
+    SaplingValidation::GetProofCacheStats(nSaplingCacheHits, nSaplingCacheMisses);
+    UniValue saplingCache(UniValue::VOBJ);
+    saplingCache.pushKV("hits", nSaplingCacheHits);
+    saplingCache.pushKV("misses", nSaplingCacheMisses);
+    ret.pushKV("saplingproofcache", saplingCache);
 
     return ret;
 }
@@ -1173,6 +1184,10 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"maxmempool\": xxxxx,         (numeric) Maximum memory usage for the mempool\n"
             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in " + CURRENCY_UNIT + "/kB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee\n"
             "  \"minrelaytxfee\": xxxxx       (numeric) Current minimum relay fee for transactions\n"
+            "  \"saplingproofcache\": {       (json object) Lookups in the cache of verified Sapling proofs since startup\n"
+            "     \"hits\": xxxxx            (numeric) Shielded txs whose proofs were not verified again\n"
+            "     \"misses\": xxxxx          (numeric) Shielded txs whose proofs had to be verified\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -1181,6 +1196,126 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getvalidationqueueinfo\n"
+            "\nReturns the state of the queue of validation notifications (blocks connected and disconnected,\n"
+            "transactions added to and removed from the mempool) processed in the background by the wallet,\n"
+            "ZMQ and the other subscribers, and the time spent by each subscriber.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"pending\": n,              (numeric) Notifications waiting in the queue\n"
+            "  \"max_pending\": n,          (numeric) Highest number of notifications waiting since startup\n"
+            "  \"limit\": n,                (numeric) Pending notifications above which block connection waits (-maxvalidationqueue)\n"
+            "  \"limit_waits\": n,          (numeric) Times block connection waited for the queue to drain\n"
+            "  \"limit_wait_ms\": n,        (numeric) Total time of these waits, in milliseconds\n"
+            "  \"processed\": n,            (numeric) Notifications processed since startup\n"
+            "  \"avg_queue_delay_ms\": n,   (numeric) Average time a notification waited in the queue, in milliseconds\n"
+            "  \"subscribers\": [           (json array)\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",         (string) The subscriber\n"
+            "      \"calls\": n,            (numeric) Notifications processed by the subscriber\n"
+            "      \"total_ms\": n,         (numeric) Total processing time, in milliseconds\n"
+            "      \"avg_ms\": n,           (numeric) Average processing time, in milliseconds\n"
+            "      \"max_ms\": n            (numeric) Longest processing time, in milliseconds\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getvalidationqueueinfo", "") + HelpExampleRpc("getvalidationqueueinfo", ""));
+
+    const ValidationQueueInfo info = GetMainSignals().GetQueueInfo();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("pending", (uint64_t)info.nPending);
+    ret.pushKV("max_pending", (uint64_t)info.nMaxPending);
+    ret.pushKV("limit", (uint64_t)info.nLimit);
+    ret.pushKV("limit_waits", info.nLimitWaits);
+    ret.pushKV("limit_wait_ms", info.nLimitWaitMicros / 1000.0);
+    ret.pushKV("processed", info.nCallbacks);
+    ret.pushKV("avg_queue_delay_ms", info.nCallbacks ? info.nQueueDelayMicros / 1000.0 / info.nCallbacks : 0.0);
+    UniValue subscribers(UniValue::VARR);
+    for (const ValidationSubscriberInfo& sub : info.vSubscribers) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", sub.name);
+        obj.pushKV("calls", sub.nCalls);
+        obj.pushKV("total_ms", sub.nTimeMicros / 1000.0);
+        obj.pushKV("avg_ms", sub.nCalls ? sub.nTimeMicros / 1000.0 / sub.nCalls : 0.0);
+        obj.pushKV("max_ms", sub.nMaxTimeMicros / 1000.0);
+        subscribers.push_back(obj);
+    }
+    ret.pushKV("subscribers", subscribers);
+    return ret;
+}
+
+UniValue getdbinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getdbinfo\n"
+            "\nReturns the LevelDB settings (-dbprofile) and statistics of the open databases, and the usage\n"
+            "of the block cache shared by them (-dbsharedcache).\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"shared_cache\": {            (json object)\n"
+            "    \"capacity\": n,             (numeric) Size of the shared block cache in bytes, 0 if not used\n"
+            "    \"usage\": n                 (numeric) Bytes used in the shared block cache\n"
+            "  },\n"
+            "  \"databases\": [              (json array)\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",          (string) The database (chainstate, index, ...)\n"
+            "      \"path\": \"xxxx\",          (string) Its directory\n"
+            "      \"memory\": true|false,    (boolean) Whether it is kept in memory only\n"
+            "      \"compression\": true|false, (boolean) Whether the tables are compressed\n"
+            "      \"max_open_files\": n,     (numeric) Table files kept open\n"
+            "      \"block_size\": n,         (numeric) Size of the table blocks in bytes\n"
+            "      \"bloom_bits\": n,         (numeric) Bits per key of the bloom filters\n"
+            "      \"shared_cache\": true|false, (boolean) Whether it uses the shared block cache\n"
+            "      \"block_cache_usage\": n,  (numeric) Bytes used in its own block cache\n"
+            "      \"write_buffer_size\": n,  (numeric) Size of its write buffer in bytes\n"
+            "      \"approximate_size\": n,   (numeric) Approximate size on disk in bytes\n"
+            "      \"memory_usage\": n,       (numeric) Approximate memory used by LevelDB in bytes\n"
+            "      \"stats\": \"xxxx\"          (string) LevelDB statistics of the compactions by level (leveldb.stats)\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getdbinfo", "") + HelpExampleRpc("getdbinfo", ""));
+
+    UniValue ret(UniValue::VOBJ);
+    size_t nCapacity, nUsage;
+    GetSharedDBCacheInfo(nCapacity, nUsage);
+    UniValue shared(UniValue::VOBJ);
+    shared.pushKV("capacity", (uint64_t)nCapacity);
+    shared.pushKV("usage", (uint64_t)nUsage);
+    ret.pushKV("shared_cache", shared);
+    UniValue databases(UniValue::VARR);
+    for (const CDBInfo& info : GetAllDBInfo()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", info.strName);
+        obj.pushKV("path", info.strPath);
+        obj.pushKV("memory", info.fMemory);
+        obj.pushKV("compression", info.profile.fCompression);
+        obj.pushKV("max_open_files", info.profile.nMaxOpenFiles);
+        obj.pushKV("block_size", (uint64_t)info.profile.nBlockSize);
+        obj.pushKV("bloom_bits", info.profile.nBloomBits);
+        obj.pushKV("shared_cache", info.profile.fSharedCache && nCapacity > 0);
+        obj.pushKV("block_cache_usage", (uint64_t)info.nBlockCacheSize);
+        obj.pushKV("write_buffer_size", (uint64_t)info.nWriteBufferSize);
+        obj.pushKV("approximate_size", info.nApproximateSize);
+        obj.pushKV("memory_usage", info.nMemoryUsage);
+        obj.pushKV("stats", info.strStats);
+        databases.push_back(obj);
+    }
+    ret.pushKV("databases", databases);
+    return ret;
+}
+
 UniValue invalidateblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1295,12 +1430,26 @@ void validaterange(const UniValue& params, int& heightStart, int& heightEnd, int
     }
 }
 
+// Stats of a block read from disk, when the block stats index is disabled or not synced yet
+static void ReadBlockStats(const CBlockIndex* pindex, CBlockStats& stats)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    if (!ReadBlockWithUndoFromDisk(block, blockundo, pindex)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read block from disk");
+    }
+    if (!ComputeBlockStats(block, blockundo, stats)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "failed to compute block stats");
+    }
+}
+
 UniValue getblockindexstats(const JSONRPCRequest& request) {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
         throw std::runtime_error(
                 "getblockindexstats height range\n"
                 "\nReturns aggregated BlockIndex data for blocks "
                 "\n[height, height+1, height+2, ..., height+range-1]\n"
+                "Served from the block stats index when -blockstatsindex is enabled.\n"
 
                 "\nArguments:\n"
                 "1. height             (numeric, required) block height where the search starts.\n"
@@ -1315,6 +1464,10 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
                 "  \"txbytes\": xxxxx                (numeric) Sum of the size of all txes over block range\n"
                 "  \"ttlfee\": xxxxx                 (numeric) Sum of the fee amount of all txes over block range\n"
                 "  \"feeperkb\": xxxxx               (numeric) Average fee per kb (excluding zc txes)\n"
+                "  \"feerate_percentiles\": [       (array of numeric) Fee per kb at the 10th, 25th, 50th, 75th and 90th percentiles\n"
+                "      xxxxx,                      of the tx bytes of each block, averaged over the range (weighted by txbytes)\n"
+                "      ...\n"
+                "  ]\n"
                 "}\n"
 
                 "\nExamples:\n" +
@@ -1332,48 +1485,25 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
     int64_t nBytes = 0;
     int64_t nTxCount = 0;
     int64_t nTxCount_all = 0;
+    // feerates at each percentile, multiplied by the block tx bytes
+    double nWeightedPercentiles[NUM_FEERATE_PERCENTILES] = {};
 
     const CBlockIndex* pindex = WITH_LOCK(cs_main, return chainActive[heightEnd]);
     if (!pindex)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid block height");
 
     while (pindex && pindex->nHeight >= heightStart) {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex)) {
-            throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read block from disk");
+        CBlockStats stats;
+        if (!g_blockstatsindex || !g_blockstatsindex->LookUpStats(pindex, stats)) {
+            ReadBlockStats(pindex, stats);
         }
 
-        CAmount nValueIn = 0;
-        CAmount nValueOut = 0;
-        const int ntx = block.vtx.size();
-        const int firstTxIndex = block.IsProofOfStake() ? 2 : 1;
-        nTxCount_all += ntx;
-        nTxCount = nTxCount + ntx - firstTxIndex;
-
-        // loop through each tx in block and save size and fee (except for coinbase/coinstake)
-        for (int idx = firstTxIndex; idx < ntx; idx++) {
-            const CTransaction& tx = *(block.vtx[idx]);
-
-            // Transaction size
-            nBytes += GetSerializeSize(tx, SER_NETWORK, CLIENT_VERSION);
-
-            // Transparent inputs
-            for (unsigned int j = 0; j < tx.vin.size(); j++) {
-                COutPoint prevout = tx.vin[j].prevout;
-                CTransactionRef txPrev;
-                uint256 hashBlock;
-                if(!GetTransaction(prevout.hash, txPrev, hashBlock, true))
-                    throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read tx from disk");
-                nValueIn += txPrev->vout[prevout.n].nValue;
-            }
-            // Shield inputs
-            nValueIn += tx.GetShieldedValueIn();
-
-            // Tranparent/Shield outputs
-            nValueOut += tx.GetValueOut();
-
-            // update fee
-            nFees += nValueIn - nValueOut;
+        nTxCount_all += stats.nTxCountAll;
+        nTxCount += stats.nTxCount;
+        nBytes += stats.nTxBytes;
+        nFees += stats.nFees;
+        for (int i = 0; i < NUM_FEERATE_PERCENTILES; i++) {
+            nWeightedPercentiles[i] += (double)stats.nFeeRatePercentiles[i] * stats.nTxBytes;
         }
         pindex = pindex->pprev;
     }
@@ -1381,12 +1511,19 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
     // get fee rate
     CFeeRate nFeeRate = CFeeRate(nFees, nBytes);
 
+    UniValue percentiles(UniValue::VARR);
+    for (int i = 0; i < NUM_FEERATE_PERCENTILES; i++) {
+        const CAmount nPercentile = nBytes > 0 ? (CAmount)(nWeightedPercentiles[i] / nBytes) : 0;
+        percentiles.push_back(FormatMoney(nPercentile));
+    }
+
     // return UniValue object
     ret.pushKV("txcount", (int64_t)nTxCount);
     ret.pushKV("txcount_all", (int64_t)nTxCount_all);
     ret.pushKV("txbytes", (int64_t)nBytes);
     ret.pushKV("ttlfee", FormatMoney(nFees));
     ret.pushKV("feeperkb", FormatMoney(nFeeRate.GetFeePerK()));
+    ret.pushKV("feerate_percentiles", percentiles);
 
     return ret;
 }
@@ -1444,6 +1581,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         false },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
+    { "blockchain",         "getdbinfo",              &getdbinfo,              true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getfeeinfo",             &getfeeinfo,             true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
@@ -1451,6 +1589,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getvalidationqueueinfo", &getvalidationqueueinfo, true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     /* Not shown in help */
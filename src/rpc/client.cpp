@@ -150,6 +150,8 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getblockindexstats", 1 },
     { "getfeeinfo", 0 },
     { "getsupplyinfo", 0 },
+    { "getsupplyinfo", 1 },
+    { "gettxoutsetinfo", 1 },
 };
 
 class CRPCConvertTable
@@ -68,9 +68,7 @@ UniValue getinfo(const JSONRPCRequest& request)
             "  \"difficulty\": xxxxxx,         (numeric) the current difficulty\n"
             "  \"testnet\": true|false,        (boolean) if the server is using testnet or not\n"
             "  \"moneysupply\": n              (numeric) The sum of transparentsupply and shieldedsupply\n"
-            "  \"transparentsupply\" : n       (numeric) The sum of the value of all unspent outputs when the chainstate was\n"
-            "                                            last flushed to disk (use getsupplyinfo to know the update-height, or\n"
-            "                                            to trigger the money supply update/recalculation)"
+            "  \"transparentsupply\" : n       (numeric) The sum of the value of all unspent outputs at the chain tip\n"
             "  \"shieldsupply\": n             (numeric) Chain tip shield pool value\n"
             "  \"keypoololdest\": xxxxxx,      (numeric) the timestamp (seconds since GMT epoch) of the oldest pre-generated key in the key pool\n"
             "  \"keypoolsize\": xxxx,          (numeric) how many new keys are pre-generated\n"
@@ -129,7 +127,7 @@ UniValue getinfo(const JSONRPCRequest& request)
     obj.pushKV("difficulty", (double)GetDifficulty());
     obj.pushKV("testnet", Params().IsTestnet());
 
-    // Add (cached) money supply via getsupplyinfo RPC
+    // Add money supply via getsupplyinfo RPC
     UniValue supply_info = getsupplyinfo(JSONRPCRequest());
     obj.pushKV("moneysupply", supply_info["totalsupply"]);
     obj.pushKV("transparentsupply", supply_info["transparentsupply"]);
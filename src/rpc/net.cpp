@@ -339,6 +339,54 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getmessagestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getmessagestats\n"
+            "\nReturns the processing latency of the received P2P messages, per command.\n"
+            "Only the commands of the messages processed since the node started are listed.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"workers\": n,              (numeric) Number of threads processing tier two relay messages next to the message handler\n"
+            "  \"commands\": {\n"
+            "    \"command\": {             (string) The message command (\"*other*\" for unknown commands)\n"
+            "      \"count\": n,            (numeric) Number of processed messages\n"
+            "      \"queue_avg_us\": n,     (numeric) Average time from the receipt of the message to the start of its processing, in microseconds\n"
+            "      \"queue_max_us\": n,     (numeric) Maximum queue time, in microseconds\n"
+            "      \"process_avg_us\": n,   (numeric) Average processing time, in microseconds\n"
+            "      \"process_max_us\": n    (numeric) Maximum processing time, in microseconds\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getmessagestats", "") + HelpExampleRpc("getmessagestats", ""));
+
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue commands(UniValue::VOBJ);
+    for (const auto& it : g_connman->GetMessageLatencyStats()) {
+        const CMessageLatencyStats& stats = it.second;
+        if (stats.nCount == 0)
+            continue;
+        UniValue cmd(UniValue::VOBJ);
+        cmd.pushKV("count", stats.nCount);
+        cmd.pushKV("queue_avg_us", stats.nQueueTimeTotal / (int64_t)stats.nCount);
+        cmd.pushKV("queue_max_us", stats.nQueueTimeMax);
+        cmd.pushKV("process_avg_us", stats.nProcessTimeTotal / (int64_t)stats.nCount);
+        cmd.pushKV("process_max_us", stats.nProcessTimeMax);
+        commands.pushKV(it.first, cmd);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("workers", g_connman->GetMessageHandlerThreads());
+    obj.pushKV("commands", commands);
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -561,6 +609,7 @@ static const CRPCCommand commands[] =
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
     { "network",            "getconnectioncount",     &getconnectioncount,     true  },
     { "network",            "getnettotals",           &getnettotals,           true  },
+    { "network",            "getmessagestats",        &getmessagestats,        true  },
     { "network",            "getpeerinfo",            &getpeerinfo,            true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
@@ -11,11 +11,94 @@
 #include "consensus/validation.h" // for CValidationState
 #include "util.h" // for error()
 #include "consensus/upgrades.h" // for CurrentEpochBranchId()
+#include "cuckoocache.h"
+#include "random.h"
+#include "script/sigcache.h" // for SignatureCacheHasher
 
 #include <librustzcash.h>
 
+#include <atomic>
+
+#include <boost/thread/shared_mutex.hpp>
+
+namespace {
+/**
+ * Valid Sapling proofs cache, to avoid verifying the zk-proofs and signatures
+ * of a shielded transaction twice (once when accepted into memory pool, and
+ * again when accepted into the block chain)
+ */
+class CSaplingProofCache
+{
+private:
+    //! Entries are SHA256(nonce || txid || sapling signature hash):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_saplingcache;
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+
+public:
+    CSaplingProofCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& txid, const uint256& sighash)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(txid.begin(), 32).Write(sighash.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry, const bool erase)
+    {
+        bool fHit;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_saplingcache);
+            fHit = setValid.contains(entry, erase);
+        }
+        (fHit ? nHits : nMisses)++;
+        return fHit;
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_saplingcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+
+    void GetStats(uint64_t& nHitsRet, uint64_t& nMissesRet) const
+    {
+        nHitsRet = nHits;
+        nMissesRet = nMisses;
+    }
+};
+
+static CSaplingProofCache saplingProofCache;
+}
+
 namespace SaplingValidation {
 
+// To be called once in AppInitMain/BasicTestingSetup to initialize the saplingProofCache.
+void InitProofCache()
+{
+    // nMaxCacheSize is unsigned. If -maxsaplingcachesize is set to zero,
+    // setup_bytes creates the minimum possible cache (2 elements).
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsaplingcachesize", DEFAULT_MAX_SAPLING_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = saplingProofCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for Sapling proofs cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+void GetProofCacheStats(uint64_t& nHits, uint64_t& nMisses)
+{
+    saplingProofCache.GetStats(nHits, nMisses);
+}
+
 // Verifies that Shielded txs are properly formed and performs content-independent checks
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, CAmount& nValueOut, bool fIsSaplingActive)
 {
@@ -104,6 +187,88 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
     return true;
 }
 
+/**
+ * Verify the spend/output zk-proofs and the spendAuth/binding signatures of a shielded tx.
+ * This is the expensive part of the Sapling validation: block validation runs it through
+ * CSaplingCheck on the script verification threads, see ConnectBlock.
+ * Successful verifications are remembered if cacheStore is set, otherwise a cache hit
+ * consumes the entry (the tx is being connected, it won't be verified again).
+ */
+bool CheckProofsAndSignatures(const CTransaction& tx, CValidationState& state, int dosLevelPotentiallyRelaxing, bool cacheStore)
+{
+    assert(tx.IsShieldedTx());
+    uint256 dataToBeSigned;
+    // Empty output script.
+    CScript scriptCode;
+    try {
+        dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
+    } catch (const std::logic_error& ex) {
+        // A logic error should never occur because we pass NOT_AN_INPUT and
+        // SIGHASH_ALL to SignatureHash().
+        return state.DoS(100, error("%s: error computing signature hash", __func__ ),
+                         REJECT_INVALID, "error-computing-signature-hash");
+    }
+
+    uint256 entry;
+    saplingProofCache.ComputeEntry(entry, tx.GetHash(), dataToBeSigned);
+    if (saplingProofCache.Get(entry, !cacheStore))
+        return true;
+
+    // Sapling verification process
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription &spend : tx.sapData->vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+                ctx,
+                spend.cv.begin(),
+                spend.anchor.begin(),
+                spend.nullifier.begin(),
+                spend.rk.begin(),
+                spend.zkproof.begin(),
+                spend.spendAuthSig.begin(),
+                dataToBeSigned.begin())) {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(
+                    dosLevelPotentiallyRelaxing,
+                    error("%s: Sapling spend description invalid", __func__ ),
+                    REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+        }
+    }
+
+    for (const OutputDescription &output : tx.sapData->vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+                ctx,
+                output.cv.begin(),
+                output.cmu.begin(),
+                output.ephemeralKey.begin(),
+                output.zkproof.begin())) {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            // This should be a non-contextual check, but we check it here
+            // as we need to pass over the outputs anyway in order to then
+            // call librustzcash_sapling_final_check().
+            return state.DoS(100, error("%s: Sapling output description invalid", __func__ ),
+                             REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+            ctx,
+            tx.sapData->valueBalance,
+            tx.sapData->bindingSig.begin(),
+            dataToBeSigned.begin())) {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(
+                dosLevelPotentiallyRelaxing,
+                error("%s: Sapling binding signature invalid", __func__ ),
+                REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    if (cacheStore)
+        saplingProofCache.Set(entry);
+    return true;
+}
+
 /**
 * Check a transaction contextually against a set of consensus rules valid at a given block height.
 *
@@ -115,6 +280,8 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
 *    nHeight can become valid at a later height), we make the bans conditional on not
 *    being in Initial Block Download mode.
 * 4. The isInitBlockDownload argument is a function parameter to assist with testing.
+* 5. ContextualCheckBlock passes fCheckProofs=false: block proofs and signatures are
+*    verified later, in parallel, by ConnectBlock.
 *
 */
 bool ContextualCheckTransaction(
@@ -123,7 +290,8 @@ bool ContextualCheckTransaction(
         const CChainParams& chainparams,
         const int nHeight,
         const bool isMined,
-        bool isInitBlockDownload)
+        bool isInitBlockDownload,
+        bool fCheckProofs)
 {
     const int DOS_LEVEL_BLOCK = 100;
     // DoS level set to 10 to be more forgiving.
@@ -160,69 +328,9 @@ bool ContextualCheckTransaction(
                     REJECT_INVALID, "bad-cs-has-shielded-data");
     }
 
-    if (hasShieldedData) {
-        uint256 dataToBeSigned;
-        // Empty output script.
-        CScript scriptCode;
-        try {
-            dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
-        } catch (const std::logic_error& ex) {
-            // A logic error should never occur because we pass NOT_AN_INPUT and
-            // SIGHASH_ALL to SignatureHash().
-            return state.DoS(100, error("%s: error computing signature hash", __func__ ),
-                             REJECT_INVALID, "error-computing-signature-hash");
-        }
-
-        // Sapling verification process
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.sapData->vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                    ctx,
-                    spend.cv.begin(),
-                    spend.anchor.begin(),
-                    spend.nullifier.begin(),
-                    spend.rk.begin(),
-                    spend.zkproof.begin(),
-                    spend.spendAuthSig.begin(),
-                    dataToBeSigned.begin())) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(
-                        dosLevelPotentiallyRelaxing,
-                        error("%s: Sapling spend description invalid", __func__ ),
-                        REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.sapData->vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                    ctx,
-                    output.cv.begin(),
-                    output.cmu.begin(),
-                    output.ephemeralKey.begin(),
-                    output.zkproof.begin())) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                // This should be a non-contextual check, but we check it here
-                // as we need to pass over the outputs anyway in order to then
-                // call librustzcash_sapling_final_check().
-                return state.DoS(100, error("%s: Sapling output description invalid", __func__ ),
-                                 REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
-
-        if (!librustzcash_sapling_final_check(
-                ctx,
-                tx.sapData->valueBalance,
-                tx.sapData->bindingSig.begin(),
-                dataToBeSigned.begin())) {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(
-                    dosLevelPotentiallyRelaxing,
-                    error("%s: Sapling binding signature invalid", __func__ ),
-                    REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
-        }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
+    if (hasShieldedData && fCheckProofs) {
+        // Only mempool verifications are cached: mined txs are not verified again
+        return CheckProofsAndSignatures(tx, state, dosLevelPotentiallyRelaxing, !isMined);
     }
     return true;
 }
@@ -12,8 +12,16 @@
 class CTransaction;
 class CValidationState;
 
+// Limit the Sapling proofs cache to 4MB (over 100000 verified transactions)
+static const unsigned int DEFAULT_MAX_SAPLING_CACHE_SIZE = 4;
+
 namespace SaplingValidation {
 
+/** Initialize the cache of valid Sapling proofs (shared by mempool and block validation) */
+void InitProofCache();
+/** Number of lookups in the Sapling proofs cache that hit/missed since startup */
+void GetProofCacheStats(uint64_t& nHits, uint64_t& nMisses);
+
 /** Context-independent validity checks */
 // Note: for v3+, if the tx has no shielded data, this method returns true.
 // Note2: This function only performs shielded data related checks, it does NOT checks regular inputs and outputs.
@@ -22,9 +30,13 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
 
 /** Check a transaction contextually against a set of consensus rules */
 // Note: if v5 upgrade wasn't enforced, this method returns true without performing any check.
+// Note2: with fCheckProofs=false the zk-proofs and signatures are not verified (see CheckProofsAndSignatures).
 bool ContextualCheckTransaction(const CTransaction &tx, CValidationState &state,
                                 const CChainParams &chainparams, int nHeight, bool isMined,
-                                bool sInitBlockDownload);
+                                bool sInitBlockDownload, bool fCheckProofs = true);
+
+/** Verify the zk-proofs, the spendAuth signatures and the binding signature of a shielded tx */
+bool CheckProofsAndSignatures(const CTransaction& tx, CValidationState& state, int dosLevelPotentiallyRelaxing, bool cacheStore);
 
 }; // End SaplingValidation namespace
 
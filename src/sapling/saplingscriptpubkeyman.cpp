@@ -328,7 +328,15 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingScriptPubKe
         return {};
     }
 
-    LOCK(wallet->cs_KeyStore);
+    // The trial decryptions are done without cs_KeyStore, on a copy of the viewing keys
+    std::vector<libzcash::SaplingIncomingViewingKey> vIvks;
+    {
+        LOCK(wallet->cs_KeyStore);
+        vIvks.reserve(wallet->mapSaplingFullViewingKeys.size());
+        for (const auto& it : wallet->mapSaplingFullViewingKeys) {
+            vIvks.push_back(it.first);
+        }
+    }
     const uint256& hash = tx.GetHash();
 
     mapSaplingNoteData_t noteData;
@@ -337,8 +345,7 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingScriptPubKe
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
     for (uint32_t i = 0; i < tx.sapData->vShieldedOutput.size(); ++i) {
         const OutputDescription output = tx.sapData->vShieldedOutput[i];
-        for (auto it = wallet->mapSaplingFullViewingKeys.begin(); it != wallet->mapSaplingFullViewingKeys.end(); ++it) {
-            libzcash::SaplingIncomingViewingKey ivk = it->first;
+        for (const libzcash::SaplingIncomingViewingKey& ivk : vIvks) {
             auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
             if (!result) {
                 continue;
@@ -346,7 +353,7 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingScriptPubKe
 
             // Check if we already have it.
             Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.get().d);
-            if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
+            if (address && WITH_LOCK(wallet->cs_KeyStore, return wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0)) {
                 viewingKeysToAdd[address.get()] = ivk;
             }
             // We don't cache the nullifier here as computing it requires knowledge of the note position
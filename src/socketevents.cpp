@@ -0,0 +1,164 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "netbase.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <algorithm>
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode)
+{
+    if (str == "select") {
+        mode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef USE_EPOLL
+    if (str == "epoll") {
+        mode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string SocketEventsModeToString(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT:
+        return "select";
+    case SOCKETEVENTS_EPOLL:
+        return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string strModes = "select";
+#ifdef USE_EPOLL
+    strModes += ", epoll";
+#endif
+    return strModes;
+}
+
+CSocketEvents::CSocketEvents(SocketEventsMode modeIn) : mode(SOCKETEVENTS_SELECT)
+{
+    ResetSelectSets();
+#ifdef USE_EPOLL
+    if (modeIn == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("%s: epoll_create1 failed (%s), falling back to select()\n", __func__, NetworkErrorString(WSAGetLastError()));
+        } else {
+            mode = SOCKETEVENTS_EPOLL;
+        }
+    }
+#endif
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+    }
+#endif
+}
+
+bool CSocketEvents::IsUsableSocket(SOCKET hSocket) const
+{
+    return mode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+bool CSocketEvents::Add(SOCKET hSocket, bool fEdgeTriggered)
+{
+#ifdef USE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        if (fEdgeTriggered) {
+            ev.events |= EPOLLOUT | EPOLLET;
+        }
+        ev.data.fd = hSocket;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &ev) == -1) {
+            LogPrintf("%s: epoll_ctl failed: %s\n", __func__, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+void CSocketEvents::Want(SOCKET hSocket, bool fRecv, bool fSend)
+{
+    if (mode != SOCKETEVENTS_SELECT) {
+        return;
+    }
+    FD_SET(hSocket, &fdsetError);
+    if (fRecv) FD_SET(hSocket, &fdsetRecv);
+    if (fSend) FD_SET(hSocket, &fdsetSend);
+    hSocketMax = std::max(hSocketMax, hSocket);
+    vSelectSockets.push_back(hSocket);
+}
+
+void CSocketEvents::ResetSelectSets()
+{
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    hSocketMax = 0;
+    vSelectSockets.clear();
+}
+
+bool CSocketEvents::Wait(int64_t nTimeoutMs, std::vector<Event>& vEvents)
+{
+    vEvents.clear();
+#ifdef USE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        epoll_event events[256];
+        int nEvents = epoll_wait(epollfd, events, ARRAYLEN(events), nTimeoutMs);
+        if (nEvents == -1) {
+            return WSAGetLastError() == WSAEINTR;
+        }
+        vEvents.reserve(nEvents);
+        for (int i = 0; i < nEvents; i++) {
+            const uint32_t e = events[i].events;
+            vEvents.push_back({(SOCKET)events[i].data.fd,
+                               (e & (EPOLLIN | EPOLLRDHUP)) != 0,
+                               (e & EPOLLOUT) != 0,
+                               (e & (EPOLLERR | EPOLLHUP)) != 0});
+        }
+        return true;
+    }
+#endif
+
+    if (vSelectSockets.empty()) {
+        // Nothing to wait for: some select() implementations (Windows) fail on empty sets
+        MilliSleep(nTimeoutMs);
+        return true;
+    }
+    struct timeval timeout = MillisToTimeval(nTimeoutMs);
+    int nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR) {
+        ResetSelectSets();
+        return false;
+    }
+    if (nSelect > 0) {
+        for (SOCKET hSocket : vSelectSockets) {
+            Event ev{hSocket, FD_ISSET(hSocket, &fdsetRecv) != 0, FD_ISSET(hSocket, &fdsetSend) != 0, FD_ISSET(hSocket, &fdsetError) != 0};
+            if (ev.fRecv || ev.fSend || ev.fError) {
+                vEvents.push_back(ev);
+            }
+        }
+    }
+    ResetSelectSets();
+    return true;
+}
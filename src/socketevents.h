@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include "compat.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/select.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WIN32)
+#define USE_EPOLL
+#endif
+
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+
+/** Default for -socketevents */
+#ifdef USE_EPOLL
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode);
+std::string SocketEventsModeToString(SocketEventsMode mode);
+/** Comma separated list of the modes supported by this build, for the help message */
+std::string GetSupportedSocketEventsModes();
+
+/**
+ * Readiness notifications for the sockets served by the network thread.
+ *
+ * The select() backend has no memory: the sockets of interest, and whether
+ * to wait for them to be readable or writable, are passed again with
+ * Want() before each Wait().
+ * The epoll backend registers each socket once, with Add(). Edge-triggered
+ * sockets are reported when they become readable or writable: the caller
+ * keeps that state until a recv()/send() would block. Level-triggered ones
+ * (listening sockets) are reported as long as they are readable.
+ * A socket is removed from the epoll set when it is closed.
+ */
+class CSocketEvents
+{
+public:
+    struct Event {
+        SOCKET socket;
+        bool fRecv;
+        bool fSend;
+        bool fError;
+    };
+
+    /** Falls back to select() if the requested backend is not available. */
+    explicit CSocketEvents(SocketEventsMode modeIn);
+    ~CSocketEvents();
+
+    CSocketEvents(const CSocketEvents&) = delete;
+    CSocketEvents& operator=(const CSocketEvents&) = delete;
+
+    SocketEventsMode GetMode() const { return mode; }
+    /** Whether Want() must be called for each socket of interest before each Wait() */
+    bool IsPolled() const { return mode == SOCKETEVENTS_SELECT; }
+    /** Whether a socket can be used with this backend (below FD_SETSIZE for select) */
+    bool IsUsableSocket(SOCKET hSocket) const;
+
+    /** Register a socket (epoll only, no-op with select). */
+    bool Add(SOCKET hSocket, bool fEdgeTriggered);
+    /** Wait for the socket on the next Wait() (select only, no-op with epoll). */
+    void Want(SOCKET hSocket, bool fRecv, bool fSend);
+    /** Wait up to nTimeoutMs for ready sockets. Returns false on error. */
+    bool Wait(int64_t nTimeoutMs, std::vector<Event>& vEvents);
+
+private:
+    SocketEventsMode mode;
+#ifdef USE_EPOLL
+    int epollfd{-1};
+#endif
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    SOCKET hSocketMax{0};
+    std::vector<SOCKET> vSelectSockets;
+
+    void ResetSelectSets();
+};
+
+#endif // BITCOIN_SOCKETEVENTS_H
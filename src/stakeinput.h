@@ -45,6 +45,8 @@ public:
 
     static CCNoteStake* NewCNoteStake(const CTxIn& txin);
 
+    const COutPoint& GetOutPoint() const { return outpointFrom; }
+
     bool InitFromTxIn(const CTxIn& txin) override { return pindexFrom; }
     const CBlockIndex* GetIndexFrom() const override;
     bool GetTxOutFrom(CTxOut& out) const override;
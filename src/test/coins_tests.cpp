@@ -199,7 +199,8 @@ public:
         // Manually recompute the dynamic usage of the whole data, and compare it.
         size_t ret = memusage::DynamicUsage(cacheCoins) +
                      memusage::DynamicUsage(cacheSaplingAnchors) +
-                     memusage::DynamicUsage(cacheSaplingNullifiers);
+                     memusage::DynamicUsage(cacheSaplingNullifiers) +
+                     memusage::DynamicUsage(vDirtyCoins);
         size_t count = 0;
         for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
             ret += memusage::DynamicUsage(it->second.coin);
@@ -211,6 +212,7 @@ public:
 
     CCoinsMap& map() { return cacheCoins; }
     size_t& usage() { return cachedCoinsUsage; }
+    std::vector<COutPoint>& dirty() { return vDirtyCoins; }
 };
 
 }
@@ -1057,7 +1059,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     CAnchorsSaplingMap mapSaplingAnchors;
     CNullifiersMap mapSaplingNullifiers;
@@ -1071,6 +1074,7 @@ public:
     {
         WriteCoinsViewEntry(base, base_value, base_value == ABSENT ? NO_ENTRY : DIRTY);
         cache.usage() += InsertCoinsMapEntry(cache.map(), cache_value, cache_flags);
+        if (cache_flags != NO_ENTRY && (cache_flags & DIRTY)) cache.dirty().push_back(OUTPOINT);
     }
 
     CCoinsView root;
@@ -1321,4 +1325,37 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+void CheckSyncCoins(CAmount base_value, CAmount cache_value, CAmount expected_base_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(base_value, cache_value, cache_flags);
+    BOOST_CHECK(test.cache.Sync());
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+    GetCoinsMapEntry(test.base.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_base_value);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    /* Check Sync behavior: the modified entries are written to the base view,
+     * the unspent ones stay in the cache as clean entries, the spent ones are
+     * dropped.
+     *
+     *              Base    Cache   Result  Result  Cache        Result
+     *              Value   Value   Base    Cache   Flags        Flags
+     */
+    CheckSyncCoins(VALUE1, ABSENT, VALUE1, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckSyncCoins(VALUE1, PRUNED, VALUE1, PRUNED, 0          , 0          );
+    CheckSyncCoins(VALUE1, PRUNED, PRUNED, ABSENT, DIRTY      , NO_ENTRY   );
+    CheckSyncCoins(ABSENT, PRUNED, ABSENT, ABSENT, DIRTY|FRESH, NO_ENTRY   );
+    CheckSyncCoins(VALUE1, VALUE1, VALUE1, VALUE1, 0          , 0          );
+    CheckSyncCoins(VALUE1, VALUE2, VALUE2, VALUE2, DIRTY      , 0          );
+    CheckSyncCoins(ABSENT, VALUE2, VALUE2, VALUE2, DIRTY|FRESH, 0          );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
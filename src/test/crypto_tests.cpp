@@ -7,6 +7,7 @@
 #include "crypto/aes.h"
 #include "crypto/rfc6979_hmac_sha256.h"
 #include "crypto/chacha20.h"
+#include "crypto/muhash.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
@@ -269,6 +270,38 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_batch) {
+    // Every implementation available, against the standard one.
+    // Lengths around the padding boundaries (kernel messages are 76 bytes), and counts
+    // not multiple of the number of lanes, so that the scalar path is used too.
+    for (auto use_implementation : {sha256_implementation::STANDARD, sha256_implementation::USE_SSE41,
+                                    sha256_implementation::USE_AVX2, sha256_implementation::USE_SHANI}) {
+        SHA256AutoDetect(use_implementation);
+        TestSHA256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        for (size_t len : {0, 1, 32, 55, 56, 63, 64, 76, 119, 120, 200}) {
+            for (size_t count : {0, 1, 3, 4, 7, 8, 9, 17}) {
+                const std::vector<unsigned char>& in = InsecureRandBytes(len * count);
+                std::vector<unsigned char> out(32 * count);
+                SHA256DBatch(out.data(), in.data(), len, count);
+                if (len == 64) {
+                    std::vector<unsigned char> out64(32 * count);
+                    SHA256D64(out64.data(), in.data(), count);
+                    BOOST_CHECK(out64 == out);
+                }
+                SHA256AutoDetect(sha256_implementation::STANDARD);
+                for (size_t i = 0; i < count; i++) {
+                    unsigned char hash[CSHA256::OUTPUT_SIZE];
+                    CSHA256().Write(in.data() + i * len, len).Finalize(hash);
+                    CSHA256().Write(hash, sizeof(hash)).Finalize(hash);
+                    BOOST_CHECK(std::equal(hash, hash + sizeof(hash), out.begin() + 32 * i));
+                }
+                SHA256AutoDetect(use_implementation);
+            }
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -538,4 +571,81 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors) {
                   "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
 }
 
+static MuHash3072 FromInt(unsigned char i)
+{
+    std::vector<unsigned char> tmp(32, 0);
+    tmp[0] = i;
+    return MuHash3072(tmp);
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    uint256 out;
+
+    // Sets built in a different order hash the same
+    for (int iter = 0; iter < 10; ++iter) {
+        uint256 res;
+        int table[4];
+        for (int i = 0; i < 4; ++i) {
+            table[i] = InsecureRandBits(3);
+        }
+        for (int order = 0; order < 4; ++order) {
+            MuHash3072 acc;
+            for (int i = 0; i < 4; ++i) {
+                int t = table[i ^ order];
+                if (t & 4) {
+                    acc /= FromInt(t & 3);
+                } else {
+                    acc *= FromInt(t & 3);
+                }
+            }
+            acc.Finalize(out);
+            if (order == 0) {
+                res = out;
+            } else {
+                BOOST_CHECK(res == out);
+            }
+        }
+
+        MuHash3072 x = FromInt(InsecureRandBits(8));  // x=X
+        MuHash3072 y = FromInt(InsecureRandBits(8));  // x=X, y=Y
+        MuHash3072 z;                                 // x=X, y=Y, z=1
+        z *= x;                                       // x=X, y=Y, z=X
+        z *= y;                                       // x=X, y=Y, z=X*Y
+        y *= x;                                       // x=X, y=Y*X, z=X*Y
+        z /= y;                                       // x=X, y=Y*X, z=1
+        z.Finalize(out);
+        uint256 out2;
+        MuHash3072().Finalize(out2);
+        BOOST_CHECK(out == out2);
+    }
+
+    MuHash3072 acc = FromInt(0);
+    acc *= FromInt(1);
+    acc /= FromInt(2);
+    acc.Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863"));
+
+    std::vector<unsigned char> tmp(32, 0);
+    MuHash3072 acc2 = FromInt(0);
+    tmp[0] = 1;
+    acc2.Insert(tmp);
+    tmp[0] = 2;
+    acc2.Remove(tmp);
+    acc2.Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863"));
+
+    // Finalize does not change the set
+    acc2.Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863"));
+
+    // Serialization round trip
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << acc;
+    MuHash3072 acc3;
+    ss >> acc3;
+    acc3.Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -111,4 +111,48 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profile)
+{
+    CDBProfile profile;
+    std::string strError;
+    BOOST_CHECK(GetDBProfile("chainstate", profile, strError));
+    BOOST_CHECK_EQUAL(profile.nMaxOpenFiles, 128);
+    BOOST_CHECK(!profile.fCompression);
+    BOOST_CHECK(GetDBProfile("index", profile, strError));
+    BOOST_CHECK(profile.fCompression);
+    BOOST_CHECK_EQUAL(profile.nMaxOpenFiles, 64);
+
+    gArgs.ForceSetArg("-dbprofile", "chainstate:compression=1,blocksize=65536,bloombits=0");
+    BOOST_CHECK(CheckDBProfileArgs(strError));
+    BOOST_CHECK(GetDBProfile("chainstate", profile, strError));
+    BOOST_CHECK(profile.fCompression);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 65536U);
+    BOOST_CHECK_EQUAL(profile.nBloomBits, 0);
+    BOOST_CHECK_EQUAL(profile.nMaxOpenFiles, 128);
+    // the other databases keep their settings
+    BOOST_CHECK(GetDBProfile("sporks", profile, strError));
+    BOOST_CHECK(!profile.fCompression);
+
+    // the database opens with them
+    {
+        fs::path ph = fs::temp_directory_path() / fs::unique_path() / "chainstate";
+        CDBWrapper dbw(ph, (1 << 20), true, false);
+        BOOST_CHECK(dbw.Write('k', uint256S("01")));
+        CDBInfo info = dbw.GetInfo();
+        BOOST_CHECK_EQUAL(info.strName, "chainstate");
+        BOOST_CHECK_EQUAL(info.profile.nBlockSize, 65536U);
+    }
+
+    gArgs.ForceSetArg("-dbprofile", "chainstate:blocksize=100");
+    BOOST_CHECK(!CheckDBProfileArgs(strError));
+    gArgs.ForceSetArg("-dbprofile", "chainstate:maxopenfiles");
+    BOOST_CHECK(!CheckDBProfileArgs(strError));
+    gArgs.ForceSetArg("-dbprofile", "chainstate:cache=1");
+    BOOST_CHECK(!CheckDBProfileArgs(strError));
+    gArgs.ForceSetArg("-dbprofile", "wallet:compression=1");
+    BOOST_CHECK(!CheckDBProfileArgs(strError));
+    gArgs.ForceSetArg("-dbprofile", "");
+    BOOST_CHECK(CheckDBProfileArgs(strError));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
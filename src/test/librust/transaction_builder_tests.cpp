@@ -10,6 +10,7 @@
 #include "sapling/sapling.h"
 #include "sapling/transaction_builder.h"
 #include "sapling/sapling_validation.h"
+#include "validation.h"
 
 #include <univalue.h>
 #include <boost/test/unit_test.hpp>
@@ -103,6 +104,26 @@ BOOST_AUTO_TEST_CASE(SaplingToSapling) {
     BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx2, state, Params(), 3, true, false));
     BOOST_CHECK_EQUAL(state.GetRejectReason(), "");
 
+    // Block validation defers the proofs and signatures to the check queue
+    BOOST_CHECK(CSaplingCheck(tx2, false)());
+    CMutableTransaction mtx(tx2);
+    mtx.sapData->bindingSig[0] ^= 1;
+    CTransaction txBadSig(mtx);
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(txBadSig, state, Params(), 3, true, false, false));
+    BOOST_CHECK(!CSaplingCheck(txBadSig, false)());
+    BOOST_CHECK(!SaplingValidation::CheckProofsAndSignatures(txBadSig, state, 100, false));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-sapling-binding-signature-invalid");
+
+    // Proofs verified with cacheStore (mempool) are not verified again by block validation
+    uint64_t nHits, nMisses, nHitsAfter, nMissesAfter;
+    SaplingValidation::GetProofCacheStats(nHits, nMisses);
+    CValidationState state2;
+    BOOST_CHECK(SaplingValidation::CheckProofsAndSignatures(tx2, state2, 100, true));
+    BOOST_CHECK(SaplingValidation::CheckProofsAndSignatures(tx2, state2, 100, false));
+    SaplingValidation::GetProofCacheStats(nHitsAfter, nMissesAfter);
+    BOOST_CHECK_EQUAL(nHitsAfter - nHits, 1);
+    BOOST_CHECK_EQUAL(nMissesAfter - nMisses, 1);
+
     // Revert to default
     RegtestDeactivateSapling();
 }
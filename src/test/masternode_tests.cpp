@@ -0,0 +1,144 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_c_note.h"
+
+#include "masternode-sync.h"
+#include "masternode.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "protocol.h"
+#include "validation.h"
+
+#include <atomic>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_tests, TestingSetup)
+
+static CDataStream Serialized(const CMasternodePing& mnp)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << mnp;
+    return ss;
+}
+
+static CDataStream Serialized(const CMasternodeBroadcast& mnb)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << mnb;
+    return ss;
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_mnb_mnp_processing)
+{
+    const int64_t nNow = GetAdjustedTime();
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    mnodeman.CacheBlockHash(pindexTip);
+    mnodeman.SetBestHeight(pindexTip->nHeight);
+    WITH_LOCK(g_best_block_mutex, g_best_block_time = nNow);
+    BOOST_CHECK(masternodeSync.IsBlockchainSynced());
+
+    CKey keyWrong;
+    keyWrong.MakeNewKey(true);
+
+    // Masternodes in the list, each one gets a valid ping, an invalid ping and an invalid broadcast
+    const int nMasternodes = 20;
+    std::vector<CMasternodePing> vValidPings, vInvalidPings;
+    std::vector<std::pair<std::string, CDataStream>> vMessages;
+    for (int i = 0; i < nMasternodes; i++) {
+        CKey keyMasternode;
+        keyMasternode.MakeNewKey(true);
+        CMasternode mn;
+        mn.vin = CTxIn(COutPoint(GetRandHash(), 0));
+        mn.addr = CService(CNetAddr(), Params().GetDefaultPort());
+        mn.pubKeyCollateralAddress = keyWrong.GetPubKey();
+        mn.pubKeyMasternode = keyMasternode.GetPubKey();
+        mn.protocolVersion = PROTOCOL_VERSION;
+        mn.sigTime = nNow - 2 * 60 * 60;
+        mn.lastPing = CMasternodePing(mn.vin, pindexTip->GetBlockHash(), nNow - 30 * 60);
+        BOOST_CHECK(mnodeman.Add(mn));
+
+        CMasternodePing mnpValid(mn.vin, pindexTip->GetBlockHash(), nNow - i);
+        BOOST_CHECK(mnpValid.Sign(keyMasternode, keyMasternode.GetPubKey().GetID()));
+        vValidPings.push_back(mnpValid);
+        vMessages.emplace_back(NetMsgType::MNPING, Serialized(mnpValid));
+
+        CMasternodePing mnpInvalid(mn.vin, pindexTip->GetBlockHash(), nNow - 60 - i);
+        BOOST_CHECK(mnpInvalid.Sign(keyWrong, keyWrong.GetPubKey().GetID()));
+        vInvalidPings.push_back(mnpInvalid);
+        vMessages.emplace_back(NetMsgType::MNPING, Serialized(mnpInvalid));
+
+        CMasternodeBroadcast mnb(mn);
+        mnb.sigTime = nNow;
+        mnb.pubKeyCollateralAddress = keyMasternode.GetPubKey();
+        BOOST_CHECK(mnb.Sign(keyWrong, keyWrong.GetPubKey()));
+        vMessages.emplace_back(NetMsgType::MNBROADCAST, Serialized(mnb));
+
+        // Ping of a masternode not in the list: the signature can't be checked, the entry is asked for
+        CMasternodePing mnpUnknown(CTxIn(COutPoint(GetRandHash(), 0)), pindexTip->GetBlockHash(), nNow);
+        BOOST_CHECK(mnpUnknown.Sign(keyMasternode, keyMasternode.GetPubKey().GetID()));
+        vInvalidPings.push_back(mnpUnknown);
+        vMessages.emplace_back(NetMsgType::MNPING, Serialized(mnpUnknown));
+    }
+
+    CAddress addr(CService(CNetAddr(), Params().GetDefaultPort()), NODE_NONE);
+    CNode dummyNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+    dummyNode.SetSendVersion(PROTOCOL_VERSION);
+    GetNodeSignals().InitializeNode(&dummyNode, *connman);
+    dummyNode.nVersion = PROTOCOL_VERSION;
+    dummyNode.fSuccessfullyConnected = true;
+
+    // Every message is processed by several threads at once, while another one reads the seen maps
+    const int nThreads = 4;
+    std::atomic<bool> fDone(false);
+    std::atomic<bool> fReadError(false);
+    std::thread reader([&] {
+        while (!fDone) {
+            for (const CMasternodePing& mnp : vValidPings) {
+                CMasternodePing mnpSeen;
+                if (mnodeman.GetSeenPing(mnp.GetHash(), mnpSeen) && mnpSeen.GetHash() != mnp.GetHash()) {
+                    fReadError = true;
+                }
+            }
+            for (const CMasternodePing& mnp : vInvalidPings) {
+                if (mnodeman.HasSeenPing(mnp.GetHash())) fReadError = true;
+            }
+        }
+    });
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        workers.emplace_back([&, t] {
+            for (size_t i = 0; i < vMessages.size(); i++) {
+                const auto& msg = vMessages[(i + t * vMessages.size() / nThreads) % vMessages.size()];
+                std::string strCommand = msg.first;
+                CDataStream vRecv(msg.second);
+                mnodeman.ProcessMessage(&dummyNode, strCommand, vRecv);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    fDone = true;
+    reader.join();
+    BOOST_CHECK(!fReadError);
+
+    for (const CMasternodePing& mnp : vValidPings) {
+        BOOST_CHECK(mnodeman.HasSeenPing(mnp.GetHash()));
+        const CMasternode* pmn = mnodeman.Find(mnp.vin.prevout);
+        BOOST_CHECK(pmn && pmn->lastPing.sigTime == mnp.sigTime);
+    }
+    for (const CMasternodePing& mnp : vInvalidPings) {
+        BOOST_CHECK(!mnodeman.HasSeenPing(mnp.GetHash()));
+    }
+
+    bool dummy;
+    GetNodeSignals().FinalizeNode(dummyNode.GetId(), dummy);
+    mnodeman.Clear();
+    masternodeSync.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
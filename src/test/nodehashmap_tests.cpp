@@ -0,0 +1,268 @@
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coins.h"
+#include "nodehashmap.h"
+#include "poolallocator.h"
+#include "random.h"
+
+#include "test/test_c_note.h"
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+//! Puts the keys in 4 groups of colliding hashes, so that lookups probe long runs of slots
+struct CollidingHasher {
+    size_t operator()(uint32_t key) const { return key % 4; }
+};
+
+typedef PoolAllocator<std::pair<const uint32_t, uint64_t>, 64> TestAllocator;
+typedef nodehashmap<uint32_t, uint64_t, CollidingHasher, std::equal_to<uint32_t>, TestAllocator> CollidingMap;
+typedef nodehashmap<uint32_t, uint64_t, std::hash<uint32_t>, std::equal_to<uint32_t>, TestAllocator> TestMap;
+
+template <typename Map>
+void CheckEqual(const Map& map, const std::map<uint32_t, uint64_t>& expected)
+{
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    size_t nIterated = 0;
+    for (const auto& entry : map) {
+        auto it = expected.find(entry.first);
+        BOOST_CHECK(it != expected.end() && it->second == entry.second);
+        nIterated++;
+    }
+    BOOST_CHECK_EQUAL(nIterated, expected.size());
+    for (const auto& entry : expected) {
+        auto it = map.find(entry.first);
+        BOOST_CHECK(it != map.end() && it->second == entry.second);
+    }
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(nodehashmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(probing_across_deleted_slots)
+{
+    TestAllocator::ResourceType resource;
+    CollidingMap map(0, CollidingHasher(), std::equal_to<uint32_t>(), &resource);
+
+    // 0, 4, 8 and 12 share a run of slots
+    for (uint32_t key : {0, 4, 8, 12}) {
+        map[key] = key;
+    }
+    BOOST_CHECK(map.erase(4));
+    BOOST_CHECK(map.erase(8));
+    BOOST_CHECK(!map.erase(8));
+    // The keys past the deleted slots are still found, the erased ones are not
+    BOOST_CHECK(map.find(12) != map.end() && map.find(12)->second == 12);
+    BOOST_CHECK(map.find(4) == map.end());
+    BOOST_CHECK(map.find(8) == map.end());
+    BOOST_CHECK_EQUAL(map.count(0), 1U);
+
+    // An insertion reuses a deleted slot, and does not duplicate a key found past it
+    BOOST_CHECK(map.emplace(16, 16).second);
+    BOOST_CHECK(!map.emplace(12, 0).second);
+    BOOST_CHECK_EQUAL(map.find(12)->second, 12U);
+    CheckEqual(map, {{0, 0}, {12, 12}, {16, 16}});
+}
+
+BOOST_AUTO_TEST_CASE(erase_while_iterating)
+{
+    TestAllocator::ResourceType resource;
+    TestMap map(0, std::hash<uint32_t>(), std::equal_to<uint32_t>(), &resource);
+    std::map<uint32_t, uint64_t> expected;
+    for (uint32_t i = 0; i < 1000; i++) {
+        map[i] = i;
+        expected[i] = i;
+    }
+
+    // Every element is visited exactly once, whether it is erased or kept
+    std::set<uint32_t> visited;
+    for (auto it = map.begin(); it != map.end();) {
+        BOOST_CHECK(visited.insert(it->first).second);
+        if (it->first % 3 == 0) {
+            expected.erase(it->first);
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    BOOST_CHECK_EQUAL(visited.size(), 1000U);
+    CheckEqual(map, expected);
+
+    for (auto it = map.begin(); it != map.end();) {
+        it = map.erase(it);
+    }
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(rehash_and_reference_stability)
+{
+    TestAllocator::ResourceType resource;
+    TestMap map(0, std::hash<uint32_t>(), std::equal_to<uint32_t>(), &resource);
+    std::map<uint32_t, uint64_t> expected;
+    std::map<uint32_t, const uint64_t*> references;
+    for (uint32_t i = 0; i < 100; i++) {
+        map[i] = i;
+        expected[i] = i;
+        references[i] = &map.find(i)->second;
+    }
+    const size_t nSlots = map.bucket_count();
+
+    // Growing the index does not move the elements
+    for (uint32_t i = 100; i < 2000; i++) {
+        map.emplace(i, i);
+        expected[i] = i;
+    }
+    BOOST_CHECK(map.bucket_count() > nSlots);
+    for (const auto& ref : references) {
+        BOOST_CHECK(&map.find(ref.first)->second == ref.second);
+        BOOST_CHECK_EQUAL(*ref.second, ref.first);
+    }
+    CheckEqual(map, expected);
+
+    // Inserting and erasing at a constant size rebuilds the index to drop the deleted
+    // slots, without growing it
+    const size_t nSlotsFull = map.bucket_count();
+    for (uint32_t i = 2000; i < 20000; i++) {
+        map.erase(i - 1900);
+        expected.erase(i - 1900);
+        map[i] = i;
+        expected[i] = i;
+    }
+    BOOST_CHECK_EQUAL(map.bucket_count(), nSlotsFull);
+    for (uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK(&map.find(i)->second == references[i]);
+    }
+    CheckEqual(map, expected);
+
+    // reserve grows the index at once, clear keeps it
+    map.reserve(100000);
+    const size_t nSlotsReserved = map.bucket_count();
+    BOOST_CHECK(nSlotsReserved >= 100000U * 4 / 3);
+    CheckEqual(map, expected);
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(map.bucket_count(), nSlotsReserved);
+    BOOST_CHECK(map.find(0) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(random_operations)
+{
+    // Same operations on a nodehashmap and a std::map, with frequent collisions
+    TestAllocator::ResourceType resource;
+    CollidingMap map(0, CollidingHasher(), std::equal_to<uint32_t>(), &resource);
+    std::map<uint32_t, uint64_t> expected;
+    for (int i = 0; i < 20000; i++) {
+        const uint32_t key = InsecureRandRange(500);
+        switch (InsecureRandRange(4)) {
+        case 0: {
+            const uint64_t value = InsecureRandBits(32);
+            map[key] = value;
+            expected[key] = value;
+            break;
+        }
+        case 1: {
+            const uint64_t value = InsecureRandBits(32);
+            BOOST_CHECK_EQUAL(map.emplace(key, uint64_t(value)).second, expected.emplace(key, value).second);
+            break;
+        }
+        case 2:
+            BOOST_CHECK_EQUAL(map.erase(key), expected.erase(key));
+            break;
+        case 3: {
+            auto it = map.find(key);
+            auto itExpected = expected.find(key);
+            BOOST_CHECK_EQUAL(it == map.end(), itExpected == expected.end());
+            if (it != map.end() && itExpected != expected.end()) BOOST_CHECK_EQUAL(it->second, itExpected->second);
+            break;
+        }
+        }
+    }
+    CheckEqual(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(coins_map_types)
+{
+    // The coins cache usage (see CCoinsViewCache) on both map types, whichever one CCoinsMap is
+    typedef nodehashmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> FlatCoinsMap;
+    typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> StdCoinsMap;
+
+    CCoinsMapMemoryResource resourceFlat, resourceStd;
+    FlatCoinsMap mapFlat(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &resourceFlat);
+    StdCoinsMap mapStd(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &resourceStd);
+
+    std::vector<COutPoint> outpoints;
+    std::vector<const Coin*> coinsFlat;
+    for (int i = 0; i < 2000; i++) {
+        outpoints.emplace_back(InsecureRand256(), InsecureRandRange(4));
+        Coin coin(CTxOut(i, CScript() << i), i, false, false);
+        // FetchCoin/AddCoin: piecewise emplace, then fill in the entry
+        auto itFlat = mapFlat.emplace(std::piecewise_construct, std::forward_as_tuple(outpoints.back()), std::tuple<>()).first;
+        auto itStd = mapStd.emplace(std::piecewise_construct, std::forward_as_tuple(outpoints.back()), std::tuple<>()).first;
+        itFlat->second.coin = coin;
+        itFlat->second.flags = CCoinsCacheEntry::DIRTY | (i % 2 ? CCoinsCacheEntry::FRESH : 0);
+        itStd->second.coin = coin;
+        itStd->second.flags = itFlat->second.flags;
+        coinsFlat.push_back(&itFlat->second.coin);
+    }
+
+    // BatchWrite: erase the entries while iterating, skip the fresh and spent ones
+    size_t nErasedFlat = 0, nErasedStd = 0;
+    for (auto it = mapFlat.begin(); it != mapFlat.end();) {
+        if (it->second.flags & CCoinsCacheEntry::FRESH) {
+            ++it;
+        } else {
+            it = mapFlat.erase(it);
+            nErasedFlat++;
+        }
+    }
+    for (auto it = mapStd.begin(); it != mapStd.end();) {
+        if (it->second.flags & CCoinsCacheEntry::FRESH) {
+            ++it;
+        } else {
+            it = mapStd.erase(it);
+            nErasedStd++;
+        }
+    }
+    BOOST_CHECK_EQUAL(nErasedFlat, 1000U);
+    BOOST_CHECK_EQUAL(nErasedStd, 1000U);
+    BOOST_CHECK_EQUAL(mapFlat.size(), mapStd.size());
+
+    // The references returned by AccessCoin are still valid
+    for (size_t i = 1; i < outpoints.size(); i += 2) {
+        auto itFlat = mapFlat.find(outpoints[i]);
+        auto itStd = mapStd.find(outpoints[i]);
+        BOOST_CHECK(itFlat != mapFlat.end() && itStd != mapStd.end());
+        BOOST_CHECK(&itFlat->second.coin == coinsFlat[i]);
+        BOOST_CHECK(itFlat->second.coin.out == itStd->second.coin.out);
+        BOOST_CHECK_EQUAL(itFlat->second.coin.nHeight, itStd->second.coin.nHeight);
+    }
+    for (size_t i = 0; i < outpoints.size(); i += 2) {
+        BOOST_CHECK(mapFlat.find(outpoints[i]) == mapFlat.end());
+        BOOST_CHECK(mapStd.find(outpoints[i]) == mapStd.end());
+    }
+
+    // Flush, then the pool gives the memory of the old entries to the next ones
+    mapFlat.clear();
+    mapStd.clear();
+    const size_t nChunksFlat = resourceFlat.NumAllocatedChunks();
+    const size_t nChunksStd = resourceStd.NumAllocatedChunks();
+    for (const COutPoint& outpoint : outpoints) {
+        mapFlat[outpoint].flags = CCoinsCacheEntry::DIRTY;
+        mapStd[outpoint].flags = CCoinsCacheEntry::DIRTY;
+    }
+    BOOST_CHECK_EQUAL(mapFlat.size(), outpoints.size());
+    BOOST_CHECK_EQUAL(mapStd.size(), outpoints.size());
+    BOOST_CHECK_EQUAL(resourceFlat.NumAllocatedChunks(), nChunksFlat);
+    BOOST_CHECK_EQUAL(resourceStd.NumAllocatedChunks(), nChunksStd);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
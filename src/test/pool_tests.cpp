@@ -0,0 +1,138 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Copyright (c) 2021 The C_Note developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "poolallocator.h"
+#include "random.h"
+
+#include "test/test_c_note.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource;
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // A freed block is handed out again by the next allocation of the same size
+    void* block = resource.Allocate(8, 8);
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK(resource.Allocate(8, 8) == block);
+
+    // Sizes up to the max block size share the pools, rounded up to the alignment
+    void* b1 = resource.Allocate(1, 1);
+    resource.Deallocate(b1, 1, 1);
+    BOOST_CHECK(resource.Allocate(8, 8) == b1);
+
+    // Too large or too aligned: forwarded to operator new, the chunks are not used
+    void* big = resource.Allocate(16, 8);
+    void* aligned = resource.Allocate(8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    resource.Deallocate(big, 16, 8);
+    resource.Deallocate(aligned, 8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    resource.Deallocate(block, 8, 8);
+    resource.Deallocate(b1, 8, 8);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_allocation)
+{
+    // Exactly 4 blocks of 16 bytes per chunk
+    PoolResource<16, 8> resource(64);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 64U);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 4; i++) {
+        blocks.push_back(resource.Allocate(16, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    blocks.push_back(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // Freed blocks are reused before any new chunk
+    for (void* block : blocks) {
+        resource.Deallocate(block, 16, 8);
+    }
+    std::set<void*> reused;
+    for (int i = 0; i < 5; i++) {
+        reused.insert(resource.Allocate(16, 8));
+    }
+    BOOST_CHECK(reused == std::set<void*>(blocks.begin(), blocks.end()));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // The 8 bytes left in a chunk go to the freelist of their size when the next one is allocated
+    PoolResource<16, 8> resource_leftover(24);
+    void* first = resource_leftover.Allocate(16, 8);
+    resource_leftover.Allocate(16, 8);
+    BOOST_CHECK_EQUAL(resource_leftover.NumAllocatedChunks(), 2U);
+    BOOST_CHECK(resource_leftover.Allocate(8, 8) == static_cast<char*>(first) + 16);
+    BOOST_CHECK_EQUAL(resource_leftover.NumAllocatedChunks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(random_allocations)
+{
+    // Blocks of random sizes filled with a pattern: they must not overlap
+    PoolResource<128, 8> resource(1024);
+    std::map<unsigned char*, std::pair<size_t, unsigned char>> blocks;
+    for (int i = 0; i < 10000; i++) {
+        if (blocks.empty() || InsecureRandBits(2) != 0) {
+            const size_t size = 1 + InsecureRandRange(160);
+            const unsigned char pattern = InsecureRandBits(8);
+            unsigned char* p = static_cast<unsigned char*>(resource.Allocate(size, 8));
+            std::fill(p, p + size, pattern);
+            BOOST_CHECK(blocks.emplace(p, std::make_pair(size, pattern)).second);
+        } else {
+            auto it = blocks.begin();
+            std::advance(it, InsecureRandRange(blocks.size()));
+            const unsigned char* p = it->first;
+            BOOST_CHECK(std::all_of(p, p + it->second.first, [&](unsigned char c) { return c == it->second.second; }));
+            resource.Deallocate(it->first, it->second.first, 8);
+            blocks.erase(it);
+        }
+    }
+    for (const auto& block : blocks) {
+        const unsigned char* p = block.first;
+        BOOST_CHECK(std::all_of(p, p + block.second.first, [&](unsigned char c) { return c == block.second.second; }));
+        resource.Deallocate(block.first, block.second.first, 8);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unordered_map_reuses_the_chunks)
+{
+    typedef PoolAllocator<std::pair<const uint64_t, uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>) + sizeof(void*) * 4> Allocator;
+    typedef std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, Allocator> Map;
+
+    Allocator::ResourceType resource;
+    Map map(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), &resource);
+    for (uint64_t i = 0; i < 50000; i++) {
+        map[i] = i;
+    }
+    const size_t nChunks = resource.NumAllocatedChunks();
+    BOOST_CHECK(nChunks > 1);
+
+    // The nodes of the erased entries make room for the new ones
+    for (uint64_t round = 1; round <= 3; round++) {
+        for (uint64_t i = 0; i < 50000; i++) {
+            map.erase(i + (round - 1) * 50000);
+            map[i + round * 50000] = i;
+        }
+        BOOST_CHECK_EQUAL(map.size(), 50000U);
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+    }
+    for (uint64_t i = 0; i < 50000; i++) {
+        BOOST_CHECK_EQUAL(map.at(i + 3 * 50000), i);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
+#include "chain.h"
 #include "optional.h"
 #include "serialize.h"
 #include "streams.h"
@@ -371,4 +372,31 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(stake_modifier)
+{
+    // The inline stake modifier must keep the byte vector serialization of the block index
+    for (size_t len : {0, 8, 32}) {
+        std::vector<unsigned char> vch(len);
+        for (size_t i = 0; i < len; i++) vch[i] = (unsigned char) (i * 7 + 1);
+
+        CStakeModifier mod;
+        mod.assign(vch.data(), vch.size());
+        CDataStream ssVec(SER_DISK, 0), ssMod(SER_DISK, 0);
+        ssVec << vch;
+        ssMod << mod;
+        BOOST_CHECK(ssVec.str() == ssMod.str());
+
+        CStakeModifier mod2;
+        ssVec >> mod2;
+        BOOST_CHECK_EQUAL(mod2.size(), len);
+        BOOST_CHECK(std::equal(vch.begin(), vch.end(), mod2.data()));
+    }
+
+    // Larger modifiers are rejected
+    CDataStream ss(SER_DISK, 0);
+    ss << std::vector<unsigned char>(CStakeModifier::MAX_SIZE + 1);
+    CStakeModifier mod;
+    BOOST_CHECK_THROW(ss >> mod, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
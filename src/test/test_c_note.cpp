@@ -9,12 +9,14 @@
 #include "test/test_c_note.h"
 
 #include "blockassembler.h"
+#include "crypto/sha256.h"
 #include "guiinterface.h"
 #include "miner.h"
 #include "net_processing.h"
 #include "random.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
+#include "sapling/sapling_validation.h"
 #include "script/sigcache.h"
 #include "sporkdb.h"
 #include "txmempool.h"
@@ -41,10 +43,12 @@ std::ostream& operator<<(std::ostream& os, const uint256& num)
 
 BasicTestingSetup::BasicTestingSetup()
 {
+        SHA256AutoDetect();
         RandomInit();
         ECC_Start();
         SetupEnvironment();
         InitSignatureCache();
+        SaplingValidation::InitProofCache();
         fCheckBlockIndex = true;
         SelectParams(CBaseChainParams::MAIN);
 }
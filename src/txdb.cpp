@@ -8,11 +8,14 @@
 #include "txdb.h"
 
 #include "random.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
 #include "util.h"
+#include "validation.h"
 
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
@@ -90,6 +93,16 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
                               const uint256& hashSaplingAnchor,
                               CAnchorsSaplingMap& mapSaplingAnchors,
                               CNullifiersMap& mapSaplingNullifiers)
+{
+    return WriteCoins(mapCoins, hashBlock, hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers, true);
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap& mapCoins,
+                              const uint256& hashBlock,
+                              const uint256& hashSaplingAnchor,
+                              CAnchorsSaplingMap& mapSaplingAnchors,
+                              CNullifiersMap& mapSaplingNullifiers,
+                              bool fErase)
 {
     CDBBatch batch;
     size_t count = 0;
@@ -125,8 +138,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (fErase) {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -159,6 +176,214 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundWriter::CCoinsViewBackgroundWriter(CCoinsViewDB* dbIn) : CCoinsViewBacked(dbIn), db(dbIn)
+{
+    thread = std::thread(&TraceThread<std::function<void()> >, "coinswrite", std::function<void()>(std::bind(&CCoinsViewBackgroundWriter::ThreadWrite, this)));
+}
+
+CCoinsViewBackgroundWriter::~CCoinsViewBackgroundWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+void CCoinsViewBackgroundWriter::ThreadWrite()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        cond.wait(lock, [this] { return pending || fStop; });
+        // After a failed write the database is left between two blocks: stop
+        // there, the node shuts down and replays the blocks at the next start
+        if (!pending || fFailed) break;
+        writing = std::move(pending);
+        // let BatchWrite queue the next one
+        cond.notify_all();
+        lock.unlock();
+
+        const int64_t nStart = GetTimeMillis();
+        const size_t nCoins = writing->mapCoins.size();
+        // The Sapling maps are consumed by the write, the lookups go on with a copy
+        CAnchorsSaplingMap mapSaplingAnchors(writing->mapSaplingAnchors);
+        CNullifiersMap mapSaplingNullifiers(writing->mapSaplingNullifiers);
+        bool fOk = false;
+        try {
+            fOk = db->WriteCoins(writing->mapCoins, writing->hashBlock, writing->hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        LogPrint(BCLog::COINDB, "Background write of %u coins at block %s: %dms\n", nCoins, writing->hashBlock.GetHex(), GetTimeMillis() - nStart);
+
+        lock.lock();
+        if (!fOk) {
+            // Keep the batch: the lookups still need its coins, the database
+            // may only have part of them
+            fFailed = true;
+            cond.notify_all();
+            lock.unlock();
+            AbortNode("Failed to write to coin database");
+            return;
+        }
+        std::unique_ptr<Batch> done = std::move(writing);
+        cond.notify_all();
+        lock.unlock();
+        done.reset();
+        lock.lock();
+    }
+}
+
+const CCoinsCacheEntry* CCoinsViewBackgroundWriter::FindCoin(const COutPoint& outpoint) const
+{
+    for (const Batch* batch : {pending.get(), writing.get()}) {
+        if (!batch) continue;
+        CCoinsMap::const_iterator it = batch->mapCoins.find(outpoint);
+        if (it != batch->mapCoins.end()) return &it->second;
+    }
+    return nullptr;
+}
+
+bool CCoinsViewBackgroundWriter::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        const CCoinsCacheEntry* entry = FindCoin(outpoint);
+        if (entry) {
+            if (entry->coin.IsSpent()) return false;
+            coin = entry->coin;
+            return true;
+        }
+    }
+    // Only the queued and in-flight entries are being modified in the database
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundWriter::HaveCoin(const COutPoint& outpoint) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        const CCoinsCacheEntry* entry = FindCoin(outpoint);
+        if (entry) return !entry->coin.IsSpent();
+    }
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestBlock() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pending) return pending->hashBlock;
+        if (writing) return writing->hashBlock;
+    }
+    return base->GetBestBlock();
+}
+
+CCoinsViewCursor* CCoinsViewBackgroundWriter::Cursor() const
+{
+    WaitForWrites();
+    return base->Cursor();
+}
+
+bool CCoinsViewBackgroundWriter::BatchWrite(CCoinsMap& mapCoins,
+                                            const uint256& hashBlock,
+                                            const uint256& hashSaplingAnchor,
+                                            CAnchorsSaplingMap& mapSaplingAnchors,
+                                            CNullifiersMap& mapSaplingNullifiers)
+{
+    std::unique_ptr<Batch> batch(new Batch());
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            batch->nUsage += it->second.coin.DynamicMemoryUsage();
+            batch->mapCoins.emplace(it->first, std::move(it->second));
+        }
+        CCoinsMap::iterator itOld = it++;
+        mapCoins.erase(itOld);
+    }
+    for (const auto& it : mapSaplingAnchors) {
+        if (it.second.flags & CAnchorsSaplingCacheEntry::DIRTY) batch->mapSaplingAnchors.emplace(it);
+    }
+    mapSaplingAnchors.clear();
+    for (const auto& it : mapSaplingNullifiers) {
+        if (it.second.flags & CNullifiersCacheEntry::DIRTY) batch->mapSaplingNullifiers.emplace(it);
+    }
+    mapSaplingNullifiers.clear();
+    batch->hashBlock = hashBlock;
+    batch->hashSaplingAnchor = hashSaplingAnchor;
+    batch->nUsage += memusage::DynamicUsage(batch->mapCoins) +
+                     memusage::DynamicUsage(batch->mapSaplingAnchors) +
+                     memusage::DynamicUsage(batch->mapSaplingNullifiers);
+
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this] { return !pending || fFailed; });
+        if (fFailed) return false;
+        pending = std::move(batch);
+    }
+    cond.notify_all();
+    return true;
+}
+
+bool CCoinsViewBackgroundWriter::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (const Batch* batch : {pending.get(), writing.get()}) {
+            if (!batch) continue;
+            CAnchorsSaplingMap::const_iterator it = batch->mapSaplingAnchors.find(rt);
+            if (it != batch->mapSaplingAnchors.end()) {
+                if (!it->second.entered) return false;
+                tree = it->second.tree;
+                return true;
+            }
+        }
+    }
+    return base->GetSaplingAnchorAt(rt, tree);
+}
+
+bool CCoinsViewBackgroundWriter::GetNullifier(const uint256 &nullifier) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (const Batch* batch : {pending.get(), writing.get()}) {
+            if (!batch) continue;
+            CNullifiersMap::const_iterator it = batch->mapSaplingNullifiers.find(nullifier);
+            if (it != batch->mapSaplingNullifiers.end()) return it->second.entered;
+        }
+    }
+    return base->GetNullifier(nullifier);
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestAnchor() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        // A null anchor is not written (see BatchWriteSapling)
+        for (const Batch* batch : {pending.get(), writing.get()}) {
+            if (batch && !batch->hashSaplingAnchor.IsNull()) return batch->hashSaplingAnchor;
+        }
+    }
+    return base->GetBestAnchor();
+}
+
+bool CCoinsViewBackgroundWriter::WaitForWrites() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    cond.wait(lock, [this] { return (!pending && !writing) || fFailed; });
+    return !fFailed;
+}
+
+size_t CCoinsViewBackgroundWriter::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    size_t nUsage = 0;
+    for (const Batch* batch : {pending.get(), writing.get()}) {
+        if (batch) nUsage += batch->nUsage;
+    }
+    return nUsage;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
 {
 }
@@ -296,21 +521,68 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexShard(int nShard, std::vector<std::pair<uint256, CDiskBlockIndex>>& vEntries)
 {
+    vEntries.clear();
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, UINT256_ZERO));
+    uint256 hashStart;
+    *hashStart.begin() = (unsigned char) nShard;
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashStart));
 
-    // Load mapBlockIndex
     while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() != nShard) {
+            break;
+        }
+        CDiskBlockIndex diskindex;
+        if (!pcursor->GetValue(diskindex)) {
+            return error("%s : failed to read value", __func__);
+        }
+        const uint256& hashBlock = diskindex.GetBlockHash();
+        if (!Params().GetConsensus().NetworkUpgradeActive(diskindex.nHeight, Consensus::UPGRADE_POS)) {
+            if (!CheckProofOfWork(hashBlock, diskindex.nBits))
+                return error("LoadBlockIndex() : CheckProofOfWork failed: block %s, height %d", hashBlock.ToString(), diskindex.nHeight);
+        }
+        vEntries.emplace_back(hashBlock, std::move(diskindex));
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
+{
+    // The entries are read in BLOCK_INDEX_SHARDS key ranges (by first byte of the block hash).
+    // Each worker reads, deserializes and checks (block hash and PoW) one range with its own
+    // iterator, then this thread inserts the entries of the whole round in mapBlockIndex.
+    nThreads = std::max(1, std::min(nThreads, BLOCK_INDEX_SHARDS));
+    std::vector<std::vector<std::pair<uint256, CDiskBlockIndex>>> vShards(nThreads);
+    std::vector<int> vResults(nThreads);
+    int64_t nTimeRead = 0, nTimeInsert = 0;
+    size_t nEntries = 0;
+
+    for (int nFirst = 0; nFirst < BLOCK_INDEX_SHARDS; nFirst += nThreads) {
+        boost::this_thread::interruption_point();
+        const int nCount = std::min(nThreads, BLOCK_INDEX_SHARDS - nFirst);
+
+        const int64_t nTime0 = GetTimeMicros();
+        std::vector<std::thread> threads;
+        for (int i = 1; i < nCount; i++) {
+            threads.emplace_back([this, i, nFirst, &vShards, &vResults]() {
+                vResults[i] = LoadBlockIndexShard(nFirst + i, vShards[i]);
+            });
+        }
+        vResults[0] = LoadBlockIndexShard(nFirst, vShards[0]);
+        for (std::thread& t : threads) t.join();
+        const int64_t nTime1 = GetTimeMicros();
+        nTimeRead += nTime1 - nTime0;
+
+        // Construct block index objects
+        for (int i = 0; i < nCount; i++) {
+            if (!vResults[i]) return false;
+            for (const auto& entry : vShards[i]) {
+                const CDiskBlockIndex& diskindex = entry.second;
+                CBlockIndex* pindexNew = insertBlockIndex(entry.first);
                 pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight = diskindex.nHeight;
                 pindexNew->nFile = diskindex.nFile;
@@ -330,22 +602,16 @@ bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)
 
                 //Proof Of Stake
                 pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->vStakeModifier = diskindex.vStakeModifier;
-
-                if (!Params().GetConsensus().NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_POS)) {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
-                        return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
-                }
-
-                pcursor->Next();
-            } else {
-                return error("%s : failed to read value", __func__);
+                pindexNew->stakeModifier = diskindex.stakeModifier;
             }
-        } else {
-            break;
+            nEntries += vShards[i].size();
+            vShards[i].clear();
         }
+        nTimeInsert += GetTimeMicros() - nTime1;
     }
 
+    LogPrint(BCLog::BENCH, "%s: %u entries, read and checked: %.2fms (%d threads), inserted: %.2fms\n",
+             __func__, nEntries, nTimeRead * 0.001, nThreads, nTimeInsert * 0.001);
     return true;
 }
 
@@ -12,8 +12,12 @@
 #include "chain.h"
 #include "dbwrapper.h"
 
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -26,10 +30,14 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 100;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -backgroundflush default
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
 //! max. -dbcache in (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! Number of key ranges the block index is split into when loading
+static const int BLOCK_INDEX_SHARDS = 256;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -85,6 +93,18 @@ public:
                     CAnchorsSaplingMap& mapSaplingAnchors,
                     CNullifiersMap& mapSaplingNullifiers) override;
 
+    /**
+     * Like BatchWrite, but with the written coins left in mapCoins (the
+     * Sapling maps are still consumed): lookups can keep using them until
+     * the last batch is committed.
+     */
+    bool WriteCoins(CCoinsMap& mapCoins,
+                    const uint256& hashBlock,
+                    const uint256& hashSaplingAnchor,
+                    CAnchorsSaplingMap& mapSaplingAnchors,
+                    CNullifiersMap& mapSaplingNullifiers,
+                    bool fErase = false);
+
     // Sapling, the implementation of the following functions can be found in sapling_txdb.cpp.
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
     bool GetNullifier(const uint256 &nf) const override;
@@ -117,6 +137,78 @@ private:
     friend class CCoinsViewDB;
 };
 
+/**
+ * CCoinsView that writes to its base (the coin database) from a background
+ * thread: BatchWrite queues the dirty entries and returns, the writer thread
+ * commits them with CCoinsViewDB::BatchWrite (in -dbbatchsize batches,
+ * between the DB_HEAD_BLOCKS markers, so an interrupted write is replayed at
+ * the next start). The lookups see the queued and in-flight entries before
+ * the database.
+ * One write is queued at most: BatchWrite waits for the previous one to be
+ * picked up by the writer thread. The memory of the queued and in-flight
+ * batches counts against -dbcache (see FlushStateToDisk).
+ * A failed write aborts the node right away. The batches are kept, so the
+ * lookups go on seeing their coins until the shutdown.
+ */
+class CCoinsViewBackgroundWriter : public CCoinsViewBacked
+{
+private:
+    struct Batch {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap mapCoins;
+        uint256 hashBlock;
+        uint256 hashSaplingAnchor;
+        CAnchorsSaplingMap mapSaplingAnchors;
+        CNullifiersMap mapSaplingNullifiers;
+        //! Memory used by the entries, see DynamicMemoryUsage
+        size_t nUsage{0};
+
+        Batch() : mapCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource) {}
+    };
+
+    mutable std::mutex cs;
+    mutable std::condition_variable cond;
+    //! Newest batch, waiting for the writer thread
+    std::unique_ptr<Batch> pending;
+    //! Batch being written
+    std::unique_ptr<Batch> writing;
+    bool fStop{false};
+    bool fFailed{false};
+    CCoinsViewDB* db;
+    std::thread thread;
+
+    void ThreadWrite();
+
+    //! Queued or in-flight entry for outpoint, newest first (cs must be held)
+    const CCoinsCacheEntry* FindCoin(const COutPoint& outpoint) const;
+
+public:
+    explicit CCoinsViewBackgroundWriter(CCoinsViewDB* dbIn);
+    //! Writes the queued batch and stops the writer thread
+    ~CCoinsViewBackgroundWriter();
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    uint256 GetBestBlock() const override;
+    CCoinsViewCursor* Cursor() const override;
+
+    bool BatchWrite(CCoinsMap& mapCoins,
+                    const uint256& hashBlock,
+                    const uint256& hashSaplingAnchor,
+                    CAnchorsSaplingMap& mapSaplingAnchors,
+                    CNullifiersMap& mapSaplingNullifiers) override;
+
+    bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
+    bool GetNullifier(const uint256 &nullifier) const override;
+    uint256 GetBestAnchor() const override;
+
+    //! Wait until the queued writes are committed, false if one of them failed
+    bool WaitForWrites() const;
+
+    //! Memory of the queued and in-flight batches, part of the coins cache budget (-dbcache)
+    size_t DynamicMemoryUsage() const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -127,6 +219,9 @@ private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
 
+    //! Read and check the block index entries whose hash starts with the byte nShard
+    bool LoadBlockIndexShard(int nShard, std::vector<std::pair<uint256, CDiskBlockIndex>>& vEntries);
+
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
@@ -140,7 +235,7 @@ public:
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
     bool ReadInt(const std::string& name, int& nValue);
-    bool LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    bool LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 1);
     bool ReadLegacyBlockIndex(const uint256& blockHash, CLegacyBlockIndex& biRet);
 };
 
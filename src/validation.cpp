@@ -18,6 +18,8 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinsprefetch.h"
+#include "coinstats.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
@@ -54,6 +56,7 @@
 #include <boost/thread.hpp>
 #include <atomic>
 #include <queue>
+#include <thread>
 
 
 #if defined(NDEBUG)
@@ -78,6 +81,8 @@
 RecursiveMutex cs_main;
 
 BlockMap mapBlockIndex;
+// Storage of the entries of mapBlockIndex
+static CBlockIndexArena blockIndexArena;
 CChain chainActive;
 CBlockIndex* pindexBestHeader = NULL;
 
@@ -108,8 +113,6 @@ CTxMemPool mempool(::minRelayTxFee);
 
 std::map<uint256, int64_t> mapRejectedBlocks;
 
-CMoneySupply MoneySupply;
-
 static void CheckBlockIndex();
 
 /** Constant stuff for coinbase transactions we create: */
@@ -202,6 +205,8 @@ CBlockIndex* GetChainTip()
 }
 
 CCoinsViewCache* pcoinsTip = NULL;
+CCoinsViewBackgroundWriter* pcoinsWriter = nullptr;
+CCoinsViewPrefetch* pcoinsPrefetch = nullptr;
 CBlockTreeDB* pblocktree = NULL;
 CSporkDB* pSporkDB = NULL;
 
@@ -740,6 +745,41 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos)
+{
+    // The block is preceded by the network magic and its size, see WriteBlockToDisk
+    const unsigned int nHeaderSize = MESSAGE_START_SIZE + sizeof(unsigned int);
+    if (pos.nPos < nHeaderSize)
+        return error("%s : invalid block position (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - nHeaderSize);
+
+    // Open history file to read
+    CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed", __func__);
+
+    try {
+        CMessageHeader::MessageStartChars pchMessageStart;
+        unsigned int nSize;
+        filein >> FLATDATA(pchMessageStart) >> nSize;
+        if (memcmp(pchMessageStart, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+            return error("%s : block magic mismatch (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+        if (nSize > MAX_BLOCK_SIZE_CURRENT)
+            return error("%s : block size %u too large (file %d, pos %u)", __func__, nSize, pos.nFile, pos.nPos);
+        vchBlock.resize(nSize);
+        filein.read((char*)vchBlock.data(), nSize);
+    } catch (const std::exception& e) {
+        return error("%s : I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CBlockIndex* pindex)
+{
+    return ReadRawBlockFromDisk(vchBlock, pindex->GetBlockPos());
+}
+
 
 double ConvertBitsToDouble(unsigned int nBits)
 {
@@ -1042,6 +1082,13 @@ bool CScriptCheck::operator()()
     return VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, amount, cacheStore, *precomTxData), ptxTo->GetRequiredSigVersion(), &error);
 }
 
+bool CSaplingCheck::operator()()
+{
+    // The rejection reason is recovered by ConnectBlock, if needed.
+    CValidationState state;
+    return SaplingValidation::CheckProofsAndSignatures(*ptx, state, 100, cacheStore);
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1164,8 +1211,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     return true;
 }
 
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+bool AbortNode(const std::string& strMessage, const std::string& userMessage)
 {
     SetMiscWarning(strMessage);
     LogPrintf("*** %s\n", strMessage);
@@ -1238,6 +1284,37 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
 
 } // anon namespace
 
+bool ReadBlockUndoFromDisk(CBlockUndo& blockundo, const CBlock& block, const CBlockIndex* pindex)
+{
+    blockundo.vtxundo.clear();
+    // The genesis block spends nothing
+    if (!pindex->pprev) {
+        return true;
+    }
+    const CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        return error("%s: no undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (!UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash())) {
+        return false;
+    }
+    // There is no undo data for the coinbase
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block %s and undo data inconsistent", __func__, pindex->GetBlockHash().ToString());
+    }
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        if (blockundo.vtxundo[i - 1].vprevout.size() != block.vtx[i]->vin.size()) {
+            return error("%s: tx %s and undo data inconsistent", __func__, block.vtx[i]->GetHash().ToString());
+        }
+    }
+    return true;
+}
+
+bool ReadBlockWithUndoFromDisk(CBlock& block, CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    return ReadBlockFromDisk(block, pindex) && ReadBlockUndoFromDisk(blockundo, block, pindex);
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1282,8 +1359,9 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  If pstats is given, the spent and restored coins are applied to it too. */
+DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CUTXOStatsAccumulator* pstats = nullptr)
 {
     AssertLockHeld(cs_main);
     bool fClean = true;
@@ -1323,6 +1401,9 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
                 if (tx.vout[o] != coin.out) {
                     fClean = false; // transaction output mismatch
                 }
+                if (pstats && !coin.IsSpent()) {
+                    pstats->RemoveCoin(out, coin);
+                }
             }
         }
 
@@ -1345,6 +1426,10 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
             int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
             if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
             fClean = fClean && res != DISCONNECT_UNCLEAN;
+            if (pstats) {
+                // with the metadata ApplyTxInUndo may have filled in
+                pstats->AddCoin(out, view.AccessCoin(out));
+            }
         }
         // At this point, all of txundo.vprevout should have been moved out.
     }
@@ -1393,7 +1478,7 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CBlockCheck> scriptcheckqueue(128);
 
 void ThreadScriptCheck()
 {
@@ -1409,8 +1494,9 @@ static int64_t nTimeTotal = 0;
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
- *  can fail if those validity checks fail (among other reasons). */
-static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false)
+ *  can fail if those validity checks fail (among other reasons).
+ *  If pstats is given, the spent and created coins are applied to it too. */
+static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false, CUTXOStatsAccumulator* pstats = nullptr)
 {
     AssertLockHeld(cs_main);
     // Check it again in case a previous version let a bad block in
@@ -1473,11 +1559,15 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         fCLTVIsActivated = consensus.NetworkUpgradeActive(pindex->pprev->nHeight, Consensus::UPGRADE_BIP65);
     }
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    // Sapling proofs are verified regardless of fScriptChecks, so the queue is used for them as well
+    CCheckQueueControl<CBlockCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
     int64_t nTimeStart = GetTimeMicros();
+    uint64_t nPrefetchHits = 0, nPrefetchMisses = 0;
+    if (pcoinsPrefetch) pcoinsPrefetch->GetCounters(nPrefetchHits, nPrefetchMisses);
     CAmount nFees = 0;
     int nInputs = 0;
+    int nShieldedTxs = 0;
     unsigned int nSigOps = 0;
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
@@ -1550,7 +1640,22 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : NULL))
                 return error("%s: Check inputs on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
-            control.Add(vChecks);
+            std::vector<CBlockCheck> vBlockChecks;
+            vBlockChecks.reserve(vChecks.size() + 1);
+            for (CScriptCheck& check : vChecks)
+                vBlockChecks.emplace_back(check);
+
+            // Sapling: verify zk-proofs and signatures (deferred from ContextualCheckBlock)
+            if (isV5UpgradeEnforced && tx.IsShieldedTx()) {
+                nShieldedTxs++;
+                CSaplingCheck saplingCheck(tx, fCacheResults);
+                if (nScriptCheckThreads) {
+                    vBlockChecks.emplace_back(saplingCheck);
+                } else if (!SaplingValidation::CheckProofsAndSignatures(tx, state, 100, fCacheResults)) {
+                    return error("%s: Sapling checks on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+                }
+            }
+            control.Add(vBlockChecks);
         }
         nValueOut += tx.GetValueOut();
 
@@ -1560,6 +1665,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
         const bool fSkipInvalid = false;
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, fSkipInvalid);
+        if (pstats) {
+            pstats->ConnectTx(tx, i == 0 ? nullptr : &blockundo.vtxundo.back(), pindex->nHeight);
+        }
 
         // Sapling update tree
         if (tx.IsShieldedTx() && !tx.sapData->vShieldedOutput.empty()) {
@@ -1592,6 +1700,15 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     int64_t nTime1 = GetTimeMicros();
     nTimeConnect += nTime1 - nTimeStart;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001);
+    if (pcoinsPrefetch) {
+        // Coin lookups which missed the coins cache
+        uint64_t nHits, nMisses;
+        pcoinsPrefetch->GetCounters(nHits, nMisses);
+        const uint64_t nBlockHits = nHits - nPrefetchHits;
+        const uint64_t nBlockLookups = nBlockHits + nMisses - nPrefetchMisses;
+        LogPrint(BCLog::BENCH, "      - Prefetched coins: %u/%u (%.1f%%) [%.1f%%]\n", nBlockHits, nBlockLookups,
+                 nBlockLookups ? 100.0 * nBlockHits / nBlockLookups : 0.0, (nHits + nMisses) ? 100.0 * nHits / (nHits + nMisses) : 0.0);
+    }
 
     //PoW phase redistributed fees to miner. PoS stage destroys fees.
     CAmount nExpectedMint = GetBlockValue(pindex->nHeight);
@@ -1613,11 +1730,20 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
     }
 
-    if (!control.Wait())
+    if (!control.Wait()) {
+        // The queue only reports a failure: re-check the shielded txs one by one
+        // to find out whether (and which) Sapling verification failed.
+        if (nScriptCheckThreads && nShieldedTxs > 0) {
+            for (const auto& tx : block.vtx) {
+                if (tx->IsShieldedTx() && !SaplingValidation::CheckProofsAndSignatures(*tx, state, 100, fJustCheck))
+                    return error("%s: Sapling checks on %s failed with %s", __func__, tx->GetHash().ToString(), FormatStateMessage(state));
+            }
+        }
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    }
     int64_t nTime2 = GetTimeMicros();
     nTimeVerify += nTime2 - nTimeStart;
-    LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs - 1), nTimeVerify * 0.000001);
+    LogPrint(BCLog::BENCH, "    - Verify %u txins, %d shielded txs: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, nShieldedTxs, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs - 1), nTimeVerify * 0.000001);
 
     //IMPORTANT NOTE: Nothing before this point should actually store to disk (or even memory)
     if (fJustCheck)
@@ -1664,7 +1790,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
  * Update the on-disk chain state.
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
  * fast is not set and it's been a while since the last write.
- * Full flush also updates the money supply from disk (except during shutdown)
  */
 bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
 {
@@ -1686,6 +1811,15 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             nLastSetChain = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+        if (pcoinsWriter && mode != FLUSH_STATE_NONE) {
+            // The batches of the background writer are part of the coins cache budget:
+            // when they take it over, let them be written rather than flushing a new one
+            const int64_t nWriterUsage = pcoinsWriter->DynamicMemoryUsage();
+            if (nWriterUsage > 0 && pcoinsTip->DynamicMemoryUsage() + nWriterUsage > (int64_t)nCoinCacheUsage &&
+                    !pcoinsWriter->WaitForWrites()) {
+                return AbortNode(state, "Failed to write to coin database");
+            }
+        }
         int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now
@@ -1739,13 +1873,27 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            if (pcoinsWriter && fPeriodicFlush && !fCacheLarge && !fCacheCritical) {
+                // Hand the modified coins to the background writer and keep
+                // the cache warm. A large cache is flushed (still written in
+                // the background) to make room.
+                if (!pcoinsTip->Sync())
+                    return AbortNode(state, "Failed to write to coin database");
+            } else {
+                if (!pcoinsTip->Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+                // Return the memory of the cache entries to the system when
+                // the cache outgrew its budget, the pool only ever reuses it.
+                if (fCacheCritical || fCacheLarge)
+                    pcoinsTip->ReallocateCache();
+            }
+            if (pcoinsWriter && mode == FLUSH_STATE_ALWAYS && !pcoinsWriter->WaitForWrites())
                 return AbortNode(state, "Failed to write to coin database");
+            // The UTXO set statistics follow the chainstate on disk (a crash
+            // before a background write completes makes them rebuilt at start)
+            if (putxostats && !putxostats->Flush())
+                return AbortNode(state, "Failed to write to UTXO set statistics database");
             nLastFlush = nNow;
-            // Update money supply on memory, reading data from disk
-            if (!ShutdownRequested() && !IsInitialBlockDownload()) {
-                MoneySupply.Update(pcoinsTip->GetTotalAmount(), chainActive.Height());
-            }
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
             // Update best block in wallet (so we can detect restored wallets).
@@ -1829,9 +1977,12 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     {
         CCoinsViewCache view(pcoinsTip);
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        CUTXOStatsAccumulator utxostats;
+        if (putxostats) utxostats = putxostats->GetTip();
+        if (DisconnectBlock(block, pindexDelete, view, putxostats ? &utxostats : nullptr) != DISCONNECT_OK)
             return error("DisconnectTip() : DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
+        if (putxostats) putxostats->SetTip(utxostats, pindexDelete->pprev, false);
     }
     LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     const uint256& saplingAnchorAfterDisconnect = pcoinsTip->GetBestAnchor();
@@ -1980,7 +2131,9 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, false);
+        CUTXOStatsAccumulator utxostats;
+        if (putxostats) utxostats = putxostats->GetTip();
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, false, putxostats ? &utxostats : nullptr);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -1991,6 +2144,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
         nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         assert(view.Flush());
+        if (putxostats) putxostats->SetTip(utxostats, pindexNew, true);
     }
     int64_t nTime4 = GetTimeMicros();
     nTimeFlush += nTime4 - nTime3;
@@ -2133,6 +2287,8 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
+            // Warm up the coins of the next blocks while this one connects
+            if (pcoinsPrefetch) pcoinsPrefetch->Prefetch(pindexConnect, pindexMostWork);
             if (!ConnectTip(state, pindexConnect, (pindexConnect == pindexMostWork) ? pblock : std::shared_ptr<const CBlock>(), connectTrace)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -2197,12 +2353,11 @@ bool ActivateBestChain(CValidationState& state, std::shared_ptr<const CBlock> pb
     do {
         boost::this_thread::interruption_point();
 
-        if (GetMainSignals().CallbacksPending() > 10) {
-            // Block until the validation queue drains. This should largely
-            // never happen in normal operation, however may happen during
-            // reindex, causing memory blowup  if we run too far ahead.
-            SyncWithValidationInterfaceQueue();
-        }
+        // Block until the validation queue drains if the subscribers lag
+        // behind. This should largely never happen in normal operation,
+        // however may happen during reindex, causing memory blowup if we run
+        // too far ahead.
+        LimitValidationInterfaceQueue();
 
         {
             LOCK(cs_main);
@@ -2355,8 +2510,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Create(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -2604,7 +2758,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!IsPoS && fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits))
+    if (!IsPoS && fCheckPOW && !block.fCheckedIntegrity && !CheckProofOfWork(block.GetHash(), block.nBits))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     // All potential-corruption validation must be done before we do any
@@ -2612,7 +2766,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     // because we receive the wrong transactions for it.
 
     // Check the merkle root.
-    if (fCheckMerkleRoot) {
+    if (fCheckMerkleRoot && !block.fCheckedIntegrity) {
         bool mutated;
         uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
@@ -2713,7 +2867,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
             REJECT_INVALID, "bad-blk-sigops", true);
 
     // Check PoS signature.
-    if (fCheckSig && !CheckBlockSignature(block)) {
+    if (fCheckSig && !block.fCheckedIntegrity && !CheckBlockSignature(block)) {
         return state.DoS(100, error("%s : bad proof-of-stake block signature", __func__),
                          REJECT_INVALID, "bad-PoS-sig", true);
     }
@@ -2724,6 +2878,22 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     return true;
 }
 
+bool CheckBlockIntegrity(const CBlock& block)
+{
+    if (block.fCheckedIntegrity)
+        return true;
+    // The failures are reported by CheckBlock, which repeats the checks that did not pass
+    if (block.IsProofOfWork() && !CheckProofOfWork(block.GetHash(), block.nBits))
+        return false;
+    bool mutated;
+    if (block.vtx.empty() || block.hashMerkleRoot != BlockMerkleRoot(block, &mutated) || mutated)
+        return false;
+    if (!CheckBlockSignature(block))
+        return false;
+    block.fCheckedIntegrity = true;
+    return true;
+}
+
 bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev)
 {
     if (pindexPrev == NULL)
@@ -2853,8 +3023,9 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     // Check that all transactions are finalized
     for (const auto& tx : block.vtx) {
 
-        // Sapling: Check transaction contextually against consensus rules at block height
-        if (!SaplingValidation::ContextualCheckTransaction(*tx, state, chainparams, nHeight, true, IsInitialBlockDownload())) {
+        // Sapling: Check transaction contextually against consensus rules at block height.
+        // Proofs and signatures are verified later on, by ConnectBlock.
+        if (!SaplingValidation::ContextualCheckTransaction(*tx, state, chainparams, nHeight, true, IsInitialBlockDownload(), false)) {
             return false; // Failure reason has been set in validation state object
         }
 
@@ -2943,6 +3114,23 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
     return true;
 }
 
+bool TestBlockHeader(const CBlock& block, CValidationState& state)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexPrev = nullptr;
+    if (!GetPrevIndex(block, &pindexPrev, state))
+        return false;
+
+    if (pindexPrev && !CheckWork(block, pindexPrev))
+        return state.DoS(50, error("%s : incorrect difficulty for block %s", __func__, block.GetHash().ToString()), REJECT_INVALID, "bad-diffbits");
+
+    // A header already known as invalid is rejected by the caller, which looks it up first
+    if (!ContextualCheckBlockHeader(block, state, pindexPrev))
+        return error("%s: ContextualCheckBlockHeader failed for block %s: %s", __func__, block.GetHash().ToString(), FormatStateMessage(state));
+
+    return true;
+}
+
 bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppindex, CDiskBlockPos* dbp)
 {
     AssertLockHeld(cs_main);
@@ -3236,9 +3424,7 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Create();
     mi = mapBlockIndex.emplace(hash, pindexNew).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -3248,10 +3434,14 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB(std::string& strError)
 {
-    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
+    const int nThreads = std::max(1, GetNumCores());
+    int64_t nTime0 = GetTimeMicros();
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, nThreads))
         return false;
 
     boost::this_thread::interruption_point();
+    int64_t nTime1 = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "%s: load block index entries: %.2fms\n", __func__, (nTime1 - nTime0) * 0.001);
 
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
@@ -3261,12 +3451,36 @@ bool static LoadBlockIndexDB(std::string& strError)
         vSortedByHeight.emplace_back(pindex->nHeight, pindex);
     }
     std::sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight) {
+    int64_t nTime2 = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "%s: sort %u entries by height: %.2fms\n", __func__, vSortedByHeight.size(), (nTime2 - nTime1) * 0.001);
+
+    // The block proofs don't depend on each other: calculate them in parallel, then
+    // accumulate them (and link the skip list) in height order.
+    const size_t nEntries = vSortedByHeight.size();
+    std::vector<arith_uint256> vBlockProofs(nEntries);
+    {
+        const size_t nChunk = (nEntries + nThreads - 1) / nThreads;
+        auto calculate = [&vSortedByHeight, &vBlockProofs](size_t nBegin, size_t nEnd) {
+            for (size_t i = nBegin; i < nEnd; i++) {
+                vBlockProofs[i] = GetBlockProof(*vSortedByHeight[i].second);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t nBegin = nChunk; nBegin < nEntries; nBegin += nChunk) {
+            threads.emplace_back(calculate, nBegin, std::min(nBegin + nChunk, nEntries));
+        }
+        calculate(0, std::min(nChunk, nEntries));
+        for (std::thread& t : threads) t.join();
+    }
+    int64_t nTime3 = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "%s: block proofs: %.2fms (%d threads)\n", __func__, (nTime3 - nTime2) * 0.001, nThreads);
+
+    for (size_t i = 0; i < nEntries; i++) {
         // Stop if shutdown was requested
         if (ShutdownRequested()) return false;
 
-        CBlockIndex* pindex = item.second;
-        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        CBlockIndex* pindex = vSortedByHeight[i].second;
+        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + vBlockProofs[i];
         if (pindex->nStatus & BLOCK_HAVE_DATA) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
@@ -3297,6 +3511,8 @@ bool static LoadBlockIndexDB(std::string& strError)
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
+    int64_t nTime4 = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "%s: chain work and skip list: %.2fms\n", __func__, (nTime4 - nTime3) * 0.001);
 
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
@@ -3348,6 +3564,20 @@ bool static LoadBlockIndexDB(std::string& strError)
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
+    LogPrint(BCLog::BENCH, "%s: block files and flags: %.2fms\n", __func__, (GetTimeMicros() - nTime4) * 0.001);
+
+    // Memory report, compared with the previous layout (one heap allocation for each entry and for its stake modifier)
+    const size_t nMapUsage = memusage::DynamicUsage(mapBlockIndex);
+    const size_t nArenaUsage = blockIndexArena.DynamicMemoryUsage();
+    size_t nLegacyUsage = nMapUsage;
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+        const size_t nModifierSize = item.second->stakeModifier.size();
+        nLegacyUsage += memusage::MallocUsage(sizeof(CBlockIndex) - sizeof(CStakeModifier) + sizeof(std::vector<unsigned char>)) +
+                        (nModifierSize ? memusage::MallocUsage(nModifierSize) : 0);
+    }
+    LogPrintf("%s: block index memory usage %.1fMiB (entries %.1fMiB, map %.1fMiB), %.1fMiB with per-entry allocations\n", __func__,
+              (nArenaUsage + nMapUsage) / 1048576.0, nArenaUsage / 1048576.0, nMapUsage / 1048576.0, nLegacyUsage / 1048576.0);
+    LogPrintf("%s: loaded %u block index entries in %.2fs\n", __func__, nEntries, (GetTimeMicros() - nTime0) * 0.000001);
     return true;
 }
 
@@ -3587,10 +3817,8 @@ void UnloadBlockIndex()
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
 }
 
 bool LoadBlockIndex(std::string& strError)
@@ -21,7 +21,6 @@
 #include "coins.h"
 #include "consensus/validation.h"
 #include "fs.h"
-#include "moneysupply.h"
 #include "policy/feerate.h"
 #include "script/script_error.h"
 #include "sync.h"
@@ -38,9 +37,12 @@
 #include <utility>
 #include <vector>
 
+class CBlockUndo;
 class CBlockIndex;
 class CBlockTreeDB;
 class CBudgetManager;
+class CCoinsViewBackgroundWriter;
+class CCoinsViewPrefetch;
 class CSporkDB;
 class CBloomFilter;
 class CInv;
@@ -150,8 +152,6 @@ extern bool fLargeWorkInvalidChainFound;
 
 extern std::map<uint256, int64_t> mapRejectedBlocks;
 
-extern CMoneySupply MoneySupply;
-
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex* pindexBestHeader;
 
@@ -181,6 +181,8 @@ FILE* OpenUndoFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const CDiskBlockPos& pos, const char* prefix);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp = NULL);
+/** Abort with a message: log it, show it to the user and shut down */
+bool AbortNode(const std::string& strMessage, const std::string& userMessage = "");
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock();
 /** Load the block tree and coins database from disk,
@@ -314,17 +316,84 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the verification of the Sapling zk-proofs and signatures
+ * of one shielded transaction.
+ * Note that this stores a reference to the transaction
+ */
+class CSaplingCheck
+{
+private:
+    const CTransaction* ptx;
+    bool cacheStore;
+
+public:
+    CSaplingCheck() : ptx(nullptr), cacheStore(false) {}
+    CSaplingCheck(const CTransaction& txIn, bool cacheIn) : ptx(&txIn), cacheStore(cacheIn) {}
+
+    bool operator()();
+
+    void swap(CSaplingCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(cacheStore, check.cacheStore);
+    }
+};
+
+/**
+ * Element of the block verification queue: either a script check or a Sapling check,
+ * so that a block's inputs and shielded proofs are verified by the same worker threads.
+ */
+class CBlockCheck
+{
+private:
+    CScriptCheck scriptCheck;
+    CSaplingCheck saplingCheck;
+    bool fSapling;
+
+public:
+    CBlockCheck() : fSapling(false) {}
+    explicit CBlockCheck(CScriptCheck& check) : fSapling(false) { scriptCheck.swap(check); }
+    explicit CBlockCheck(CSaplingCheck& check) : fSapling(true) { saplingCheck.swap(check); }
+
+    bool operator()() { return fSapling ? saplingCheck() : scriptCheck(); }
+
+    void swap(CBlockCheck& check)
+    {
+        scriptCheck.swap(check.scriptCheck);
+        saplingCheck.swap(check.saplingCheck);
+        std::swap(fSapling, check.fSapling);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/**
+ * Read the undo data of a block: blockundo.vtxundo[i - 1].vprevout[j] is the coin (value,
+ * script, height) spent by block.vtx[i]->vin[j], so that the inputs of the block can be
+ * valued in one sequential read instead of a txindex lookup per input.
+ */
+bool ReadBlockUndoFromDisk(CBlockUndo& blockundo, const CBlock& block, const CBlockIndex* pindex);
+/** Read a block along with its undo data (see ReadBlockUndoFromDisk) */
+bool ReadBlockWithUndoFromDisk(CBlock& block, CBlockUndo& blockundo, const CBlockIndex* pindex);
+/** Read the serialized block as stored on disk (identical to its network serialization) */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos);
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CBlockIndex* pindex);
 
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
+/**
+ * The expensive checks of CheckBlock that need neither the chain nor cs_main:
+ * proof of work, merkle root and block signature. Can run from any thread
+ * before the block is processed, CheckBlock then skips them if they passed.
+ */
+bool CheckBlockIntegrity(const CBlock& block);
 bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
@@ -337,6 +406,11 @@ bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex
 /** Store block on disk. If dbp is provided, the file is known to already reside on disk */
 bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** pindex, CDiskBlockPos* dbp = NULL);
 bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex = nullptr, CBlockIndex* pindexPrev = nullptr);
+/**
+ * Check the header of a block received ahead of its transactions (compact block) like AcceptBlockHeader,
+ * plus its difficulty, without adding it to the block index (with cs_main held)
+ */
+bool TestBlockHeader(const CBlock& block, CValidationState& state);
 
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
@@ -366,6 +440,12 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache* pcoinsTip;
 
+/** Background writer of the coin database, with -backgroundflush (protected by cs_main) */
+extern CCoinsViewBackgroundWriter* pcoinsWriter;
+
+/** Coins prefetcher of the blocks ahead, with -prefetchthreads (protected by cs_main) */
+extern CCoinsViewPrefetch* pcoinsPrefetch;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB* pblocktree;
 
@@ -8,14 +8,56 @@
 #include "validationinterface.h"
 #include "scheduler.h"
 #include "txmempool.h"
+#include "utiltime.h"
 #include "validation.h"
 
+#include <atomic>
 #include <future>
 #include <list>
 #include <unordered_map>
 #include <boost/signals2/signal.hpp>
 
+/** Callback time of a subscriber, shared with its connected slots */
+struct SubscriberStats {
+    std::string name;
+    std::atomic<uint64_t> nCalls{0};
+    std::atomic<int64_t> nTimeMicros{0};
+    std::atomic<int64_t> nMaxTimeMicros{0};
+
+    explicit SubscriberStats(const std::string& strName) : name(strName) {}
+
+    void Add(int64_t nMicros)
+    {
+        nCalls++;
+        nTimeMicros += nMicros;
+        int64_t nMax = nMaxTimeMicros;
+        while (nMicros > nMax && !nMaxTimeMicros.compare_exchange_weak(nMax, nMicros)) {}
+    }
+};
+
+/** Slot calling f and adding the time it took to the stats of its subscriber */
+template <typename F>
+struct TimedSlot {
+    F f;
+    std::shared_ptr<SubscriberStats> stats;
+
+    template <typename... Args>
+    void operator()(Args&&... args) const
+    {
+        const int64_t nStart = GetTimeMicros();
+        f(std::forward<Args>(args)...);
+        stats->Add(GetTimeMicros() - nStart);
+    }
+};
+
+template <typename F>
+static TimedSlot<F> MakeTimedSlot(F f, const std::shared_ptr<SubscriberStats>& stats)
+{
+    return TimedSlot<F>{std::move(f), stats};
+}
+
 struct ValidationInterfaceConnections {
+    std::shared_ptr<SubscriberStats> stats;
     boost::signals2::scoped_connection UpdatedBlockTip;
     boost::signals2::scoped_connection TransactionAddedToMempool;
     boost::signals2::scoped_connection BlockConnected;
@@ -48,6 +90,8 @@ struct MainSignalsInstance {
     /** Notifies listeners of a block validation result */
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
 
+    //! Subscribers may be registered by RPC threads (submitblock) while getvalidationqueueinfo reads them
+    RecursiveMutex m_cs_conns;
     std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
     // We are not allowed to assume the scheduler only runs in one thread,
@@ -55,7 +99,28 @@ struct MainSignalsInstance {
     // our own queue here :(
     SingleThreadedSchedulerClient m_schedulerClient;
 
+    std::atomic<size_t> m_limit{DEFAULT_VALIDATION_QUEUE_LIMIT};
+    std::atomic<size_t> m_max_pending{0};
+    std::atomic<uint64_t> m_callbacks{0};
+    std::atomic<int64_t> m_queue_delay_micros{0};
+    std::atomic<uint64_t> m_limit_waits{0};
+    std::atomic<int64_t> m_limit_wait_micros{0};
+
     explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+
+    /** Add func to the queue, keeping track of the queue depth and of the time func waits in it */
+    void Enqueue(std::function<void ()> func)
+    {
+        const int64_t nQueued = GetTimeMicros();
+        m_schedulerClient.AddToProcessQueue([this, func, nQueued] {
+            m_callbacks++;
+            m_queue_delay_micros += GetTimeMicros() - nQueued;
+            func();
+        });
+        const size_t nPending = m_schedulerClient.CallbacksPending();
+        size_t nMax = m_max_pending;
+        while (nPending > nMax && !m_max_pending.compare_exchange_weak(nMax, nPending)) {}
+    }
 };
 
 static CMainSignals g_signals;
@@ -80,6 +145,35 @@ size_t CMainSignals::CallbacksPending() {
     return m_internals->m_schedulerClient.CallbacksPending();
 }
 
+void CMainSignals::SetQueueLimit(size_t nLimit) {
+    if (m_internals) {
+        m_internals->m_limit = nLimit;
+    }
+}
+
+ValidationQueueInfo CMainSignals::GetQueueInfo() {
+    ValidationQueueInfo info;
+    if (!m_internals) return info;
+    info.nPending = m_internals->m_schedulerClient.CallbacksPending();
+    info.nMaxPending = m_internals->m_max_pending;
+    info.nLimit = m_internals->m_limit;
+    info.nCallbacks = m_internals->m_callbacks;
+    info.nQueueDelayMicros = m_internals->m_queue_delay_micros;
+    info.nLimitWaits = m_internals->m_limit_waits;
+    info.nLimitWaitMicros = m_internals->m_limit_wait_micros;
+    LOCK(m_internals->m_cs_conns);
+    for (const auto& it : m_internals->m_connMainSignals) {
+        const SubscriberStats& stats = *it.second.stats;
+        ValidationSubscriberInfo sub;
+        sub.name = stats.name;
+        sub.nCalls = stats.nCalls;
+        sub.nTimeMicros = stats.nTimeMicros;
+        sub.nMaxTimeMicros = stats.nMaxTimeMicros;
+        info.vSubscribers.push_back(sub);
+    }
+    return info;
+}
+
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
     pool.NotifyEntryRemoved.connect(std::bind(&CMainSignals::MempoolEntryRemoved, this, std::placeholders::_1, std::placeholders::_2));
 }
@@ -93,15 +187,18 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn)
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strName)
 {
+    LOCK(g_signals.m_internals->m_cs_conns);
     ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1));
-    conns.SetBestChain = g_signals.m_internals->SetBestChain.connect(std::bind(&CValidationInterface::SetBestChain, pwalletIn, std::placeholders::_1));
+    conns.stats = std::make_shared<SubscriberStats>(strName);
+    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(MakeTimedSlot(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), conns.stats));
+    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(MakeTimedSlot(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1), conns.stats));
+    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(MakeTimedSlot(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), conns.stats));
+    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(MakeTimedSlot(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4), conns.stats));
+    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(MakeTimedSlot(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1), conns.stats));
+    conns.SetBestChain = g_signals.m_internals->SetBestChain.connect(MakeTimedSlot(std::bind(&CValidationInterface::SetBestChain, pwalletIn, std::placeholders::_1), conns.stats));
+    // Broadcast and BlockChecked are called synchronously, they are not counted
     conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1));
     conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
 }
@@ -109,6 +206,7 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn)
 void UnregisterValidationInterface(CValidationInterface* pwalletIn)
 {
     if (g_signals.m_internals) {
+        LOCK(g_signals.m_internals->m_cs_conns);
         g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
     }
 }
@@ -118,11 +216,12 @@ void UnregisterAllValidationInterfaces()
     if (!g_signals.m_internals) {
         return;
     }
+    LOCK(g_signals.m_internals->m_cs_conns);
     g_signals.m_internals->m_connMainSignals.clear();
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->Enqueue(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -138,9 +237,17 @@ void SyncWithValidationInterfaceQueue() {
     promise.get_future().wait();
 }
 
+void LimitValidationInterfaceQueue() {
+    if (!g_signals.m_internals || g_signals.CallbacksPending() <= g_signals.m_internals->m_limit) return;
+    const int64_t nStart = GetTimeMicros();
+    SyncWithValidationInterfaceQueue();
+    g_signals.m_internals->m_limit_waits++;
+    g_signals.m_internals->m_limit_wait_micros += GetTimeMicros() - nStart;
+}
+
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
+        m_internals->Enqueue([ptx, this] {
             m_internals->TransactionRemovedFromMempool(ptx);
         });
     }
@@ -151,31 +258,31 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
+    m_internals->Enqueue([pindexNew, pindexFork, fInitialDownload, this] {
         m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
+    m_internals->Enqueue([ptx, this] {
         m_internals->TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
+    m_internals->Enqueue([pblock, pindex, pvtxConflicted, this] {
         m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, blockHash, nBlockHeight, blockTime, this] {
+    m_internals->Enqueue([pblock, blockHash, nBlockHeight, blockTime, this] {
         m_internals->BlockDisconnected(pblock, blockHash, nBlockHeight, blockTime);
     });
 }
 
 void CMainSignals::SetBestChain(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
+    m_internals->Enqueue([locator, this] {
         m_internals->SetBestChain(locator);
     });
 }
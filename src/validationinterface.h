@@ -14,6 +14,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 class CBlock;
 struct CBlockLocator;
@@ -26,10 +28,13 @@ class CScheduler;
 class CTxMemPool;
 enum class MemPoolRemovalReason;
 
+/** Default for -maxvalidationqueue */
+static const unsigned int DEFAULT_VALIDATION_QUEUE_LIMIT = 10;
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/** Register a wallet to receive updates from core. strName identifies it in getvalidationqueueinfo. */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& strName = "other");
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -54,6 +59,39 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  *     promise.get_future().wait();
  */
 void SyncWithValidationInterfaceQueue();
+/**
+ * Back-pressure for the producers of notifications: wait for the queue to
+ * drain if more than the -maxvalidationqueue callbacks are pending, so that
+ * slow subscribers (wallet, ZMQ) hold up block connection instead of letting
+ * the queue grow without bound. Only called from ActivateBestChain: the
+ * message handler thread must not block on the subscribers.
+ * Same lock requirements as SyncWithValidationInterfaceQueue.
+ */
+void LimitValidationInterfaceQueue();
+
+/** Time spent by a subscriber in its callbacks */
+struct ValidationSubscriberInfo
+{
+    std::string name;
+    uint64_t nCalls{0};
+    int64_t nTimeMicros{0};
+    int64_t nMaxTimeMicros{0};
+};
+
+/** State of the notification queue */
+struct ValidationQueueInfo
+{
+    size_t nPending{0};
+    size_t nMaxPending{0};
+    size_t nLimit{0};
+    //! Callbacks run, and the total time they waited in the queue
+    uint64_t nCallbacks{0};
+    int64_t nQueueDelayMicros{0};
+    //! Waits of LimitValidationInterfaceQueue, and their total time
+    uint64_t nLimitWaits{0};
+    int64_t nLimitWaitMicros{0};
+    std::vector<ValidationSubscriberInfo> vSubscribers;
+};
 
 /**
  * Implement this to subscribe to events generated in validation
@@ -123,7 +161,7 @@ protected:
     /** Tells listeners to broadcast their data. */
     virtual void ResendWalletTransactions(CConnman* connman) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
@@ -135,10 +173,11 @@ private:
 
     void MempoolEntryRemoved(CTransactionRef tx, MemPoolRemovalReason reason);
 
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::LimitValidationInterfaceQueue();
 
 public:
     /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
@@ -149,6 +188,9 @@ public:
     void FlushBackgroundCallbacks();
 
     size_t CallbacksPending();
+    /** Set the number of pending callbacks above which LimitValidationInterfaceQueue waits */
+    void SetQueueLimit(size_t nLimit);
+    ValidationQueueInfo GetQueueInfo();
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
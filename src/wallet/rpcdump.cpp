@@ -80,6 +80,15 @@ bool IsStakingDerPath(KeyOriginInfo keyOrigin)
     return keyOrigin.path.size() > 3 && keyOrigin.path[3] == (2 | BIP32_HARDENED_KEY_LIMIT);
 }
 
+static void RescanWallet(CBlockIndex* pindexStart, bool fUpdate)
+{
+    if (pwalletMain->ScanForWalletTransactions(pindexStart, fUpdate) == -1) {
+        if (pwalletMain->IsAbortingRescan())
+            throw JSONRPCError(RPC_MISC_ERROR, "Rescan aborted by user.");
+        throw JSONRPCError(RPC_WALLET_ERROR, "Rescan failed: unable to read a block from disk.");
+    }
+}
+
 UniValue importprivkey(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 4)
@@ -145,7 +154,7 @@ UniValue importprivkey(const JSONRPCRequest& request)
                 // cold staking was activated after nBlockTimeProtocolV2 (C_Note v4.0). No need to scan the whole chain
                 pindex = chainActive[Params().GetConsensus().vUpgrades[Consensus::UPGRADE_V4_0].nActivationHeight];
             }
-            pwalletMain->ScanForWalletTransactions(pindex, true);
+            RescanWallet(pindex, true);
         }
     }
 
@@ -232,7 +241,7 @@ UniValue importaddress(const JSONRPCRequest& request)
     }
 
     if (fRescan) {
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        RescanWallet(chainActive.Genesis(), true);
         pwalletMain->ReacceptWalletTransactions();
     }
 
@@ -276,7 +285,7 @@ UniValue importpubkey(const JSONRPCRequest& request)
     ImportScript(GetScriptForRawPubKey(pubKey), strLabel, false);
 
     if (fRescan) {
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        RescanWallet(chainActive.Genesis(), true);
         pwalletMain->ReacceptWalletTransactions();
     }
 
@@ -400,7 +409,7 @@ UniValue importwallet(const JSONRPCRequest& request)
         pwalletMain->nTimeFirstKey = nTimeBegin;
 
     LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
-    pwalletMain->ScanForWalletTransactions(pindex);
+    RescanWallet(pindex, false);
     pwalletMain->MarkDirty();
 
     if (!fGood)
@@ -698,7 +707,7 @@ UniValue bip38decrypt(const JSONRPCRequest& request)
 
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        RescanWallet(chainActive.Genesis(), true);
     }
 
     return result;
@@ -792,7 +801,7 @@ UniValue importsaplingkey(const JSONRPCRequest& request)
 
     // We want to scan for transactions and notes
     if (fRescan) {
-        pwalletMain->ScanForWalletTransactions(chainActive[nRescanHeight], true);
+        RescanWallet(chainActive[nRescanHeight], true);
     }
 
     return result;
@@ -885,7 +894,7 @@ UniValue importsaplingviewingkey(const JSONRPCRequest& request)
 
     // We want to scan for transactions and notes
     if (fRescan) {
-        pwalletMain->ScanForWalletTransactions(chainActive[nRescanHeight], true);
+        RescanWallet(chainActive[nRescanHeight], true);
     }
 
     return result;
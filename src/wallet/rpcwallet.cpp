@@ -3120,6 +3120,29 @@ UniValue backupwallet(const JSONRPCRequest& request)
 }
 
 
+UniValue abortrescan(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "abortrescan\n"
+            "\nStops the running wallet rescan (e.g. triggered by an importprivkey call).\n"
+            "The transactions found before the abort are kept.\n"
+
+            "\nResult:\n"
+            "true|false    (boolean) Whether a rescan was running and is being stopped\n"
+
+            "\nExamples:\n"
+            "\nImport a private key\n" +
+            HelpExampleCli("importprivkey", "\"mykey\"") +
+            "\nAbort the running wallet rescan\n" +
+            HelpExampleCli("abortrescan", "") +
+            "\nAs a JSON-RPC call\n" +
+            HelpExampleRpc("abortrescan", ""));
+
+    // No lock: the rescan holds cs_main and cs_wallet
+    return pwalletMain->AbortRescan();
+}
+
 UniValue keypoolrefill(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -4206,6 +4229,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "getaddressinfo",           &getaddressinfo,           true  },
     { "wallet",             "autocombinerewards",       &autocombinerewards,       false },
     { "wallet",             "abandontransaction",       &abandontransaction,       false },
+    { "wallet",             "abortrescan",              &abortrescan,              true  },
     { "wallet",             "addmultisigaddress",       &addmultisigaddress,       true  },
     { "wallet",             "backupwallet",             &backupwallet,             true  },
     { "wallet",             "delegatestake",            &delegatestake,            false },
@@ -302,8 +302,9 @@ FakeBlock SimpleFakeMine(CWalletTx& wtx, SaplingMerkleTree& currentTree, CWallet
         currentTree.append(out.cmu);
     }
     fakeBlock.block.hashFinalSaplingRoot = currentTree.root();
-    fakeBlock.pindex = new CBlockIndex(fakeBlock.block);
-    mapBlockIndex.insert(std::make_pair(fakeBlock.block.GetHash(), fakeBlock.pindex));
+    // Allocated in the block index slabs, released with the block index
+    fakeBlock.pindex = InsertBlockIndex(fakeBlock.block.GetHash());
+    *fakeBlock.pindex = CBlockIndex(fakeBlock.block);
     fakeBlock.pindex->phashBlock = &mapBlockIndex.find(fakeBlock.block.GetHash())->first;
     chainActive.SetTip(fakeBlock.pindex);
     BOOST_CHECK(chainActive.Contains(fakeBlock.pindex));
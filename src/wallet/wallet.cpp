@@ -22,7 +22,11 @@
 #include "util.h"
 #include "utilmoneystr.h"
 
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
+#include <thread>
 #include <boost/algorithm/string/replace.hpp>
 
 CWallet* pwalletMain = nullptr;
@@ -960,6 +964,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Break debit/credit balance caches:
     wtx.MarkDirty();
 
+    // Update the stakeable coins index
+    UpdateStakeableCoins(wtx);
+
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -1030,9 +1037,13 @@ bool CWallet::LoadToWallet(CWalletTx& wtxIn)
 
 bool CWallet::FindNotesDataAndAddMissingIVKToKeystore(const CTransaction& tx, Optional<mapSaplingNoteData_t>& saplingNoteData)
 {
-    auto saplingNoteDataAndAddressesToAdd = m_sspk_man->FindMySaplingNotes(tx);
-    saplingNoteData = saplingNoteDataAndAddressesToAdd.first;
-    auto addressesToAdd = saplingNoteDataAndAddressesToAdd.second;
+    return AddMissingIVKToKeystore(m_sspk_man->FindMySaplingNotes(tx), saplingNoteData);
+}
+
+bool CWallet::AddMissingIVKToKeystore(const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNotes, Optional<mapSaplingNoteData_t>& saplingNoteData)
+{
+    saplingNoteData = saplingNotes.first;
+    const auto& addressesToAdd = saplingNotes.second;
     // Add my addresses
     for (const auto& addressToAdd : addressesToAdd) {
         if (!m_sspk_man->AddSaplingIncomingViewingKey(addressToAdd.second, addressToAdd.first)) {
@@ -1079,7 +1090,7 @@ void CWallet::AddExternalNotesDataToTx(CWalletTx& wtx) const
  * Abandoned state should probably be more carefully tracked via different
  * posInBlock signals or by checking mempool presence when necessary.
  */
-bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CWalletTx::Confirmation& confirm, bool fUpdate)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CWalletTx::Confirmation& confirm, bool fUpdate, const CWalletTxMatch* pmatch)
 {
     const CTransaction& tx = *ptx;
     {
@@ -1104,13 +1115,16 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CWallet
         // Check tx for Sapling notes
         Optional<mapSaplingNoteData_t> saplingNoteData {nullopt};
         if (HasSaplingSPKM()) {
-            if (!FindNotesDataAndAddMissingIVKToKeystore(tx, saplingNoteData)) {
+            const bool fAdded = pmatch ? AddMissingIVKToKeystore(pmatch->saplingNotes, saplingNoteData)
+                                       : FindNotesDataAndAddMissingIVKToKeystore(tx, saplingNoteData);
+            if (!fAdded) {
                 return false; // error adding incoming viewing key.
             }
         }
 
         bool isFromMe = IsFromMe(ptx);
-        if (fExisted || IsMine(ptx) || isFromMe || (saplingNoteData && !saplingNoteData->empty())) {
+        const bool fIsMine = pmatch ? pmatch->fOutputIsMine : IsMine(ptx);
+        if (fExisted || fIsMine || isFromMe || (saplingNoteData && !saplingNoteData->empty())) {
 
             /* Check if any keys in the wallet keypool that were supposed to be unused
              * have appeared in a new transaction. If so, remove those keys from the keypool.
@@ -1143,6 +1157,21 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CWallet
     return false;
 }
 
+CWalletTxMatch CWallet::MatchWalletTx(const CTransaction& tx) const
+{
+    CWalletTxMatch match;
+    for (const CTxOut& txout : tx.vout) {
+        if (IsMine(txout)) {
+            match.fOutputIsMine = true;
+            break;
+        }
+    }
+    if (HasSaplingSPKM()) {
+        match.saplingNotes = m_sspk_man->FindMySaplingNotes(tx);
+    }
+    return match;
+}
+
 bool CWallet::AbandonTransaction(const uint256& hashTx)
 {
     LOCK(cs_wallet);
@@ -1239,6 +1268,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             wtx.setConflicted();
             wtx.MarkDirty();
             walletdb.WriteTx(wtx);
+            UpdateStakeableCoins(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
             while (iter != mapTxSpends.end() && iter->first.hash == now) {
@@ -1302,6 +1332,8 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
             SyncTransaction(pblock->vtx[index], confirm);
             TransactionRemovedFromMempool(pblock->vtx[index]);
         }
+        // Link the new stakeable coins to the connected block
+        ResolveStakeableCoins(pindex);
         for (const CTransactionRef& ptx : vtxConflicted) {
             TransactionRemovedFromMempool(ptx);
         }
@@ -1411,8 +1443,13 @@ void CWallet::EraseFromWallet(const uint256& hash)
 {
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        if (mapWallet.erase(hash)) {
             CWalletDB(*dbw).EraseTx(hash);
+            // rebuild the stakeable coins index at the next StakeableCoins call
+            fStakeableCoinsLoaded = false;
+            mapStakeableCoins.clear();
+            setStakeableCoinsUnresolved.clear();
+        }
         LogPrintf("%s: Erased wtx %s from wallet\n", __func__, hash.GetHex());
     }
     return;
@@ -1800,10 +1837,131 @@ bool CWallet::Upgrade(std::string& error, const int& prevVersion)
     return true;
 }
 
+namespace {
+
+/** A block of a rescan, read from disk and matched against the keystore ahead of its turn */
+struct RescanBlock
+{
+    CBlockIndex* pindex;
+    CBlock block;
+    bool fReadError{false};
+    //! MatchWalletTx of each transaction, and the keystore version they were computed with
+    std::vector<CWalletTxMatch> vMatches;
+    unsigned int nKeyStoreVersion{0};
+
+    bool fClaimed{false};
+    bool fDone{false};
+
+    explicit RescanBlock(CBlockIndex* pindexIn) : pindex(pindexIn) {}
+};
+
+/**
+ * Worker threads reading the next blocks of a rescan and matching their
+ * transactions against the keystore (script IsMine checks and Sapling trial
+ * decryptions), while the scanning thread adds the matches of the previous
+ * blocks to the wallet, in chain order.
+ * The workers take neither cs_main nor cs_wallet: the callers of
+ * ScanForWalletTransactions usually hold them for the whole rescan.
+ */
+class RescanPipeline
+{
+public:
+    RescanPipeline(const CWallet* pwalletIn, int nThreads) : pwallet(pwalletIn)
+    {
+        for (int i = 0; i < nThreads; i++) {
+            threads.emplace_back(&RescanPipeline::ThreadWorker, this);
+        }
+    }
+
+    ~RescanPipeline()
+    {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            fStop = true;
+        }
+        condWork.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    /** Queue pindex, to be read and matched by a worker */
+    void Push(CBlockIndex* pindex)
+    {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            queue.emplace_back(new RescanBlock(pindex));
+        }
+        condWork.notify_one();
+    }
+
+    size_t Size()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        return queue.size();
+    }
+
+    /** Wait for the oldest queued block to be read and matched, and remove it from the queue (null if empty) */
+    std::unique_ptr<RescanBlock> Pop()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (queue.empty()) return nullptr;
+        condDone.wait(lock, [this] { return queue.front()->fDone; });
+        std::unique_ptr<RescanBlock> ret = std::move(queue.front());
+        queue.pop_front();
+        return ret;
+    }
+
+private:
+    const CWallet* pwallet;
+    std::mutex cs;
+    std::condition_variable condWork;
+    std::condition_variable condDone;
+    std::deque<std::unique_ptr<RescanBlock>> queue;
+    bool fStop{false};
+    std::vector<std::thread> threads;
+
+    RescanBlock* NextUnclaimed()
+    {
+        for (const auto& p : queue) {
+            if (!p->fClaimed) return p.get();
+        }
+        return nullptr;
+    }
+
+    void ThreadWorker()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        while (true) {
+            RescanBlock* p = nullptr;
+            condWork.wait(lock, [this, &p] { return fStop || (p = NextUnclaimed()) != nullptr; });
+            if (fStop) return;
+            p->fClaimed = true;
+            lock.unlock();
+            if (!ReadBlockFromDisk(p->block, p->pindex)) {
+                p->fReadError = true;
+            } else {
+                // Read first: keys added while matching make the matches stale
+                p->nKeyStoreVersion = pwallet->GetKeyStoreVersion();
+                p->vMatches.reserve(p->block.vtx.size());
+                for (const auto& tx : p->block.vtx) {
+                    p->vMatches.emplace_back(pwallet->MatchWalletTx(*tx));
+                }
+            }
+            lock.lock();
+            // Popped blocks are never claimed, p is still in the queue
+            p->fDone = true;
+            condDone.notify_all();
+        }
+    }
+};
+
+} // anon namespace
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ * The blocks are read and matched against the keystore by -rescanthreads
+ * workers, a few blocks ahead of the one added to the wallet.
  * @returns -1 if process was cancelled or the number of tx added to the wallet.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, bool fromStartup)
@@ -1811,8 +1969,6 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
     int ret = 0;
     int64_t nNow = GetTime();
 
-    const Consensus::Params& consensus = Params().GetConsensus();
-
     CBlockIndex* pindex = pindexStart;
     {
         LOCK(cs_main);
@@ -1822,15 +1978,46 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
             pindex = chainActive.Next(pindex);
     }
 
+    int nThreads = gArgs.GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+    if (nThreads <= 0) nThreads = GetNumCores();
+    // Blocks read and matched ahead of the one added to the wallet
+    const size_t nMaxAhead = 4 * nThreads;
+    // Testing: slow the scan down, so that it can be aborted
+    const int64_t nDelayMs = gArgs.GetArg("-rescandelay", 0);
+
+    fAbortRescan = false;
+    fScanningWallet = true;
     {
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         const double dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
         const CBlockIndex* tip = nullptr;
         double dProgressTip = 0.0;
         std::vector<uint256> myTxHashes;
+        int nBlocksScanned = 0;
 
+        RescanPipeline pipeline(this, nThreads);
+        CBlockIndex* pindexQueued = nullptr;
         double gvp = dProgressStart;
-        while (pindex) {
+        while (true) {
+            {
+                // Queue the next blocks of the active chain. Stop at a block that
+                // was disconnected, the scan aborts when it reaches it.
+                LOCK(cs_main);
+                if (!pindexQueued && pindex) {
+                    pipeline.Push(pindex);
+                    pindexQueued = pindex;
+                }
+                while (pindexQueued && pipeline.Size() < nMaxAhead && chainActive.Contains(pindexQueued)) {
+                    CBlockIndex* pindexNext = chainActive.Next(pindexQueued);
+                    if (!pindexNext) break;
+                    pipeline.Push(pindexNext);
+                    pindexQueued = pindexNext;
+                }
+            }
+            std::unique_ptr<RescanBlock> pscan = pipeline.Pop();
+            if (!pscan) break;
+            pindex = pscan->pindex;
+
             gvp = Checkpoints::GuessVerificationProgress(pindex, false);
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int) ((gvp - dProgressStart) /
@@ -1838,18 +2025,27 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
                                                                                  100))));
             }
             if (GetTime() >= nNow + 60) {
+                LogPrintf("Still rescanning. At block %d. Progress=%f (%.1f blocks/s)\n", pindex->nHeight, gvp, (double) nBlocksScanned / (GetTime() - nNow));
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, gvp);
+                nBlocksScanned = 0;
             }
             if (fromStartup && ShutdownRequested()) {
+                fScanningWallet = false;
                 return -1;
             }
+            if (nDelayMs > 0) MilliSleep(nDelayMs);
+            if (fAbortRescan) {
+                LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, gvp);
+                ret = -1;
+                break;
+            }
 
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex)) {
+            if (pscan->fReadError) {
                 LogPrintf("Unable to read block %d (%s) from disk.", pindex->nHeight, pindex->GetBlockHash().ToString());
+                fScanningWallet = false;
                 return -1;
             }
+            const CBlock& block = pscan->block;
 
             {
                 LOCK2(cs_main, cs_wallet);
@@ -1867,7 +2063,11 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
                 for (int posInBlock = 0; posInBlock < (int) block.vtx.size(); posInBlock++) {
                     const auto& tx = block.vtx[posInBlock];
                     CWalletTx::Confirmation confirm(CWalletTx::Status::CONFIRMED, pindex->nHeight, pindex->GetBlockHash(), posInBlock);
-                    if (AddToWalletIfInvolvingMe(tx, confirm, fUpdate)) {
+                    // Keys added since the block was matched (e.g. a keypool top up after a
+                    // previous transaction, of this block or an earlier one, used a key) make
+                    // the match stale: match the transaction again
+                    const bool fMatchCurrent = pscan->nKeyStoreVersion == GetKeyStoreVersion();
+                    if (AddToWalletIfInvolvingMe(tx, confirm, fUpdate, fMatchCurrent ? &pscan->vMatches[posInBlock] : nullptr)) {
                         myTxHashes.push_back(tx->GetHash());
                         ret++;
                     }
@@ -1884,9 +2084,8 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
                         ChainTipAdded(pindex, &block, saplingTree);
                     }
                 }
-
-                pindex = chainActive.Next(pindex);
             }
+            nBlocksScanned++;
         }
 
         // Sapling
@@ -1904,9 +2103,17 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
 
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+    fScanningWallet = false;
     return ret;
 }
 
+bool CWallet::AbortRescan()
+{
+    if (!fScanningWallet || fAbortRescan) return false;
+    fAbortRescan = true;
+    return true;
+}
+
 void CWallet::ReacceptWalletTransactions(bool fFirstLoad)
 {
     LOCK2(cs_main, cs_wallet);
@@ -2611,6 +2818,94 @@ static void ApproximateBestSubset(std::vector<std::pair<CAmount, std::pair<const
     }
 }
 
+void CWallet::IndexStakeableOutputs(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    const uint256& wtxid = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        const COutPoint outpoint(wtxid, i);
+        mapStakeableCoins.erase(outpoint);
+        setStakeableCoinsUnresolved.erase(outpoint);
+    }
+
+    // Only outputs of transactions in the main chain can stake
+    if (!wtx.isConfirmed()) return;
+
+    const Consensus::Params& consensus = Params().GetConsensus();
+    int nMinDepth = consensus.nStakeMinDepth;
+    if (wtx.IsCoinBase() || wtx.IsCoinStake()) {
+        nMinDepth = std::max(nMinDepth, consensus.nCoinbaseMaturity + 1);
+    }
+
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        const CTxOut& output = wtx.tx->vout[i];
+        if (output.nValue <= 0) continue;
+
+        // Skip the outputs spent in the chain. Unconfirmed spends are checked
+        // in StakeableCoins, as they can be abandoned or removed from the mempool.
+        const COutPoint outpoint(wtxid, i);
+        bool fSpentInChain = false;
+        const auto range = mapTxSpends.equal_range(outpoint);
+        for (auto it = range.first; it != range.second && !fSpentInChain; ++it) {
+            auto mit = mapWallet.find(it->second);
+            fSpentInChain = mit != mapWallet.end() && mit->second.GetDepthInMainChain() > 0;
+        }
+        if (fSpentInChain) continue;
+
+        const isminetype mine = IsMine(output);
+        if (mine == ISMINE_NO || mine == ISMINE_SPENDABLE_DELEGATED) continue;
+
+        StakeableCoinEntry& entry = mapStakeableCoins[outpoint];
+        entry.mine = mine;
+        entry.fSolvable = IsSolvable(*this, output.scriptPubKey, mine == ISMINE_COLD);
+        entry.nMatureHeight = wtx.m_confirm.block_height + nMinDepth - 1;
+        entry.hashBlock = wtx.m_confirm.hashBlock;
+        setStakeableCoinsUnresolved.insert(outpoint);
+    }
+}
+
+void CWallet::UpdateStakeableCoins(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    // The index is built at the first StakeableCoins call
+    if (!fStakeableCoinsLoaded) return;
+
+    IndexStakeableOutputs(wtx);
+    for (const CTxIn& txin : wtx.tx->vin) {
+        auto it = mapWallet.find(txin.prevout.hash);
+        if (it != mapWallet.end()) {
+            IndexStakeableOutputs(it->second);
+        }
+    }
+}
+
+void CWallet::LoadStakeableCoins()
+{
+    AssertLockHeld(cs_wallet);
+    mapStakeableCoins.clear();
+    setStakeableCoinsUnresolved.clear();
+    for (const auto& it : mapWallet) {
+        IndexStakeableOutputs(it.second);
+    }
+    fStakeableCoinsLoaded = true;
+    LogPrint(BCLog::STAKING, "%s: %d stakeable outputs indexed\n", __func__, mapStakeableCoins.size());
+}
+
+void CWallet::ResolveStakeableCoins(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_wallet);
+    const uint256& hashBlock = pindex->GetBlockHash();
+    for (auto it = setStakeableCoinsUnresolved.begin(); it != setStakeableCoinsUnresolved.end(); ) {
+        auto mit = mapStakeableCoins.find(*it);
+        if (mit != mapStakeableCoins.end() && mit->second.hashBlock == hashBlock) {
+            mit->second.pindex = pindex;
+            it = setStakeableCoinsUnresolved.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
 bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
 {
     const bool fIncludeColdStaking = !sporkManager.IsSporkActive(SPORK_19_COLDSTAKING_MAINTENANCE) &&
@@ -2618,40 +2913,48 @@ bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
 
     if (pCoins) pCoins->clear();
 
-    LOCK2(cs_main, cs_wallet);
-    for (const auto& it : mapWallet) {
-        const uint256& wtxid = it.first;
-        const CWalletTx* pcoin = &(it).second;
-
-        // Check if the tx is selectable
-        int nDepth;
-        if (!CheckTXAvailability(pcoin, true, nDepth))
-            continue;
+    // cs_main is needed only to build the index the first time, and to look up
+    // the blocks of the coins not resolved by BlockConnected (e.g. after a rescan).
+    bool fNeedsIndexUpdate;
+    {
+        LOCK(cs_wallet);
+        fNeedsIndexUpdate = !fStakeableCoinsLoaded || !setStakeableCoinsUnresolved.empty();
+    }
+    if (fNeedsIndexUpdate) {
+        LOCK2(cs_main, cs_wallet);
+        if (!fStakeableCoinsLoaded) LoadStakeableCoins();
+        for (const COutPoint& outpoint : setStakeableCoinsUnresolved) {
+            auto it = mapStakeableCoins.find(outpoint);
+            if (it == mapStakeableCoins.end()) continue;
+            auto mi = mapBlockIndex.find(it->second.hashBlock);
+            if (mi != mapBlockIndex.end()) it->second.pindex = mi->second;
+        }
+        setStakeableCoinsUnresolved.clear();
+    }
 
-        // Check min depth requirement for stake inputs
-        if (nDepth < Params().GetConsensus().nStakeMinDepth) continue;
+    LOCK(cs_wallet);
+    const int nHeight = m_last_block_processed_height;
+    for (const auto& it : mapStakeableCoins) {
+        const COutPoint& outpoint = it.first;
+        const StakeableCoinEntry& entry = it.second;
 
-        const CBlockIndex* pindex = nullptr;
-        for (unsigned int index = 0; index < pcoin->tx->vout.size(); index++) {
+        // Check min depth requirement for stake inputs (and coinstake maturity)
+        if (entry.nMatureHeight > nHeight || !entry.pindex) continue;
 
-            auto res = CheckOutputAvailability(
-                    pcoin->tx->vout[index],
-                    index,
-                    wtxid,
-                    STAKEABLE_COINS,
-                    nullptr, // coin control
-                    false,   // fIncludeDelegated
-                    fIncludeColdStaking,
-                    false,
-                    false);   // fIncludeLocked
+        // Skip spent (in the mempool) and locked utxo
+        if (IsSpent(outpoint) || IsLockedCoin(outpoint.hash, outpoint.n)) continue;
 
-            if (!res.available) continue;
+        const CWalletTx* pcoin = &mapWallet.at(outpoint.hash);
+        // skip cold coins
+        if (entry.mine == ISMINE_COLD && (!fIncludeColdStaking || !HasDelegator(pcoin->tx->vout[outpoint.n]))) continue;
 
-            // found valid coin
-            if (!pCoins) return true;
-            if (!pindex) pindex = mapBlockIndex.at(pcoin->m_confirm.hashBlock);
-            pCoins->emplace_back(CStakeableOutput(pcoin, (int) index, nDepth, res.spendable, res.solvable, pindex));
-        }
+        // found valid coin
+        if (!pCoins) return true;
+        const bool fSpendable = ((entry.mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                (fIncludeColdStaking && (entry.mine & ISMINE_COLD) != ISMINE_NO);
+        const int nDepth = nHeight - pcoin->m_confirm.block_height + 1;
+        const CBlockIndex* pindex = entry.pindex;
+        pCoins->emplace_back(CStakeableOutput(pcoin, (int) outpoint.n, nDepth, fSpendable, entry.fSolvable, pindex));
     }
     return (pCoins && !pCoins->empty());
 }
@@ -3124,53 +3427,77 @@ bool CWallet::CreateCoinStake(
 
     // update staker status (hash)
     pStakerStatus->SetLastTip(pindexPrev);
-    pStakerStatus->SetLastCoins((int) availableCoins->size());
 
     // P2PKH block signatures were not accepted before v5 update.
     bool onlyP2PK = !consensus.NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V5_0);
 
     // Kernel Search
-    CAmount nCredit;
-    CScript scriptPubKeyKernel;
-    bool fKernelFound = false;
-    int nAttempts = 0;
-    for (auto it = availableCoins->begin(); it != availableCoins->end();) {
-        COutPoint outPoint = COutPoint(it->tx->GetHash(), it->i);
-        CCNoteStake stakeInput(it->tx->tx->vout[it->i],
-                             outPoint,
-                             it->pindex);
+    const bool fTimeSlot = GetStakeTimeSlot(pindexPrev, nTxNewTime);
+    // update staker status (time)
+    pStakerStatus->SetLastTime(nTxNewTime);
+    if (!fTimeSlot) return false;
 
-        // New block came in, move on
-        if (WITH_LOCK(cs_wallet, return m_last_block_processed_height) != pindexPrev->nHeight) return false;
-
-        // Make sure the wallet is unlocked and shutdown hasn't been requested
-        if (IsLocked() || ShutdownRequested()) return false;
-
-        // Make sure the stake input hasn't been spent since last check
-        if (WITH_LOCK(cs_wallet, return IsSpent(outPoint))) {
-            // remove it from the available coins
-            it = availableCoins->erase(it);
-            continue;
-        }
+    // Make sure the wallet is unlocked and shutdown hasn't been requested
+    if (IsLocked() || ShutdownRequested()) return false;
 
+    // Snapshot of the stake inputs which are still unspent: no further wallet
+    // lock is taken until a kernel is found.
+    std::vector<CCNoteStake> vStakeInputs;
+    {
+        LOCK(cs_wallet);
+        // New block came in, move on
+        if (m_last_block_processed_height != pindexPrev->nHeight) return false;
 
-        nCredit = 0;
+        // Remove the stake inputs spent since last check from the available coins
+        availableCoins->erase(std::remove_if(availableCoins->begin(), availableCoins->end(),
+                [this](const CStakeableOutput& out) { return IsSpent(out.tx->GetHash(), out.i); }),
+                availableCoins->end());
+    }
+    pStakerStatus->SetLastCoins((int) availableCoins->size());
 
-        nAttempts++;
-        fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime);
+    // Precompute the kernels
+    CStakeKernelSearch kernelSearch(pindexPrev, nBits, nTxNewTime);
+    vStakeInputs.reserve(availableCoins->size());
+    for (const CStakeableOutput& out : *availableCoins) {
+        CCNoteStake stakeInput(out.tx->tx->vout[out.i], COutPoint(out.tx->GetHash(), out.i), out.pindex);
+        if (kernelSearch.AddInput(&stakeInput)) vStakeInputs.emplace_back(stakeInput);
+    }
 
-        // update staker status (time, attempts)
-        pStakerStatus->SetLastTime(nTxNewTime);
-        pStakerStatus->SetLastTries(nAttempts);
+    // Hash them in parallel, until a kernel meeting the target is found
+    const uint256& hashPrevBlock = pindexPrev->GetBlockHash();
+    auto fnAbort = [this, &hashPrevBlock]() {
+        return ShutdownRequested() || IsLocked() ||
+               WITH_LOCK(g_best_block_mutex, return g_best_block) != hashPrevBlock;
+    };
+    int nThreads = gArgs.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+    if (nThreads <= 0) nThreads = GetNumCores();
 
-        if (!fKernelFound) {
-            it++;
-            continue;
+    CAmount nCredit;
+    bool fKernelFound = false;
+    int nAttempts = 0;
+    for (int nStart = 0; nStart < (int) kernelSearch.Size();) {
+        int nHashed = 0;
+        const int nFound = kernelSearch.Find(nThreads, fnAbort, nStart, &nHashed);
+        // Up to the kernel found, or the kernels hashed until the search ended or was aborted
+        nAttempts = (nFound < 0 ? nStart + nHashed : nFound + 1);
+        if (nFound < 0) break;
+        nStart = nFound + 1;
+        CCNoteStake& stakeInput = vStakeInputs[nFound];
+
+        // Make sure the stake input hasn't been spent, nor a new block came in, during the search
+        {
+            LOCK(cs_wallet);
+            if (m_last_block_processed_height != pindexPrev->nHeight) return false;
+            if (IsSpent(stakeInput.GetOutPoint())) continue;
         }
 
+        // Double check (and log) the kernel
+        fKernelFound = CStakeKernel(pindexPrev, &stakeInput, nBits, nTxNewTime).CheckKernelHash(true);
+        if (!fKernelFound) continue;
+
         // Found a kernel
         LogPrintf("CreateCoinStake : kernel found\n");
-        nCredit += stakeInput.GetValue();
+        nCredit = stakeInput.GetValue();
 
         // Add block reward to the credit
         nCredit += GetBlockValue(pindexPrev->nHeight + 1);
@@ -3179,7 +3506,7 @@ bool CWallet::CreateCoinStake(
         std::vector<CTxOut> vout;
         if (!stakeInput.CreateTxOuts(this, vout, nCredit, onlyP2PK)) {
             LogPrintf("%s : failed to create output\n", __func__);
-            it++;
+            fKernelFound = false;
             continue;
         }
         txNew.vout.insert(txNew.vout.end(), vout.begin(), vout.end());
@@ -3213,13 +3540,17 @@ bool CWallet::CreateCoinStake(
             LogPrintf("%s : failed to create TxIn\n", __func__);
             txNew.vin.clear();
             txNew.vout.clear();
-            it++;
+            txNew.vout.emplace_back(0, CScript());
+            fKernelFound = false;
             continue;
         }
         txNew.vin.emplace_back(in);
 
         break;
     }
+
+    // update staker status (attempts)
+    pStakerStatus->SetLastTries(nAttempts);
     LogPrint(BCLog::STAKING, "%s: attempted staking %d times\n", __func__, nAttempts);
 
     if (!fKernelFound)
@@ -4112,6 +4443,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-mintxfee=<amt>", strprintf(_("Fees (in %s/Kb) smaller than this are considered zero fee for transaction creation (default: %s)"), CURRENCY_UNIT, FormatMoney(CWallet::minTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"), CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Set the number of threads reading and matching blocks ahead during a rescan (0 = all cores, default: %d)"), DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), DEFAULT_SPEND_ZEROCONF_CHANGE));
     strUsage += HelpMessageOpt("-txconfirmtarget=<n>", strprintf(_("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)"), 1));
@@ -4126,6 +4458,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), DEFAULT_GENERATE_PROCLIMIT));
     strUsage += HelpMessageOpt("-minstakesplit=<amt>", strprintf(_("Minimum positive amount (in CNOTE) allowed by GUI and RPC for the stake split threshold (default: %s)"), FormatMoney(DEFAULT_MIN_STAKE_SPLIT_THRESHOLD)));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(_("Enable staking functionality (0-1, default: %u)"), DEFAULT_STAKING));
+    strUsage += HelpMessageOpt("-stakingthreads=<n>", strprintf(_("Set the number of threads for the stake kernel search (0 = all cores, default: %d)"), DEFAULT_STAKING_THREADS));
     if (showDebug) {
         strUsage += HelpMessageGroup(_("Wallet debugging/testing options:"));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf(_("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)"), DEFAULT_WALLET_DBLOGSIZE));
@@ -4133,6 +4466,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
         strUsage += HelpMessageOpt("-printcoinstake", _("Display verbose coin stake messages in the debug.log file."));
         strUsage += HelpMessageOpt("-printstakemodifier", _("Display the stake modifier calculations in the debug.log file."));
         strUsage += HelpMessageOpt("-privdb", strprintf(_("Sets the DB_PRIVATE flag in the wallet db environment (default: %u)"), DEFAULT_WALLET_PRIVDB));
+        strUsage += HelpMessageOpt("-rescandelay=<n>", _("Wait <n> milliseconds after each block of a wallet rescan (default: 0)"));
     }
 
     return strUsage;
@@ -4277,7 +4611,7 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
             walletInstance->m_last_block_processed_time = tip->GetBlockTime();
         }
     }
-    RegisterValidationInterface(walletInstance);
+    RegisterValidationInterface(walletInstance, "wallet");
 
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
         uiInterface.InitMessage(_("Rescanning..."));
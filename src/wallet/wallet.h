@@ -75,6 +75,10 @@ static const CAmount DEFAULT_MIN_STAKE_SPLIT_THRESHOLD = 100 * COIN;
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 //! Default for -staking
 static const bool DEFAULT_STAKING = true;
+//! Default for -stakingthreads (0 = number of cores)
+static const int DEFAULT_STAKING_THREADS = 0;
+//! Default for -rescanthreads (0 = number of cores)
+static const int DEFAULT_RESCAN_THREADS = 0;
 //! Default for -coldstaking
 static const bool DEFAULT_COLDSTAKING = true;
 //! Defaults for -gen and -genproclimit
@@ -553,6 +557,18 @@ public:
     bool AcceptToMemoryPool(CValidationState& state, bool fLimitFree = true, bool fRejectInsaneFee = true, bool ignoreFees = false);
 };
 
+/**
+ * What a transaction holds for the wallet, as far as the keystore alone can tell:
+ * computed without cs_wallet, ahead of AddToWalletIfInvolvingMe, by the rescan workers.
+ */
+struct CWalletTxMatch
+{
+    //! Whether an output is mine
+    bool fOutputIsMine{false};
+    //! FindMySaplingNotes result: the notes decrypted with the wallet viewing keys, and their missing addresses
+    std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> saplingNotes;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -610,6 +626,31 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Stakeable coins index: unspent outputs of confirmed wallet transactions,
+     * which are mine and could be used to stake once they reach nMatureHeight
+     * (stake min depth and coinbase/coinstake maturity).
+     * It's updated with the wallet transactions state changes, so the staker
+     * doesn't need to go through the whole mapWallet each time it looks for coins.
+     */
+    struct StakeableCoinEntry
+    {
+        isminetype mine{ISMINE_NO};
+        bool fSolvable{false};
+        int nMatureHeight{0};
+        uint256 hashBlock;
+        // Resolved when the block is connected, or at the first StakeableCoins call
+        const CBlockIndex* pindex{nullptr};
+    };
+    std::map<COutPoint, StakeableCoinEntry> mapStakeableCoins GUARDED_BY(cs_wallet);
+    std::set<COutPoint> setStakeableCoinsUnresolved GUARDED_BY(cs_wallet);
+    bool fStakeableCoinsLoaded GUARDED_BY(cs_wallet) = false;
+    void LoadStakeableCoins();
+    void IndexStakeableOutputs(const CWalletTx& wtx);
+    /* Update the index with the outputs of wtx, and the outputs it spends */
+    void UpdateStakeableCoins(const CWalletTx& wtx);
+    void ResolveStakeableCoins(const CBlockIndex* pindex);
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, int conflicting_height, const uint256& hashTx);
 
@@ -642,6 +683,13 @@ private:
     //! Destination --> label/purpose mapping.
     std::map<CWDestination, AddressBook::CAddressBookData> mapAddressBook;
 
+    //! Rescan state, read and set without cs_wallet (held by the rescan)
+    std::atomic<bool> fAbortRescan{false};
+    std::atomic<bool> fScanningWallet{false};
+
+    // Set saplingNoteData from a FindMySaplingNotes result, and add the addresses --> IVK mapping to the keystore if missing.
+    bool AddMissingIVKToKeystore(const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNotes, Optional<mapSaplingNoteData_t>& saplingNoteData);
+
 public:
 
     static const CAmount DEFAULT_STAKE_SPLIT_THRESHOLD = 500 * COIN;
@@ -940,7 +988,10 @@ public:
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) override;
-    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CWalletTx::Confirmation& confirm, bool fUpdate);
+    /** pmatch, if set, is MatchWalletTx(*tx) for the current keystore version */
+    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CWalletTx::Confirmation& confirm, bool fUpdate, const CWalletTxMatch* pmatch = nullptr);
+    /** Match tx against the keystore. Doesn't need cs_wallet. */
+    CWalletTxMatch MatchWalletTx(const CTransaction& tx) const;
     void EraseFromWallet(const uint256& hash);
 
     /**
@@ -950,6 +1001,10 @@ public:
     bool ActivateSaplingWallet(bool memOnly = false);
 
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false, bool fromStartup = false);
+    /** Stop the running rescan, keeping the transactions found so far. Returns false if there is none. */
+    bool AbortRescan();
+    /** Whether AbortRescan stopped the last rescan (or is stopping the running one) */
+    bool IsAbortingRescan() const { return fAbortRescan; }
     void TransactionRemovedFromMempool(const CTransactionRef &ptx) override;
     void ReacceptWalletTransactions(bool fFirstLoad = false);
     void ResendWalletTransactions(CConnman* connman) override;
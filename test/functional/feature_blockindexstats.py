@@ -16,7 +16,8 @@ class BlockIndexStatsTest(c_noteTestFramework):
     def set_test_params(self):
         self.num_nodes = 2
         saplingUpgrade = ['-nuparams=v5_shield:201']
-        self.extra_args = [saplingUpgrade] * self.num_nodes
+        # node1 serves the stats from the block stats index, node0 reads the blocks
+        self.extra_args = [saplingUpgrade, saplingUpgrade + ['-blockstatsindex']]
 
     def send_tx(self, node_from, node_to, fee, fFromShield, fToShield):
         if not fFromShield and not fToShield:
@@ -138,6 +139,15 @@ class BlockIndexStatsTest(c_noteTestFramework):
         assert_equal(count_tx + NUM_BLOCKS, alice_stats['txcount_all'])
         assert_equal(count_bytes, alice_stats['txbytes'])
         assert_equal(count_fees, float(alice_stats['ttlfee']))
+        assert_equal(len(alice_stats['feerate_percentiles']), 5)
+
+        # same results with and without the block stats index
+        assert_equal(miner.getblockindexstats(start_block+1, NUM_BLOCKS), alice_stats)
+
+        # the index is persisted
+        self.log.info("Restarting node with block stats index...")
+        self.restart_node(1, extra_args=self.extra_args[1])
+        assert_equal(alice.getblockindexstats(start_block+1, NUM_BLOCKS), alice_stats)
 
 
 
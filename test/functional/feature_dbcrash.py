@@ -6,7 +6,8 @@
 
 - 4 nodes
   * node0, node1, and node2 will have different dbcrash ratios, and different
-    dbcache sizes
+    dbcache sizes; node1 prefetches the coins of the next blocks, node2
+    writes the chainstate from a background thread
   * node3 will be a regular node, with no crashing.
   * The nodes will not connect to each other.
 
@@ -62,8 +63,8 @@ class ChainstateWriteCrashTest(c_noteTestFramework):
         # Set different crash ratios and cache sizes.  Note that not all of
         # -dbcache goes to the in-memory coins cache.
         self.node0_args = ["-dbcrashratio=8", "-dbcache=4", "-dbbatchsize=200000"] + self.base_args
-        self.node1_args = ["-dbcrashratio=16", "-dbcache=8", "-dbbatchsize=200000"] + self.base_args
-        self.node2_args = ["-dbcrashratio=24", "-dbcache=16", "-dbbatchsize=200000"] + self.base_args
+        self.node1_args = ["-dbcrashratio=16", "-dbcache=8", "-dbbatchsize=200000", "-prefetchthreads=2"] + self.base_args
+        self.node2_args = ["-dbcrashratio=24", "-dbcache=16", "-dbbatchsize=200000", "-backgroundflush"] + self.base_args
 
         # Node3 is a normal node with default args, except will mine full blocks
         self.node3_args = ["-blockmaxsize=1999000"] + self.chain_params # future: back port blockmaxweight
@@ -7,11 +7,16 @@
 - Start a single node and generate 3 blocks.
 - Stop the node and restart it with -reindex. Verify that the node has reindexed up to block 3.
 - Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3.
+- Restart it with -reindex and -reindexthreads (the pipelined reindex), with and without
+  room for out of order blocks in memory, and verify the same.
+- Swap blocks 1 and 2 in blk00000.dat, and verify that both reindex modes process the
+  out of order block once its parent is known.
 """
 
 from test_framework.test_framework import c_noteTestFramework
 from test_framework.util import assert_equal
-import time
+import os
+import struct
 
 class ReindexTest(c_noteTestFramework):
 
@@ -19,17 +24,58 @@ class ReindexTest(c_noteTestFramework):
         self.setup_clean_chain = True
         self.num_nodes = 1
 
-    def reindex(self):
+    def reindex(self, args=[]):
         self.nodes[0].generate(3)
         blockcount = self.nodes[0].getblockcount()
         self.stop_nodes()
-        extra_args = [["-reindex", "-checkblockindex=1"]]
+        extra_args = [["-reindex", "-checkblockindex=1"] + args]
         self.start_nodes(extra_args)
         assert_equal(self.nodes[0].getblockcount(), blockcount)  # start_node is blocking on reindex
         self.log.info("Success")
 
+    def count_log(self, text):
+        with open(os.path.join(self.nodes[0].datadir, "regtest", "debug.log"), encoding="utf-8") as f:
+            return sum(1 for line in f if text in line)
+
+    def swap_blocks_on_disk(self):
+        # Blocks are always written in order here, so swap the records (magic, size, block)
+        # of blocks 1 and 2, after the genesis block.
+        blk0 = os.path.join(self.nodes[0].datadir, "regtest", "blocks", "blk00000.dat")
+        with open(blk0, 'r+b') as bf:
+            b = bf.read()
+            records = []
+            pos = 0
+            for _ in range(3):
+                size = struct.unpack("<I", b[pos + 4:pos + 8])[0]
+                records.append(b[pos:pos + 8 + size])
+                pos += 8 + size
+            bf.seek(len(records[0]))
+            bf.write(records[2])
+            bf.write(records[1])
+
+    def out_of_order(self, blockcount, args=[]):
+        # The node is stopped: it can't load the swapped blocks from the old positions
+        n_out_of_order = self.count_log("Out of order block")
+        n_children = self.count_log("Processing out of order child")
+        self.start_nodes([["-reindex", "-checkblockindex=1"] + args])
+        assert_equal(self.nodes[0].getblockcount(), blockcount)
+        self.stop_nodes()
+        assert self.count_log("Out of order block") > n_out_of_order
+        assert self.count_log("Processing out of order child") > n_children
+        self.log.info("Success")
+
     def run_test(self):
         self.reindex()
+        self.reindex(["-reindexthreads=4"])
+        self.reindex(["-reindexthreads=1", "-reindexbuffer=0"])
+
+        blockcount = self.nodes[0].getblockcount()
+        self.stop_nodes()
+        self.swap_blocks_on_disk()
+        self.out_of_order(blockcount)
+        self.out_of_order(blockcount, ["-reindexthreads=4"])
+        self.out_of_order(blockcount, ["-reindexthreads=1", "-reindexbuffer=0"])
+        self.start_nodes()
 
 if __name__ == '__main__':
     ReindexTest().main()
@@ -221,6 +221,11 @@ class RESTTest (c_noteTestFramework):
         response_hex_str = response_hex.read()
         assert_equal(encode(response_str, "hex_codec")[0:160], response_hex_str[0:160])
 
+        # raw blocks are served as stored on disk: compare with getblock
+        block_hex = self.nodes[0].getblock(bb_hash, False)
+        assert_equal(response_hex_str.decode('ascii').strip(), block_hex)
+        assert_equal(response_str, bytes.fromhex(block_hex))
+
         # compare with hex block header
         response_header_hex = http_get_call(url.hostname, url.port, '/rest/headers/1/'+bb_hash+self.FORMAT_SEPARATOR+"hex", True)
         assert_equal(response_header_hex.status, 200)
@@ -304,10 +309,14 @@ class RESTTest (c_noteTestFramework):
 
         #check if the 3 tx show up in the new block
         json_string = http_get_call(url.hostname, url.port, '/rest/block/'+newblockhash[0]+self.FORMAT_SEPARATOR+'json')
-        json_obj = json.loads(json_string)
+        json_obj = json.loads(json_string, parse_float=Decimal)
         for tx in json_obj['tx']:
             if not 'coinbase' in tx['vin'][0]: #exclude coinbase
                 assert_equal(tx['txid'] in txs, True)
+                # inputs are detailed from the undo data
+                value_in = sum(vin['prevout']['value'] for vin in tx['vin'])
+                value_out = sum(vout['value'] for vout in tx['vout'])
+                assert_equal(tx['fee'], value_in - value_out)
 
         #check the same but without tx details
         json_string = http_get_call(url.hostname, url.port, '/rest/block/notxdetails/'+newblockhash[0]+self.FORMAT_SEPARATOR+'json')
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The C_Note developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Test compact block relay (BIP152).
+
+Blocks mined by node0 are reconstructed by node1 from a cmpctblock and its
+own mempool. The reconstructions are read back from node1's debug.log to
+check the coinbase/coinstake prefilling and to measure the reconstruction
+rate (share of the block transactions found in the mempool).
+"""
+
+import os
+import re
+
+from test_framework.test_framework import c_noteTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    connect_nodes,
+    disconnect_nodes,
+    Decimal,
+)
+
+RECONSTRUCTED_RE = re.compile(r"Successfully reconstructed block ([0-9a-f]{64}) with (\d+) txn prefilled, "
+                              r"(\d+) txn from mempool and (\d+) txn requested")
+
+
+class CompactBlocksTest(c_noteTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [[], []]
+
+    def get_reconstructions(self, node):
+        """Return the blocks rebuilt from a cmpctblock by node, as
+        {hash: (prefilled, from_mempool, requested)}."""
+        res = {}
+        with open(os.path.join(node.datadir, "regtest", "debug.log"), encoding="utf-8") as f:
+            for line in f:
+                m = RECONSTRUCTED_RE.search(line)
+                if m is not None:
+                    res[m.group(1)] = tuple(int(x) for x in m.groups()[1:])
+        return res
+
+    def mine_and_check(self, miner, receiver, n_txes, n_requested):
+        bhash = miner.generate(1)[0]
+        self.sync_blocks()
+        block = receiver.getblock(bhash, True)
+        assert_equal(len(block["tx"]), n_txes + 2)
+        reconstructions = self.get_reconstructions(receiver)
+        assert bhash in reconstructions, "block %s was not relayed as a cmpctblock" % bhash
+        prefilled, from_mempool, requested = reconstructions[bhash]
+        # PoS blocks: coinbase and coinstake are always prefilled
+        assert_equal(prefilled, 2)
+        assert_equal(from_mempool, n_txes - n_requested)
+        assert_equal(requested, n_requested)
+        return from_mempool, requested
+
+    def run_test(self):
+        miner = self.nodes[0]
+        receiver = self.nodes[1]
+        self.log.info("Generating 300 blocks...")
+        miner.generate(300)
+        self.sync_blocks()
+        assert_equal(miner.getblockchaininfo()['upgrades']['v5 shield']['status'], 'active')
+
+        total_mempool = 0
+        total_requested = 0
+
+        self.log.info("Relaying blocks of transparent transactions...")
+        for _ in range(5):
+            for _ in range(10):
+                miner.sendtoaddress(receiver.getnewaddress(), Decimal("1"))
+            self.sync_mempools()
+            m, r = self.mine_and_check(miner, receiver, 10, 0)
+            total_mempool += m
+            total_requested += r
+
+        self.log.info("Relaying a block of shielded transactions...")
+        z_addr = receiver.getnewshieldaddress()
+        for _ in range(3):
+            miner.shieldsendmany("from_transparent", [{"address": z_addr, "amount": Decimal("10")}])
+        self.sync_mempools()
+        m, r = self.mine_and_check(miner, receiver, 3, 0)
+        total_mempool += m
+        total_requested += r
+        self.sync_all()
+        assert_equal(receiver.getshieldbalance(z_addr), Decimal("30"))
+
+        self.log.info("Relaying a block with transactions missing from the receiver's mempool...")
+        disconnect_nodes(miner, 1)
+        disconnect_nodes(receiver, 0)
+        for _ in range(4):
+            miner.sendtoaddress(receiver.getnewaddress(), Decimal("1"))
+        miner.shieldsendmany("from_transparent", [{"address": z_addr, "amount": Decimal("10")}])
+        connect_nodes(miner, 1)
+        m, r = self.mine_and_check(miner, receiver, 5, 5)
+        total_mempool += m
+        total_requested += r
+        assert_equal(receiver.getshieldbalance(z_addr), Decimal("40"))
+
+        rate = total_mempool / (total_mempool + total_requested)
+        self.log.info("Reconstruction rate: %.2f (%d txes from mempool, %d requested)" %
+                      (rate, total_mempool, total_requested))
+        assert_greater_than(rate, 0.9)
+
+
+if __name__ == '__main__':
+    CompactBlocksTest().main()
@@ -41,6 +41,8 @@ class BlockchainTest(c_noteTestFramework):
         #self._test_getblockchaininfo()
         self._test_gettxoutsetinfo()
         self._test_getblockheader()
+        self._test_getvalidationqueueinfo()
+        self._test_getdbinfo()
         #self._test_getdifficulty()
         self.nodes[0].verifychain(0)
 
@@ -76,6 +78,86 @@ class BlockchainTest(c_noteTestFramework):
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
 
+        # the statistics maintained with the chain agree with the full scan
+        res2 = node.gettxoutsetinfo("muhash")
+        assert_equal(res2['total_amount'], res['total_amount'])
+        assert_equal(res2['shield_amount'], Decimal('0'))
+        assert_equal(res2['txouts'], res['txouts'])
+        assert_equal(res2['bestblock'], res['bestblock'])
+        assert_equal(len(res2['muhash']), 64)
+        assert_raises_rpc_error(-8, "only available at the chain tip", node.gettxoutsetinfo, "hash_serialized_2", 100)
+        assert_raises_rpc_error(-8, "not a valid hash_type", node.gettxoutsetinfo, "sha256")
+
+        # history by height
+        res3 = node.gettxoutsetinfo("muhash", 100)
+        assert_equal(res3['height'], 100)
+        assert_equal(res3['bestblock'], node.getblockhash(100))
+        assert_equal(res3['total_amount'], Decimal('25000.00000000'))
+        assert 'disk_size' not in res3
+        assert_equal(node.getsupplyinfo(False, 100)['transparentsupply'], res3['total_amount'])
+        assert_raises_rpc_error(-8, "Block height out of range", node.gettxoutsetinfo, "muhash", 201)
+
+        # disconnecting and reconnecting the tip restores the same set hash
+        node.invalidateblock(node.getblockhash(200))
+        res4 = node.gettxoutsetinfo("muhash")
+        assert_equal(res4['height'], 199)
+        assert_equal(res4['total_amount'], Decimal('49750.00000000'))
+        assert_equal(res4['txouts'], 199)
+        assert res4['muhash'] != res2['muhash']
+        node.reconsiderblock(node.getblockhash(200))
+        res5 = node.gettxoutsetinfo("muhash")
+        for key in ['height', 'bestblock', 'txouts', 'muhash', 'total_amount']:
+            assert_equal(res5[key], res2[key])
+        assert_equal(node.gettxoutsetinfo()['hash_serialized_2'], res['hash_serialized_2'])
+
+    def _test_getvalidationqueueinfo(self):
+        node = self.nodes[0]
+        node.syncwithvalidationinterfacequeue()
+        res = node.getvalidationqueueinfo()
+        assert_equal(sorted(res.keys()), ['avg_queue_delay_ms', 'limit', 'limit_wait_ms', 'limit_waits',
+                                          'max_pending', 'pending', 'processed', 'subscribers'])
+        assert_equal(res['limit'], 10)
+        assert res['processed'] > 0
+        subscribers = {s['name']: s for s in res['subscribers']}
+        assert 'peerlogic' in subscribers
+        assert 'wallet' in subscribers
+        assert subscribers['wallet']['calls'] > 0
+        assert subscribers['wallet']['max_ms'] >= subscribers['wallet']['avg_ms']
+
+    def _test_getdbinfo(self):
+        node = self.nodes[0]
+        res = node.getdbinfo()
+        assert_equal(res['shared_cache'], {'capacity': 0, 'usage': 0})
+        dbs = {db['name']: db for db in res['databases']}
+        for name in ['chainstate', 'index', 'sporks', 'coinstats']:
+            assert name in dbs
+            assert_greater_than_or_equal(dbs[name]['approximate_size'], 0)
+            assert not dbs[name]['shared_cache']
+        # built-in profiles
+        assert_equal(dbs['chainstate']['max_open_files'], 128)
+        assert_equal(dbs['chainstate']['block_size'], 16384)
+        # the bundled LevelDB is built without Snappy: no database is compressed
+        assert not dbs['index']['compression']
+        assert not dbs['chainstate']['compression']
+        assert 'Compactions' in dbs['chainstate']['stats']
+
+        self.log.info("Test -dbprofile and -dbsharedcache")
+        self.restart_node(0, extra_args=['-dbsharedcache=8', '-dbprofile=chainstate:maxopenfiles=256,bloombits=12',
+                                         '-dbprofile=sporks:sharedcache=0'])
+        res = node.getdbinfo()
+        assert_equal(res['shared_cache']['capacity'], 8 << 20)
+        dbs = {db['name']: db for db in res['databases']}
+        assert_equal(dbs['chainstate']['max_open_files'], 256)
+        assert_equal(dbs['chainstate']['bloom_bits'], 12)
+        assert_equal(dbs['chainstate']['block_size'], 16384)
+        assert dbs['chainstate']['shared_cache']
+        assert not dbs['sporks']['shared_cache']
+        self.stop_node(0)
+        self.assert_start_raises_init_error(0, ['-dbprofile=chainstate:blocksize=1'], "Invalid -dbprofile option 'blocksize=1' for the chainstate database")
+        self.assert_start_raises_init_error(0, ['-dbprofile=wallet:compression=1'], "Unknown database 'wallet' in -dbprofile")
+        self.assert_start_raises_init_error(0, ['-socketevents=select', '-dbprofile=chainstate:maxopenfiles=65536'], "which leaves none for the connections")
+        self.start_node(0)
+
     def _test_getblockheader(self):
         node = self.nodes[0]
 
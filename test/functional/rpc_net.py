@@ -22,6 +22,7 @@ class NetTest(c_noteTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 2
+        self.extra_args = [[], ["-msghandthreads=0"]]
 
     def run_test(self):
         self.log.info("Connect nodes both way")
@@ -30,6 +31,7 @@ class NetTest(c_noteTestFramework):
 
         self._test_connection_count()
         self._test_getnettotals()
+        self._test_getmessagestats()
         self._test_getnetworkinginfo()
         self._test_getaddednodeinfo()
         #self._test_getpeerinfo()
@@ -64,6 +66,18 @@ class NetTest(c_noteTestFramework):
 
         peer_info_after_ping = self.nodes[0].getpeerinfo()
 
+    def _test_getmessagestats(self):
+        stats = self.nodes[0].getmessagestats()
+        assert_equal(stats['workers'], 2)
+        assert_equal(self.nodes[1].getmessagestats()['workers'], 0)
+        # the version handshake and the pong of _test_getnettotals were processed
+        for command in ['version', 'verack', 'pong']:
+            cmd_stats = stats['commands'][command]
+            assert_greater_than_or_equal(cmd_stats['count'], 1)
+            assert_greater_than_or_equal(cmd_stats['queue_max_us'], cmd_stats['queue_avg_us'])
+            assert_greater_than_or_equal(cmd_stats['process_max_us'], cmd_stats['process_avg_us'])
+        assert 'mnb' not in stats['commands']
+
     def _test_getnetworkinginfo(self):
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
 
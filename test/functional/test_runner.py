@@ -86,6 +86,7 @@ BASE_SCRIPTS= [
     'p2p_disconnect_ban.py',                    # ~ 118 sec
     'wallet_listreceivedby.py',                 # ~ 117 sec
     'mining_pos_fakestake.py',                  # ~ 113 sec
+    'p2p_compactblocks.py',                     # ~ 110 sec
     'feature_reindex.py',                       # ~ 110 sec
     'interface_http.py',                        # ~ 105 sec
     'feature_blockhashcache.py',                # ~ 100 sec
@@ -194,6 +195,7 @@ LEGACY_SKIP_TESTS = [
     'mempool_reorg.py',
     'mempool_resurrect.py',
     'mempool_spend_coinbase.py',
+    'p2p_compactblocks.py',
     'p2p_disconnect_ban.py',
     'p2p_time_offset.py',
     'rpc_bip38.py',
@@ -7,22 +7,44 @@
 Two nodes. Node1 is under test. Node0 is providing transactions and generating blocks.
 
 - Start node1, shutdown and backup wallet.
-- Generate 110 keys (enough to drain the keypool). Store key 90 (in the initial keypool) and key 110 (beyond the initial keypool). Send funds to key 90 and key 110.
+- Generate 205 keys (enough to drain the keypool). Store key 90 (in the initial keypool), key 110 (beyond the initial keypool)
+  and key 205 (beyond the keypool topped up after key 90). Send funds to key 90, then to key 110 and key 205 in the same block.
 - Stop node1, clear the datadir, move wallet file back into the datadir and restart node1.
-- connect node1 to node0. Verify that they sync and node1 receives its funds."""
+- connect node1 to node0. Verify that they sync and node1 receives its funds.
+- Restore the backup again and rescan with a single thread: same balance.
+- Abort a running rescan."""
+from decimal import Decimal
 import shutil
+import threading
 
+from test_framework.authproxy import JSONRPCException
 from test_framework.test_framework import c_noteTestFramework
 from test_framework.util import (
     assert_equal,
     connect_nodes,
+    get_rpc_proxy,
 )
 
+class ImportThread(threading.Thread):
+    def __init__(self, node, privkey):
+        threading.Thread.__init__(self)
+        # the rescan holds the connection: use a new one
+        self.node = get_rpc_proxy(node.url, 1, timeout=600, coveragedir=node.coverage_dir)
+        self.privkey = privkey
+        self.error = None
+
+    def run(self):
+        try:
+            self.node.importprivkey(self.privkey, "", True)
+        except JSONRPCException as e:
+            self.error = e.error['message']
+
 class KeypoolRestoreTest(c_noteTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 2
-        self.extra_args = [['-keypool=3'], ['-keypool=100']]
+        # Several rescan threads match the blocks ahead: the ones after the keypool top up must be matched again
+        self.extra_args = [['-keypool=3'], ['-keypool=100', '-rescanthreads=4']]
 
     def run_test(self):
         isLegacyWallet = '-legacywallet' in self.nodes[0].extra_args
@@ -43,12 +65,21 @@ class KeypoolRestoreTest(c_noteTestFramework):
             addr_oldpool = self.nodes[1].getnewaddress()
         for _ in range(20):
             addr_extpool = self.nodes[1].getnewaddress()
+        for _ in range(95):
+            addr_samepool = self.nodes[1].getnewaddress()
 
         self.log.info("Send funds to wallet")
 
         self.nodes[0].sendtoaddress(addr_oldpool, 10)
         self.nodes[0].generate(1)
-        self.nodes[0].sendtoaddress(addr_extpool, 5)
+        # Key 205 is only found once the keypool is topped up after key 110, by a previous
+        # transaction of the same block: the second transaction spends the change of the first one
+        txid = self.nodes[0].sendtoaddress(addr_extpool, 5)
+        tx = self.nodes[0].decoderawtransaction(self.nodes[0].getrawtransaction(txid))
+        change = [out for out in tx['vout'] if out['value'] != 5][0]
+        raw = self.nodes[0].createrawtransaction([{"txid": txid, "vout": change['n']}],
+                                                 {addr_samepool: 2, self.nodes[0].getnewaddress(): change['value'] - Decimal('2.01')})
+        self.nodes[0].sendrawtransaction(self.nodes[0].signrawtransaction(raw)['hex'])
         self.nodes[0].generate(1)
         self.sync_blocks()
 
@@ -66,13 +97,36 @@ class KeypoolRestoreTest(c_noteTestFramework):
 
         # wallet was not backupped after emptying the key pool.
         # Legacy wallet can't recover funds in addr_extpool
-        recoveredBalance = 10 if isLegacyWallet else 15
+        recoveredBalance = 10 if isLegacyWallet else 17
         assert_equal(self.nodes[1].getbalance(), recoveredBalance)
         assert_equal(self.nodes[1].listtransactions()[0]['category'], "receive")
 
         # Check that we have marked all keys up to the used keypool key as used
         if not isLegacyWallet:
-            assert_equal(self.nodes[1].getaddressinfo(self.nodes[1].getnewaddress())['hdkeypath'], "m/44'/119'/0'/0'/110'")
+            assert_equal(self.nodes[1].getaddressinfo(self.nodes[1].getnewaddress())['hdkeypath'], "m/44'/119'/0'/0'/205'")
+
+        self.log.info("Restore the wallet backup again, rescan with a single thread")
+
+        self.stop_node(1)
+        shutil.copyfile(self.tmpdir + "/wallet.bak", self.tmpdir + "/node1/regtest/wallet.dat")
+        self.start_node(1, self.extra_args[1] + ['-rescanthreads=1'])
+        assert_equal(self.nodes[1].getbalance(), recoveredBalance)
+        # No rescan running
+        assert_equal(self.nodes[1].abortrescan(), False)
+
+        self.log.info("Abort a running rescan")
+
+        # Slow the rescan down, so that it is still running when aborted
+        self.restart_node(1, self.extra_args[1] + ['-rescandelay=100'])
+        importer = ImportThread(self.nodes[1], self.nodes[0].dumpprivkey(self.nodes[0].getnewaddress()))
+        importer.start()
+        aborted = False
+        while importer.is_alive() and not aborted:
+            aborted = self.nodes[1].abortrescan()
+        importer.join()
+        assert aborted
+        assert_equal(importer.error, "Rescan aborted by user.")
+        assert_equal(self.nodes[1].getbalance(), recoveredBalance)
 
 if __name__ == '__main__':
     KeypoolRestoreTest().main()